@@ -80,7 +80,7 @@ void list(IBroker* l)
             }
         }
         l->print();
-        delete brokers;
+        free_brokers(bks);
        },l);
 }
 
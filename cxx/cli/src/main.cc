@@ -17,6 +17,7 @@
 
 #include <core/urph-fin-core.hxx>
 #include <core/stock.hxx>
+#include <civil_date.hxx>
 
 #include "cli/clilocalsession.h"
 #include <cli/loopscheduler.h>
@@ -53,20 +54,9 @@ void wait_for_notification()
 
 std::string format_timestamp(timestamp t)
 {
-    // Convert Unix timestamp to std::time_t
-    std::time_t time = static_cast<std::time_t>(t);
-
-    // Convert to local time
-    std::tm* localTime = std::localtime(&time);
-
-    // Create a string stream
-    std::ostringstream oss;
-
-    // Format the time and put it in the string stream
-    oss << std::put_time(localTime, "%Y-%m-%d %H:%M:%S");
-
-    // Return the formatted string
-    return oss.str();    
+    // local time, the time zone offset is cached
+    char buf[civil::DATE_TIME_LEN];
+    return std::string(buf, civil::format_local_date_time(t, buf));
 }
 
 void str_vect_to_table_row(Table& table,const std::vector<std::string>& cols)
@@ -130,8 +120,8 @@ inline double to_jpy(double fx_rate, double value)
 }
 std::pair<double, timestamp> get_rate(const std::string &symbol)
 {
-    auto it = quotes_by_symbol->mapping.find(symbol);
-    return it == quotes_by_symbol->mapping.end() ? std::make_pair(std::nan(""), (timestamp)0L) : std::make_pair(it->second->rate, it->second->date);
+    auto* q = quotes_by_symbol->index.find(symbol);
+    return q == nullptr ? std::make_pair(std::nan(""), (timestamp)0L) : std::make_pair(q->rate, q->date);
 }
 
 const char *groupName[] = {
@@ -195,7 +185,7 @@ void list_overview(GROUP lvl1, GROUP lvl2, GROUP lvl3, ostream &out)
         table.column(i).format().font_align(FontAlign::right);
     out << "\n"
         << table << endl;
-    delete o;
+    free_overview(o);
 }
 
 GROUP to_lvl_group(std::string &lvl)
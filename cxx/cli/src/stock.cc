@@ -201,7 +201,7 @@ void list_stock_pos(const char *symbol, IStockPos *pos)
             }
             pos->print();
             delete pos;
-            delete p;
+            free_stock_portfolio(p);
         },
         pos
     ); 
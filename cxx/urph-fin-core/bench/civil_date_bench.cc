@@ -0,0 +1,92 @@
+// Converts a million dates both ways, compares the civil_date.hxx functions
+// with the timegm/gmtime/stringstream code they replaced.
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/civil_date.hxx"
+
+namespace{
+
+// what time_utils.cpp used before, as the baseline
+int64_t legacy_parse(const std::string& date)
+{
+    std::tm tm = {};
+    std::istringstream ss(date);
+    ss >> std::get_time(&tm, "%Y-%m-%d");
+    return timegm(&tm);
+}
+
+std::string legacy_format(int64_t epoch)
+{
+    std::time_t t = static_cast<std::time_t>(epoch);
+    std::stringstream ss;
+    ss << std::put_time(std::gmtime(&t), "%Y-%m-%d");
+    return ss.str();
+}
+
+std::string legacy_format_local(int64_t epoch)
+{
+    std::time_t t = static_cast<std::time_t>(epoch);
+    std::ostringstream oss;
+    oss << std::put_time(std::localtime(&t), "%Y-%m-%d %H:%M:%S");
+    return oss.str();
+}
+
+template<typename F>
+void run(const char* name, size_t n, F&& f)
+{
+    int64_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < n; ++i){
+        check += f(i);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() * 1e9 / n << " ns/date (" << check % 1000 << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // daily closes over several decades, then minute timestamps as the CLI prints them
+    std::vector<int64_t> epochs(n);
+    std::vector<std::string> dates(n);
+    const int64_t from = civil::epoch_from_civil(1990, 1, 1);
+    for(size_t i = 0; i < n; ++i){
+        epochs[i] = from + static_cast<int64_t>(i % 15000) * civil::SECONDS_PER_DAY;
+        dates[i] = civil::to_date_string(epochs[i]);
+    }
+
+    std::cout << "parse yyyy-MM-dd, " << n << " dates\n";
+    run("get_time + timegm", n, [&](size_t i){ return legacy_parse(dates[i]); });
+    run("civil::parse_date", n, [&](size_t i){
+        int64_t epoch = 0;
+        civil::parse_date(dates[i], epoch);
+        return epoch;
+    });
+
+    std::cout << "format yyyy-MM-dd\n";
+    run("gmtime + put_time", n, [&](size_t i){ return (int64_t)legacy_format(epochs[i]).size(); });
+    run("civil::to_date_string", n, [&](size_t i){ return (int64_t)civil::to_date_string(epochs[i]).size(); });
+    run("civil::format_date", n, [&](size_t i){
+        char buf[civil::DATE_LEN];
+        return (int64_t)(civil::format_date(epochs[i], buf) - buf) + buf[9];
+    });
+
+    std::cout << "format local yyyy-MM-dd HH:mm:ss\n";
+    const int64_t now = std::time(nullptr);
+    run("localtime + put_time", n, [&](size_t i){ return (int64_t)legacy_format_local(now - (int64_t)i * 60).size(); });
+    run("civil::format_local_date_time", n, [&](size_t i){
+        char buf[civil::DATE_TIME_LEN];
+        return (int64_t)(civil::format_local_date_time(now - (int64_t)i * 60, buf) - buf) + buf[18];
+    });
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Sums a large fund portfolio with calc_fund_sum and the broker group sum of AllAssets::load_funds,
+// compares the columns they read now with the accumulate over the fund records they did before.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+
+#include "../src/storage/storage.hxx"
+#include "../src/core/intern.hxx"
+
+namespace{
+
+// what calc_fund_sum did before
+fund_sum legacy_fund_sum(fund_portfolio* portfolio)
+{
+    struct fund_sum init = { 0.0, 0.0, 0.0, 0.0 };
+    auto r = std::accumulate(portfolio->first_fund, portfolio->first_fund + portfolio->num, init, [](fund_sum& sum, fund& f){
+        sum.capital += f.capital;
+        sum.market_value += f.market_value;
+        sum.profit +=  f.market_value - f.capital;
+        return sum;
+    });
+    r.ROI = r.profit / r.capital;
+    return r;
+}
+
+// what load_funds did before, grouped by broker
+double legacy_group_sum(FundPortfolio* fp)
+{
+    std::map<Name, std::pair<double, double>> by_broker;
+    for(const Fund& f: *fp){
+        auto& vp = by_broker[Name::of_interned(f.broker)];
+        vp.first += f.market_value;
+        vp.second += f.profit;
+    }
+    double check = 0;
+    for(auto& [_, vp]: by_broker) check += vp.first + vp.second;
+    return check;
+}
+
+double group_sum(FundPortfolio* fp)
+{
+    const auto* cols = fp->columns();
+    std::vector<double> values(cols->broker_num), profits(cols->broker_num);
+    compensated_group_sum(cols->market_value, cols->broker_id, cols->num, values.data(), cols->broker_num);
+    compensated_group_sum(cols->profit, cols->broker_id, cols->num, profits.data(), cols->broker_num);
+    double check = 0;
+    for(int b = 0; b < cols->broker_num; ++b) check += values[b] + profits[b];
+    return check;
+}
+
+template<typename F>
+void run(const char* name, int rounds, size_t fund_num, F&& f)
+{
+    double check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < rounds; ++i){
+        check += f();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() * 1e9 / (rounds * fund_num) << " ns/fund (" << check / rounds << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int fund_num = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const int rounds = 50;
+
+    // a fund lot per broker and snapshot date, sorted by broker as storage sorts them
+    FundPortfolio* funds = nullptr;
+    auto* builder = static_cast<FundsBuilder*>(FundsBuilder::create(fund_num, [&funds](FundsBuilder::Alloc* alloc){
+        funds = FundsBuilder::build(alloc);
+    }));
+    for(int i = 0; i < fund_num; ++i){
+        const double capital = 1000.0 + i % 97;
+        const double value = capital * (0.9 + (i % 13) / 50.0);
+        builder->add_fund("broker" + std::to_string(i * 8 / fund_num), "fund" + std::to_string(i), 1, capital, value, value,
+                          value - capital, (value - capital) / capital, asset_class_ratio{0, 0, 0, 0}, 1600000000 + i % 365 * 86400);
+    }
+    builder->succeed();
+
+    std::cout << fund_num << " funds, 8 brokers:\n";
+    run("sum      , records", rounds, fund_num, [&](){ return legacy_fund_sum(funds).profit; });
+    run("sum      , columns", rounds, fund_num, [&](){ return calc_fund_sum(funds).profit; });
+    run("by broker, records", rounds, fund_num, [&](){ return legacy_group_sum(funds); });
+    run("by broker, columns", rounds, fund_num, [&](){ return group_sum(funds); });
+    free_funds(funds);
+    return 0;
+}
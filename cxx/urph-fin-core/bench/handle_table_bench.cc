@@ -0,0 +1,77 @@
+// Looks assets up by handle from more and more threads, the way Dart isolates and the thread pool call
+// get_overview and get_latest_quote, compares the HandleTable with a std::map behind a mutex, the least
+// the map of handles used before needed to be safe.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "../src/core/handle_table.hxx"
+
+namespace{
+
+struct Assets{
+    long value;
+};
+
+template<typename Find>
+void run(const char* name, int thread_num, int lookups, const std::vector<int>& handles, Find&& find)
+{
+    std::vector<std::thread> threads;
+    std::vector<long> checks(thread_num);
+    auto start = std::chrono::steady_clock::now();
+    for(int t = 0; t < thread_num; ++t){
+        threads.emplace_back([&, t](){
+            long check = 0;
+            for(int i = 0; i < lookups; ++i) check += find(handles[(i + t) % handles.size()]);
+            checks[t] = check;
+        });
+    }
+    for(auto& t: threads) t.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    long check = 0;
+    for(auto c: checks) check += c;
+    std::cout << "  " << name << " " << thread_num << " threads: " << thread_num * lookups / elapsed.count() / 1e6 << " M lookups/s (" << check << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int lookups = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    const int handle_num = 8;
+
+    std::vector<Assets> assets(handle_num);
+    HandleTable<Assets> table;
+    std::map<int, Assets*> map;
+    std::mutex mutex;
+    std::shared_mutex shared_mutex;
+    std::vector<int> handles;
+    for(int i = 0; i < handle_num; ++i){
+        assets[i].value = i;
+        const auto h = table.reserve();
+        table.publish(h, &assets[i]);
+        map[h] = &assets[i];
+        handles.push_back(h);
+    }
+
+    std::cout << lookups << " lookups per thread of " << handle_num << " handles, " << std::thread::hardware_concurrency() << " cores:\n";
+    for(int thread_num: {1, 2, 4, 8}){
+        run("map + mutex       ", thread_num, lookups, handles, [&](int h){
+            std::lock_guard lock(mutex);
+            return map.find(h)->second->value;
+        });
+        run("map + shared_mutex", thread_num, lookups, handles, [&](int h){
+            std::shared_lock lock(shared_mutex);
+            return map.find(h)->second->value;
+        });
+        run("HandleTable       ", thread_num, lookups, handles, [&](int h){
+            return table.find(h)->value;
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Builds the asset / broker / ccy overview of many per-lot items with get_overview, compares it
+// with the nested group_by it replaced, which copied every item into a std::map per level
+// and every name of the result to the heap, and with the result the cache hands out again.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../src/core/stock.hxx"
+#include "../src/core/core_internal.hxx"
+#include "../src/core/overview.hxx"
+
+extern overview* get_overview(AllAssets* assets, const char* main_ccy, GROUP level1_group, GROUP level2_group, GROUP level3_group);
+
+namespace{
+
+template<typename RandomAccessIterator,  typename FieldSelectorUnaryFn>
+auto group_by(RandomAccessIterator _first, RandomAccessIterator _last, const FieldSelectorUnaryFn& fieldChooser)
+{
+    using FieldType = decltype(fieldChooser(*_first));
+    std::map<FieldType, std::vector<typename RandomAccessIterator::value_type>> instancesByField;
+    for(RandomAccessIterator i = _first; i != _last; ++i)
+    {
+        instancesByField[fieldChooser(*i)].push_back(*i);
+    }
+    return instancesByField;
+}
+
+// the type erased key the levels had before
+struct LvlGroup
+{
+    LvlGroup(GROUP g){
+        switch(g){
+        case GROUP_BY_ASSET:  key = [](const AssetItem& a){ return a.asset_type; }; group_name = "Asset"; break;
+        case GROUP_BY_BROKER: key = [](const AssetItem& a){ return a.broker; }; group_name = "Broker"; break;
+        default:              key = [](const AssetItem& a){ return a.currency; }; group_name = "Currency"; break;
+        }
+    }
+    std::string group_name;
+    std::function<Name(const AssetItem&)> key;
+    inline Name operator() (const AssetItem& a) const { return key(a); }
+};
+
+char* heap_str(const std::string_view& s)
+{
+    char* r = new char[s.size() + 1];
+    s.copy(r, s.size());
+    r[s.size()] = '\0';
+    return r;
+}
+
+// what get_overview did before: group_by per level, every name a heap copy
+overview* legacy_overview(AllAssets* assets, const char* main_ccy, GROUP level1_group, GROUP level2_group, GROUP level3_group)
+{
+    auto lvl1 = LvlGroup(level1_group);
+    auto lvl2 = LvlGroup(level2_group);
+    auto lvl3 = LvlGroup(level3_group);
+
+    double lvl1_sum = 0.0, lvl1_sum_profit = 0.0;
+    const auto& lvl1_grp = group_by(assets->items.begin(),assets->items.end(), lvl1);
+    auto* o = new overview{heap_str(lvl1.group_name), 0.0, 0.0, static_cast<int>(lvl1_grp.size()), new overview_item_container_container[lvl1_grp.size()]};
+    int n1 = 0;
+    for(auto& l1: lvl1_grp){
+        const auto& lvl2_grp = group_by(l1.second.begin(),l1.second.end(),lvl2);
+        auto& cc = o->first[n1++];
+        cc = {heap_str(l1.first.view()), heap_str(lvl2.group_name), 0.0, 0.0, static_cast<int>(lvl2_grp.size()), new overview_item_container[lvl2_grp.size()]};
+        double lvl2_sum = 0.0, lvl2_sum_profit = 0.0;
+        int n2 = 0;
+        for(auto& l2: lvl2_grp){
+            auto& c = cc.containers[n2++];
+            c = {heap_str(l2.first.view()), heap_str(lvl3.group_name), 0.0, 0.0, static_cast<int>(l2.second.size()), new overview_item[l2.second.size()]};
+            double sum = 0.0, sum_profit = 0.0;
+            int n3 = 0;
+            for(auto&& l3: l2.second){
+                double main_ccy_value  = assets->to_main_ccy(l3.value, l3.currency.c_str(), main_ccy);
+                double main_ccy_profit = assets->to_main_ccy(l3.profit,l3.currency.c_str(), main_ccy);
+                c.items[n3++] = {heap_str(lvl3.key(l3).view()), heap_str(l3.currency.view()), l3.value, main_ccy_value, l3.profit, main_ccy_profit};
+                sum += main_ccy_value;
+                sum_profit += main_ccy_profit;
+            }
+            c.value_sum_in_main_ccy = sum;
+            c.profit_sum_in_main_ccy = sum_profit;
+            lvl2_sum += sum;
+            lvl2_sum_profit += sum_profit;
+        }
+        cc.value_sum_in_main_ccy = lvl2_sum;
+        cc.profit_sum_in_main_ccy = lvl2_sum_profit;
+        lvl1_sum += lvl2_sum;
+        lvl1_sum_profit += lvl2_sum_profit;
+    }
+    o->value_sum_in_main_ccy = lvl1_sum;
+    o->profit_sum_in_main_ccy = lvl1_sum_profit;
+    return o;
+}
+
+void free_legacy_overview(overview* o)
+{
+    for(int i = 0; i < o->num; ++i){
+        auto& cc = o->first[i];
+        for(int j = 0; j < cc.num; ++j){
+            auto& c = cc.containers[j];
+            for(int k = 0; k < c.num; ++k){
+                delete[] c.items[k].name;
+                delete[] c.items[k].currency;
+            }
+            delete[] c.items;
+            delete[] c.name;
+            delete[] c.item_name;
+        }
+        delete[] cc.containers;
+        delete[] cc.name;
+        delete[] cc.item_name;
+    }
+    delete[] o->first;
+    delete[] o->item_name;
+    delete o;
+}
+
+template<typename F, typename Free>
+void run(const char* name, int rounds, F&& f, Free&& free)
+{
+    // best round, the others are mostly noise of the machine
+    double best = 1e9, check = 0;
+    for(int i = 0; i < rounds; ++i){
+        auto start = std::chrono::steady_clock::now();
+        auto* o = f();
+        check = o->value_sum_in_main_ccy;
+        free(o);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    std::cout << "  " << name << ": " << best * 1e3 << " ms (" << check << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int item_num = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const int rounds = 20;
+
+    Quote usd_jpy("USDJPY=X", 0, 150.0), hkd_jpy("HKDJPY=X", 0, 19.0);
+    QuoteBySymbol quote_by_symbol([](::quotes*){});
+    quote_by_symbol.add(&usd_jpy);
+    quote_by_symbol.add(&hkd_jpy);
+    AllAssets assets(quote_by_symbol, nullptr, nullptr, nullptr);
+
+    const char* types[] = {"Stock&ETF", "Funds", "Cash"};
+    const char* ccys[] = {"JPY", "USD", "HKD"};
+    for(int i = 0; i < item_num; ++i){
+        assets.items.emplace_back(types[i % 3], "broker" + std::to_string(i % 20), ccys[i / 3 % 3], 1000.0 + i % 101, 10.0 + i % 7);
+    }
+
+    std::cout << item_num << " items, asset / broker / ccy:\n";
+    run("group_by  ", rounds, [&](){ return legacy_overview(&assets, "JPY", GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY); }, free_legacy_overview);
+    run("one pass  ", rounds, [&](){ return OverviewAggregator(assets, "JPY").overview(GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY); }, free_overview);
+    run("cached    ", rounds, [&](){ return get_overview(&assets, "JPY", GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY); }, free_overview);
+    return 0;
+}
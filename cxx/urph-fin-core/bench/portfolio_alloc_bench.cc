@@ -0,0 +1,152 @@
+// Builds and frees a stock portfolio of many stocks and tx, compares the arena the builders
+// allocate their result in with the heap allocated structs and strings they used before.
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/storage/storage.hxx"
+
+namespace{
+
+struct tx_data{
+    std::string broker;
+    std::string side;
+    double price;
+    double shares;
+    timestamp date;
+};
+
+struct stock_data{
+    std::string symbol;
+    std::string ccy;
+    std::vector<tx_data> txs;
+};
+
+char* heap_str(const std::string& s)
+{
+    auto* p = new char[s.size() + 1];
+    std::memcpy(p, s.c_str(), s.size() + 1);
+    return p;
+}
+
+// both sides build the graph the way StockPortfolioBuilder does, minus its symbol lookups
+
+// the structs and strings each in their own new[], a delete[] for each of them when freed
+size_t heap_build_and_free(const std::vector<stock_data>& stocks)
+{
+    PlacementNew<stock> stock_alloc(stocks.size());
+    std::vector<PlacementNew<stock_tx>*> tx_allocs;
+    for(const auto& s: stocks){
+        auto* st = stock_alloc.next();
+        st->symbol = heap_str(s.symbol);
+        st->currency = heap_str(s.ccy);
+        st->asset_class_ratios = {0,0,0,0};
+        auto* tx_alloc = new PlacementNew<stock_tx>(s.txs.size());
+        for(const auto& t: s.txs){
+            auto* tx = tx_alloc->next();
+            tx->broker = heap_str(t.broker);
+            tx->side = t.side == "BUY" ? BUY : SELL;
+            tx->price = t.price;
+            tx->shares = t.shares;
+            tx->fee = 0;
+            tx->date = t.date;
+        }
+        tx_allocs.push_back(tx_alloc);
+    }
+    auto* head = new stock_with_tx[stocks.size()];
+    for(size_t i = 0; i < stocks.size(); ++i){
+        head[i].instrument = stock_alloc.head() + i;
+        head[i].tx_list = new StockTxList(tx_allocs[i]->allocated_num(), tx_allocs[i]->head());
+    }
+
+    size_t check = 0;
+    for(size_t i = 0; i < stocks.size(); ++i){
+        auto* s = head[i].instrument;
+        check += std::strlen(s->symbol);
+        delete []s->symbol;
+        delete []s->currency;
+        for(auto& t: *static_cast<StockTxList*>(head[i].tx_list)){
+            check += std::strlen(t.broker);
+            delete []t.broker;
+        }
+        delete []head[i].tx_list->first_tx;
+        delete static_cast<StockTxList*>(head[i].tx_list);
+        delete tx_allocs[i];
+    }
+    delete []stock_alloc.head();
+    delete []head;
+    return check;
+}
+
+// everything bumped in one arena, released at once
+size_t arena_build_and_free(const std::vector<stock_data>& stocks)
+{
+    Arena* arena = Arena::create();
+    ArenaArray<stock> stock_alloc(*arena, stocks.size());
+    std::vector<ArenaArray<stock_tx>*> tx_allocs;
+    for(const auto& s: stocks){
+        new (stock_alloc.next()) Stock(s.symbol, s.ccy, asset_class_ratio{0,0,0,0});
+        auto* tx_alloc = new ArenaArray<stock_tx>(*arena, s.txs.size());
+        for(const auto& t: s.txs){
+            new (tx_alloc->next()) StockTx(t.broker, t.shares, t.price, 0, t.side, t.date);
+        }
+        tx_allocs.push_back(tx_alloc);
+    }
+    auto* head = arena->allocate_array<stock_with_tx>(stocks.size());
+    auto* lists = arena->allocate_array<stock_tx_list>(stocks.size());
+    for(size_t i = 0; i < stocks.size(); ++i){
+        head[i].instrument = stock_alloc.head() + i;
+        head[i].tx_list = new (lists + i) StockTxList(tx_allocs[i]->allocated_num(), tx_allocs[i]->head());
+        delete tx_allocs[i];
+    }
+    auto* portfolio = arena->create_owner<StockPortfolio>(stocks.size(), stock_alloc.head(), head);
+
+    size_t check = 0;
+    for(const auto& stx: *portfolio){
+        check += std::strlen(stx.instrument->symbol);
+        for(const auto& t: *static_cast<StockTxList*>(stx.tx_list)){
+            check += std::strlen(t.broker);
+        }
+    }
+    release_owner(portfolio);
+    return check;
+}
+
+template<typename F>
+void run(const char* name, int rounds, size_t tx_num, F&& f)
+{
+    size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < rounds; ++i){
+        check += f();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() * 1e9 / (rounds * tx_num) << " ns/tx (" << check % 1000 << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int stock_num = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int tx_per_stock = argc > 2 ? std::atoi(argv[2]) : 20;
+    const int rounds = 20;
+
+    std::vector<stock_data> stocks(stock_num);
+    for(int i = 0; i < stock_num; ++i){
+        stocks[i].symbol = "SYM" + std::to_string(i);
+        stocks[i].ccy = i % 2 ? "USD" : "JPY";
+        for(int j = 0; j < tx_per_stock; ++j){
+            stocks[i].txs.push_back({"broker" + std::to_string(j % 3), j % 4 ? "BUY" : "SELL", 100.0 + j, 10.0, 1600000000 + j * 86400});
+        }
+    }
+
+    const size_t tx_num = static_cast<size_t>(stock_num) * tx_per_stock;
+    std::cout << stock_num << " stocks, " << tx_num << " tx, build + free:\n";
+    run("heap ", rounds, tx_num, [&](){ return heap_build_and_free(stocks); });
+    run("arena", rounds, tx_num, [&](){ return arena_build_and_free(stocks); });
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Loads the latest quotes of a portfolio sized symbol list from the local
+// stand-in server, one request per symbol against batched requests.
+// The stand-in answers after a delay standing for the round-trip to Yahoo.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../mkt-data-src/yahoo-finance/batch_quote.hpp"
+#include "../mkt-data-src/yahoo-finance/curl_utils.hpp"
+#include "../mkt-data-src/yahoo-finance/fetch_engine.hpp"
+#include "../mkt-data-src/yahoo-finance/quote.hpp"
+#include "../test/http_stand_in.hxx"
+
+namespace{
+
+template<typename F>
+void run(const char* name, const HttpStandIn& server, F&& load)
+{
+    const auto requests = server.nb_requests();
+    auto start = std::chrono::steady_clock::now();
+    const size_t quotes = load();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() * 1e3 << " ms, " << server.nb_requests() - requests
+              << " requests, " << quotes << " quotes\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int nb_symbols = argc > 1 ? std::atoi(argv[1]) : 150;
+    const int latency_ms = argc > 2 ? std::atoi(argv[2]) : 50;
+    const size_t in_flight = 8;
+
+    HttpStandIn server(yahoo_stand_in, std::chrono::milliseconds(latency_ms));
+    if(!server.running()){
+        std::cerr << "cannot start the stand-in server\n";
+        return 1;
+    }
+    setenv("YAHOO_FINANCE_BASE_URL", server.base_url().c_str(), 1);
+
+    std::vector<std::string> symbols;
+    for(int i = 0; i < nb_symbols; ++i) symbols.push_back("SYM" + std::to_string(i));
+    std::cout << nb_symbols << " symbols, " << latency_ms << " ms per response, " << in_flight << " transfers in flight\n";
+
+    run("one request per symbol", server, [&](){
+        YahooFinance::FetchEngine engine(in_flight);
+        for(const auto& s: symbols) engine.add({s, 0, 0, "1d"});
+        size_t quotes = 0;
+        engine.run([&](size_t i, std::string&& csv){
+            YahooFinance::Quote q(symbols[i]);
+            q.parseHistoricalCsv(csv);
+            if(q.nbSpots() > 0) ++quotes;
+        });
+        return quotes;
+    });
+
+    for(size_t batch: {10, 50, 100}){
+        const std::string name = "batches of " + std::to_string(batch);
+        run(name.c_str(), server, [&](){
+            YahooFinance::FetchEngine engine(in_flight);
+            for(const auto& b: YahooFinance::makeBatches(symbols, batch)) engine.add({"", 0, 0, "", yahooQuoteUrl(b)});
+            std::vector<YahooFinance::LatestPrice> prices;
+            engine.run([&](size_t, std::string&& json){ YahooFinance::parseBatchQuote(json, prices); });
+            return prices.size();
+        });
+    }
+    return 0;
+}
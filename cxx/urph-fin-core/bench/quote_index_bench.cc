@@ -0,0 +1,52 @@
+// Looks up the quotes of a portfolio by const char* symbol the way get_price and get_latest_quote do,
+// compares the QuoteIndex they use now with the std::unordered_map<std::string> they used before,
+// which needed a std::string built for every lookup.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/core/urph-fin-core.hxx"
+
+namespace{
+
+template<typename F>
+void run(const char* name, int rounds, const std::vector<const char*>& symbols, F&& find)
+{
+    double check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < rounds; ++i){
+        for(auto* s: symbols) check += find(s)->rate;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() * 1e9 / (rounds * symbols.size()) << " ns/lookup (" << check / rounds << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int quote_num = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int rounds = 200;
+
+    // stock symbols the length yahoo finance uses, longer than the std::string small buffer with the suffix
+    std::vector<Quote> quotes;
+    quotes.reserve(quote_num);
+    for(int i = 0; i < quote_num; ++i) quotes.emplace_back("STOCK" + std::to_string(i) + ".EXCHANGE", 0, i);
+
+    std::unordered_map<std::string, const Quote*> mapping;
+    QuoteIndex index;
+    std::vector<const char*> symbols;
+    for(const auto& q: quotes){
+        mapping[q.symbol] = &q;
+        index.add(q.symbol, &q);
+        symbols.push_back(q.symbol);
+    }
+
+    std::cout << quote_num << " quotes:\n";
+    run("unordered_map", rounds, symbols, [&](const char* s){ return mapping.find(std::string(s))->second; });
+    run("QuoteIndex   ", rounds, symbols, [&](const char* s){ return index.find(s); });
+    return 0;
+}
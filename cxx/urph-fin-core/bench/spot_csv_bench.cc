@@ -0,0 +1,98 @@
+// Parses the multi-year fixture files over and over, compares the
+// string_view parser with the istringstream/getline one it replaced.
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../mkt-data-src/yahoo-finance/quote.hpp"
+#include "../mkt-data-src/yahoo-finance/spot_csv.hpp"
+#include "../mkt-data-src/yahoo-finance/time_utils.hpp"
+
+namespace{
+
+std::string read_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// the parser Quote::getHistoricalSpots used before, as the baseline
+size_t legacy_parse(const std::string& csv, std::vector<YahooFinance::Spot>& spots)
+{
+    std::istringstream csvStream(csv);
+    std::string line;
+    std::getline(csvStream, line);
+    while (std::getline(csvStream, line)) {
+        std::vector<std::string> spotVector;
+        std::stringstream iss(line);
+        std::string lineItem;
+        while (std::getline(iss, lineItem, ',')) {
+            spotVector.push_back(lineItem);
+        }
+        if (spotVector.size() >= 5 && spotVector[0] != "null" && spotVector[1] != "null") {
+            spots.emplace_back(spotVector[0], std::atof(spotVector[1].c_str()), std::atof(spotVector[2].c_str()),
+                               std::atof(spotVector[3].c_str()), std::atof(spotVector[4].c_str()));
+        }
+    }
+    return spots.size();
+}
+
+template<typename F>
+void run(const char* name, const std::string& csv, int iterations, F&& parse)
+{
+    size_t rows = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i){
+        rows += parse(csv);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double mb = (double)csv.size() * iterations / (1024 * 1024);
+    std::cout << "  " << name << ": " << elapsed.count() * 1e3 / iterations << " ms/file, "
+              << elapsed.count() * 1e9 / rows << " ns/row, " << mb / elapsed.count() << " MB/s\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    const char* fixtures[] = {"daily_10y_equity.csv", "daily_5y_fx.csv"};
+
+    for(auto f: fixtures){
+        const std::string csv = read_file(std::string(FIXTURE_DIR) + "/" + f);
+        std::cout << f << " (" << csv.size() << " bytes, " << iterations << " iterations)\n";
+
+        run("istringstream", csv, iterations, [](const std::string& csv){
+            std::vector<YahooFinance::Spot> spots;
+            return legacy_parse(csv, spots);
+        });
+        run("parseSpotsCsv", csv, iterations, [](const std::string& csv){
+            double sum = 0.0;
+            auto n = YahooFinance::parseSpotsCsv(csv, [&sum](std::time_t, double, double, double, double close){ sum += close; });
+            return sum > 0 ? n : 0;
+        });
+        run("SpotCsvStream, 16 KB chunks", csv, iterations, [](const std::string& csv){
+            // what the curl write callback gets
+            YahooFinance::SpotCsvStream stream;
+            double sum = 0.0;
+            auto on_spot = [&sum](std::time_t, double, double, double, double close){ sum += close; };
+            for(size_t pos = 0; pos < csv.size(); pos += 16384){
+                stream.feed(std::string_view(csv).substr(pos, 16384), on_spot);
+            }
+            stream.finish(on_spot);
+            return sum > 0 ? stream.nbSpots() : 0;
+        });
+        run("Quote::parseHistoricalCsv", csv, iterations, [](const std::string& csv){
+            YahooFinance::Quote q("BENCH");
+            q.parseHistoricalCsv(csv);
+            return q.nbSpots();
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Values a long tx history with StockTxList::calc, compares it with the calc it replaced,
+// which copied the tx to a vector, sorted them and kept the unclosed positions in a deque.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "../src/core/stock.hxx"
+
+namespace{
+
+struct UnclosedPosition{
+    double price;
+    double shares;
+    double fee;
+};
+
+// what StockTxList::calc did before, splits left out as the history has none
+stock_balance legacy_calc(StockTxList& list)
+{
+    auto unclosed_positions = std::deque<UnclosedPosition>();
+    stock_balance balance = {0.0, 0.0, 0.0, 0.0};
+
+    std::vector<StockTx*> trades;
+    for(auto it = list.ptr_begin(); it != list.ptr_end(); ++it) trades.push_back(*it);
+    std::sort(trades.begin(), trades.end(), [](StockTx* tx1, StockTx*tx2){ return tx1->date < tx2->date; });
+
+    for(StockTx* tx: trades){
+        balance.fee += tx->fee;
+        auto s = tx->side == BUY ? tx->shares : -tx->shares;
+        balance.shares += s;
+        balance.liquidated -= tx->price * s;
+        if(s > 0){
+            unclosed_positions.push_back({tx->price, tx->shares, tx->fee});
+        }
+        else{
+            for(auto shares = tx->shares; shares > 0;){
+                if(unclosed_positions.empty()){
+                    const double n = std::nan("");
+                    return {n, n, n, n};
+                }
+                auto& first = unclosed_positions.front();
+                if(first.shares > shares){
+                    first.shares -= shares;
+                    shares = 0;
+                }
+                else{
+                    shares -= first.shares;
+                    unclosed_positions.pop_front();
+                }
+            }
+        }
+    }
+    auto r = std::accumulate(unclosed_positions.begin(), unclosed_positions.end(), UnclosedPosition{0.0, 0.0, 0.0},
+        [](UnclosedPosition& a, UnclosedPosition& x){
+            a.fee += x.fee;
+            a.price += x.price * x.shares;
+            a.shares += x.shares;
+            return a;
+        }
+    );
+    balance.vwap = r.shares == 0 ? 0 : r.price / r.shares;
+    return balance;
+}
+
+template<typename F>
+void run(const char* name, int rounds, size_t tx_num, F&& f)
+{
+    double check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < rounds; ++i){
+        check += f().vwap;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() * 1e9 / (rounds * tx_num) << " ns/tx (" << check / rounds << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int tx_num = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const int rounds = 50;
+
+    // sorted by date as the builders lay them out: buys with a partial sell every third day
+    std::vector<stock_tx> txs(tx_num);
+    for(int i = 0; i < tx_num; ++i){
+        const bool sell = i % 3 == 2;
+        txs[i] = stock_tx{"broker", 1.0, sell ? 15.0 : 10.0, 100.0 + i % 50, sell ? SELL : BUY, 1600000000 + i * 86400};
+    }
+    StockTxList list(tx_num, txs.data());
+
+    std::cout << tx_num << " tx:\n";
+    run("copy + sort + deque", rounds, tx_num, [&](){ return legacy_calc(list); });
+    run("sorted + ring      ", rounds, tx_num, [&](){ return list.calc(); });
+    return 0;
+}
@@ -38,6 +38,7 @@ extern "C" {
 #include <ctime>
 
 #include "../utils.hxx"
+#include "../civil_date.hxx"
 
 #include "../core/urph-fin-core.hxx"
 #include "storage.hxx"
@@ -421,10 +422,9 @@ public:
     {
         const auto& stock = _firestore->Collection(COLLECTION_INSTRUMENTS).Document(std::string(symbol));
         const auto& tx = stock.Collection(FirestoreDao::COLLECTION_TX);
-        const auto tm = gmtime(&date);
-        char yyyymmdd[10];
-        strftime(yyyymmdd,sizeof(yyyymmdd)/sizeof(char), "%Y%m%d", tm);    
-        tx.Document(std::string(yyyymmdd)).Set(
+        char yyyymmdd[civil::COMPACT_DATE_LEN];
+        civil::format_compact_date(date, yyyymmdd);
+        tx.Document(std::string(yyyymmdd, civil::COMPACT_DATE_LEN)).Set(
             {
                 {"instrument_id", FieldValue::String(symbol)},
                 {"broker", FieldValue::String(broker)},
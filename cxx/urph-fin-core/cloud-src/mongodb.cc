@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "../src/utils.hxx"
+#include "../src/civil_date.hxx"
 #include "bsoncxx/document/view.hpp"
 #include "core/stock.hxx"
 #include "mongocxx/cursor.hpp"
@@ -88,17 +89,9 @@ namespace{
     }
 
     std::string formatUnixEpochToYYYYMMDD(const char* prefix , int64_t epoch) {
-        // Convert Unix epoch to time_t
-        std::time_t time = static_cast<time_t>(epoch);
-
-        // Convert time_t to tm struct
-        std::tm* tm_ptr = std::gmtime(&time);
-
-        // Use stringstream for formatting
-        std::stringstream ss;
-        ss << prefix << std::put_time(tm_ptr, "%Y%m%d");
-
-        return ss.str();
+        char yyyymmdd[civil::COMPACT_DATE_LEN];
+        civil::format_compact_date(epoch, yyyymmdd);
+        return std::string(prefix).append(yyyymmdd, civil::COMPACT_DATE_LEN);
     }
 
     class logger final : public mongocxx::logger {
@@ -0,0 +1,201 @@
+#include "batch_quote.hpp"
+#include "spot_csv.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string_view>
+
+namespace YahooFinance{
+
+namespace {
+
+    /**
+     * @brief Forward only JSON reader, just enough to walk a quote response
+     */
+    class JsonScanner {
+
+    public:
+
+        explicit JsonScanner(const std::string& json) : p(json.data()), end(json.data() + json.size()) {}
+
+        bool consume(char c) {
+            this->skipSpaces();
+            if (this->p < this->end && *this->p == c) {
+                ++this->p;
+                return true;
+            }
+            return false;
+        }
+
+        bool string(std::string& s) {
+            s.clear();
+            if (!this->consume('"')) {
+                return false;
+            }
+            while (this->p < this->end && *this->p != '"') {
+                if (*this->p == '\\') {
+                    // symbols are plain ASCII, keep the escaped character as is
+                    if (++this->p == this->end) {
+                        return false;
+                    }
+                }
+                s += *this->p++;
+            }
+            return this->p++ < this->end;
+        }
+
+        bool number(double& d) {
+            this->skipSpaces();
+            // the characters a JSON number can have, parseDouble rejects a malformed one
+            const char *last = this->p;
+            while (last < this->end && (std::isdigit(static_cast<unsigned char>(*last)) || std::string_view("+-.eE").find(*last) != std::string_view::npos)) {
+                ++last;
+            }
+            if (!parseDouble(std::string_view(this->p, last - this->p), d)) {
+                return false;
+            }
+            this->p = last;
+            return true;
+        }
+
+        /**
+         * @brief Skip any value, including nested objects and arrays
+         */
+        bool skipValue() {
+            this->skipSpaces();
+            if (this->p == this->end) {
+                return false;
+            }
+            std::string ignored;
+            switch (*this->p) {
+            case '"':
+                return this->string(ignored);
+            case '{':
+            case '[': {
+                int depth = 0;
+                do {
+                    if (*this->p == '"') {
+                        if (!this->string(ignored)) {
+                            return false;
+                        }
+                        continue;
+                    }
+                    if (*this->p == '{' || *this->p == '[') {
+                        ++depth;
+                    }
+                    else if (*this->p == '}' || *this->p == ']') {
+                        --depth;
+                    }
+                    ++this->p;
+                } while (depth > 0 && this->p < this->end);
+                return depth == 0;
+            }
+            default:
+                // number, true, false or null
+                while (this->p < this->end && std::strchr(",}] \t\r\n", *this->p) == nullptr) {
+                    ++this->p;
+                }
+                return true;
+            }
+        }
+
+        /**
+         * @brief Walk the members of an object
+         * @param onMember Called with each key, must read or skip the value
+         */
+        template<typename F>
+        bool object(F&& onMember) {
+            if (!this->consume('{')) {
+                return false;
+            }
+            if (this->consume('}')) {
+                return true;
+            }
+            std::string key;
+            do {
+                if (!this->string(key) || !this->consume(':') || !onMember(key)) {
+                    return false;
+                }
+            } while (this->consume(','));
+            return this->consume('}');
+        }
+
+    private:
+
+        void skipSpaces() {
+            while (this->p < this->end && std::strchr(" \t\r\n", *this->p) != nullptr) {
+                ++this->p;
+            }
+        }
+
+        const char *p;
+        const char *end;
+    };
+
+    bool parseResult(JsonScanner& json, std::vector<LatestPrice>& prices) {
+        if (!json.consume('[')) {
+            return json.skipValue();
+        }
+        if (json.consume(']')) {
+            return true;
+        }
+        do {
+            LatestPrice price;
+            bool hasPrice = false;
+            bool ok = json.object([&](const std::string& key) {
+                double d;
+                if (key == "symbol") {
+                    return json.string(price.symbol);
+                }
+                if (key == "regularMarketPrice" && json.number(d)) {
+                    price.price = d;
+                    hasPrice = true;
+                    return true;
+                }
+                if (key == "regularMarketTime" && json.number(d)) {
+                    price.time = (std::time_t)d;
+                    return true;
+                }
+                return json.skipValue();
+            });
+            if (!ok) {
+                return false;
+            }
+            if (hasPrice && !price.symbol.empty()) {
+                prices.push_back(std::move(price));
+            }
+        } while (json.consume(','));
+        return json.consume(']');
+    }
+}
+
+bool parseBatchQuote(const std::string& json, std::vector<LatestPrice>& prices) {
+    JsonScanner scanner(json);
+    bool isQuoteResponse = false;
+    bool ok = scanner.object([&](const std::string& key) {
+        if (key != "quoteResponse") {
+            return scanner.skipValue();
+        }
+        isQuoteResponse = true;
+        return scanner.object([&](const std::string& key) {
+            return key == "result" ? parseResult(scanner, prices) : scanner.skipValue();
+        });
+    });
+    return ok && isQuoteResponse;
+}
+
+std::vector<std::vector<std::string>> makeBatches(const std::vector<std::string>& symbols, size_t batchSize) {
+    if (batchSize == 0) {
+        batchSize = 1;
+    }
+    std::vector<std::vector<std::string>> batches;
+    batches.reserve((symbols.size() + batchSize - 1) / batchSize);
+    for (size_t i = 0; i < symbols.size(); i += batchSize) {
+        auto last = std::min(symbols.size(), i + batchSize);
+        batches.emplace_back(symbols.begin() + i, symbols.begin() + last);
+    }
+    return batches;
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef BATCH_QUOTE_HPP
+#define BATCH_QUOTE_HPP
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace YahooFinance{
+
+/**
+ * @brief Latest price of one symbol in a batched quote response
+ */
+struct LatestPrice {
+    std::string symbol;
+    std::time_t time = 0;
+    double price = 0.0;
+};
+
+/**
+ * @brief Read the latest prices of a batched quote response
+ *
+ * Only looks at the symbol, regularMarketPrice and regularMarketTime of
+ * every object of quoteResponse.result, everything else is skipped.
+ * @param json Response body of yahooQuoteUrl()
+ * @param prices Prices appended to, symbols without price are left out
+ * @return False if the response is not a quote response
+ */
+bool parseBatchQuote(const std::string& json, std::vector<LatestPrice>& prices);
+
+/**
+ * @brief Split symbols in batches of one request each
+ * @param symbols Symbols to split
+ * @param batchSize Max number of symbols per batch
+ * @return Batches, in the order of symbols
+ */
+std::vector<std::vector<std::string>> makeBatches(const std::vector<std::string>& symbols, size_t batchSize);
+
+}
+#endif /* BATCH_QUOTE_HPP */
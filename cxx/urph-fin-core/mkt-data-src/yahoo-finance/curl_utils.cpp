@@ -1,9 +1,54 @@
 #include "curl_utils.hpp"
 #include "time_utils.hpp"
 
-#include <curl/curl.h>
+#include <cctype>
+#include <cstdlib>
+#include <mutex>
 #include <sstream>
 
+namespace {
+    /**
+     * @brief One mutex per kind of data in the share handle
+     */
+    std::mutex shareMutexes[CURL_LOCK_DATA_LAST];
+
+    void lockShare(CURL *, curl_lock_data data, curl_lock_access, void *) {
+        shareMutexes[data].lock();
+    }
+
+    void unlockShare(CURL *, curl_lock_data data, void *) {
+        shareMutexes[data].unlock();
+    }
+
+    const char DEFAULT_BASE_URL[] = "https://query1.finance.yahoo.com";
+
+    /**
+     * @brief Percent encode a query parameter, symbols like "USDJPY=X" or "^N225" need it
+     */
+    std::string escapeQuery(const std::string& s) {
+        static const char hex[] = "0123456789ABCDEF";
+        std::string escaped;
+        escaped.reserve(s.size());
+        for (unsigned char c: s) {
+            if (std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+                escaped += c;
+            }
+            else {
+                escaped += '%';
+                escaped += hex[c >> 4];
+                escaped += hex[c & 0xf];
+            }
+        }
+        return escaped;
+    }
+
+    double seconds(CURL *curl, CURLINFO info) {
+        curl_off_t us = 0;
+        curl_easy_getinfo(curl, info, &us);
+        return us / 1e6;
+    }
+}
+
 size_t writeCallback(char *content, size_t size, size_t nmemb, void *userdata) {
     // Append the content to user data
     ((std::string*)userdata)->append(content, size * nmemb);
@@ -12,41 +57,180 @@ size_t writeCallback(char *content, size_t size, size_t nmemb, void *userdata) {
     return size * nmemb;
 }
 
-std::string downloadYahooCsv(
-    std::string symbol,
+size_t chunkCallback(char *content, size_t size, size_t nmemb, void *userdata) {
+    (*(const OnChunk*)userdata)(content, size * nmemb);
+    return size * nmemb;
+}
+
+std::string yahooBaseUrl() {
+    const char *url = std::getenv("YAHOO_FINANCE_BASE_URL");
+    return url != nullptr && *url != '\0' ? url : DEFAULT_BASE_URL;
+}
+
+std::string yahooCsvUrl(
+    const std::string& symbol,
     std::time_t period1,
     std::time_t period2,
-    std::string interval
+    const std::string& interval
 ) {
     std::stringstream ss1; 
     ss1 << period1; 
     std::stringstream ss2; 
     ss2 << period2;
 
-    std::string url = "https://query1.finance.yahoo.com/v7/finance/download/"
+    return yahooBaseUrl()
+            + "/v7/finance/download/"
             + symbol
             + "?period1=" + ss1.str()
             + "&period2=" + ss2.str()
             + "&interval=" + interval
             + "&events=history";
+}
 
-    CURL* curl = curl_easy_init();
-    std::string responseBuffer;
+std::string yahooQuoteUrl(const std::vector<std::string>& symbols) {
+    std::string url = yahooBaseUrl() + "/v7/finance/quote?symbols=";
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        if (i > 0) {
+            url += "%2C";
+        }
+        url += escapeQuery(symbols[i]);
+    }
+    return url + "&fields=symbol,regularMarketPrice,regularMarketTime";
+}
+
+CURLSH* sharedCurlCache() {
+    static CURLSH *share = []() {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        CURLSH *s = curl_share_init();
+        curl_share_setopt(s, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(s, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(s, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(s, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(s, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        return s;
+    }();
+    return share;
+}
 
-    if (curl) {
+namespace {
+    void setCommonOptions(CURL *curl, const std::string& url, const RequestTimeouts& timeouts) {
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
         curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/4.0 (compatible; MSIE 6.0; Windows NT 5.2; .NET CLR 1.0.3705;)");
 
-        // Write result into the buffer
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseBuffer);
+        // Reuse DNS results, connections and TLS sessions across requests and threads
+        curl_easy_setopt(curl, CURLOPT_SHARE, sharedCurlCache());
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        // Empty string means every encoding libcurl was built with (gzip, deflate ...)
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
 
-        // Perform the request
-        CURLcode res = curl_easy_perform(curl);
+        // A server that stops answering fails the transfer instead of hanging it
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)timeouts.connect.count());
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)timeouts.total.count());
+        // Timeouts must not raise signals in the worker threads
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    }
+}
+
+void prepareYahooRequest(CURL *curl, const std::string& url, std::string *responseBuffer, const RequestTimeouts& timeouts) {
+    setCommonOptions(curl, url, timeouts);
+
+    // Write result into the buffer
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, responseBuffer);
+}
+
+void prepareYahooRequest(CURL *curl, const std::string& url, const OnChunk *onChunk, const RequestTimeouts& timeouts) {
+    setCommonOptions(curl, url, timeouts);
+
+    // Pass every chunk on as it arrives
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, chunkCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, onChunk);
+}
 
-        // Cleanup
-        curl_easy_cleanup(curl);
+TransferStats collectTransferStats(CURL *curl, CURLcode result) {
+    TransferStats stats;
+    const char *url = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    stats.url = url == nullptr ? "" : url;
+    stats.ok = result == CURLE_OK;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &stats.httpCode);
+
+    long newConnections = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnections);
+    stats.reusedConnection = newConnections == 0;
+
+    stats.dns = seconds(curl, CURLINFO_NAMELOOKUP_TIME_T);
+    stats.connect = seconds(curl, CURLINFO_CONNECT_TIME_T);
+    stats.tls = seconds(curl, CURLINFO_APPCONNECT_TIME_T);
+    stats.firstByte = seconds(curl, CURLINFO_STARTTRANSFER_TIME_T);
+    stats.total = seconds(curl, CURLINFO_TOTAL_TIME_T);
+
+    curl_off_t bytes = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+    stats.bytes = bytes;
+    return stats;
+}
+
+TransferContext& TransferContext::current() {
+    thread_local TransferContext context;
+    return context;
+}
+
+TransferContext::TransferContext() {
+    sharedCurlCache();
+    this->curl = curl_easy_init();
+}
+
+TransferContext::~TransferContext() {
+    if (this->curl) {
+        curl_easy_cleanup(this->curl);
+    }
+}
+
+std::string TransferContext::get(const std::string& url, TransferStats *stats, const RequestTimeouts& timeouts) {
+    std::string responseBuffer;
+    if (!this->curl) {
+        return responseBuffer;
+    }
+
+    // reset keeps the live connections and the DNS cache of the handle
+    curl_easy_reset(this->curl);
+    prepareYahooRequest(this->curl, url, &responseBuffer, timeouts);
+
+    // Perform the request
+    CURLcode res = curl_easy_perform(this->curl);
+
+    if (stats != nullptr) {
+        *stats = collectTransferStats(this->curl, res);
     }
 
+    if (res != CURLE_OK) {
+        responseBuffer.clear();
+    }
     return responseBuffer;
 }
+
+bool TransferContext::stream(const std::string& url, const OnChunk& onChunk, TransferStats *stats, const RequestTimeouts& timeouts) {
+    if (!this->curl) {
+        return false;
+    }
+
+    curl_easy_reset(this->curl);
+    prepareYahooRequest(this->curl, url, &onChunk, timeouts);
+    CURLcode res = curl_easy_perform(this->curl);
+
+    if (stats != nullptr) {
+        *stats = collectTransferStats(this->curl, res);
+    }
+    return res == CURLE_OK;
+}
+
+std::string downloadYahooCsv(
+    std::string symbol,
+    std::time_t period1,
+    std::time_t period2,
+    std::string interval
+) {
+    std::string url = yahooCsvUrl(symbol, period1, period2, interval);
+    return TransferContext::current().get(url);
+}
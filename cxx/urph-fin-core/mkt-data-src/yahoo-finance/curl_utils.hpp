@@ -2,7 +2,47 @@
 #define CURL_UTILS_HPP
 
 #include <string>
+#include <chrono>
 #include <ctime>
+#include <functional>
+#include <vector>
+#include <curl/curl.h>
+
+/**
+ * @brief Timings of one transfer, in seconds since the transfer started
+ */
+struct TransferStats {
+    std::string url;
+    bool ok = false;
+    long httpCode = 0;
+    /**
+     * @brief True if no new connection had to be opened
+     */
+    bool reusedConnection = false;
+    double dns = 0;
+    double connect = 0;
+    double tls = 0;
+    double firstByte = 0;
+    double total = 0;
+    /**
+     * @brief Downloaded body bytes
+     */
+    long long bytes = 0;
+};
+
+/**
+ * @brief Time limits of every Yahoo Finance request, a stalled server would block the caller forever without them
+ */
+struct RequestTimeouts {
+    /**
+     * @brief Max time to resolve the host and connect
+     */
+    std::chrono::milliseconds connect{10000};
+    /**
+     * @brief Max time of the whole transfer
+     */
+    std::chrono::milliseconds total{30000};
+};
 
 /**
  * @brief Write callback function for Curl
@@ -14,6 +54,135 @@
  */
 size_t writeCallback(char *content, size_t size, size_t nmemb, void *userdata);
 
+/**
+ * @brief Receives the response body of a streamed transfer as it arrives
+ * @param data Next bytes of the body
+ * @param size Number of bytes
+ */
+typedef std::function<void(const char *data, size_t size)> OnChunk;
+
+/**
+ * @brief Write callback function for Curl passing every chunk on
+ * @param content Deliver content pointer
+ * @param size Content element bytes size
+ * @param nmemb Number of content element
+ * @param userdata OnChunk called with the content
+ * @return Real buffer size = size * nmemb
+ */
+size_t chunkCallback(char *content, size_t size, size_t nmemb, void *userdata);
+
+/**
+ * @brief Yahoo Finance server every URL points to
+ * @return $YAHOO_FINANCE_BASE_URL or https://query1.finance.yahoo.com
+ */
+std::string yahooBaseUrl();
+
+/**
+ * @brief Build the Yahoo Finance URL of the spots CSV file
+ * @param symbol Quote symbol
+ * @param period1 Begining POSIX timestamp
+ * @param period2 Ending POSIX timestamp
+ * @param interval Date interval for spots, examples:
+ *          daily "1d"
+ *          weekly "1wk"
+ *          annual "1y"
+ * @return URL of the CSV file
+ */
+std::string yahooCsvUrl(
+    const std::string& symbol,
+    std::time_t period1,
+    std::time_t period2,
+    const std::string& interval
+);
+
+/**
+ * @brief Build the Yahoo Finance URL of the latest quotes of several symbols
+ * @param symbols Quote symbols, all answered by one response
+ * @return URL of the JSON quotes
+ */
+std::string yahooQuoteUrl(const std::vector<std::string>& symbols);
+
+/**
+ * @brief Process wide DNS, connection and TLS session cache shared by all curl handles
+ * @return Share handle, initializes libcurl on first call
+ */
+CURLSH* sharedCurlCache();
+
+/**
+ * @brief Set the common options of a Yahoo Finance request on a curl handle
+ * @param curl Easy handle to prepare
+ * @param url URL to download
+ * @param responseBuffer Buffer the response body is appended to
+ * @param timeouts Time limits of this request
+ */
+void prepareYahooRequest(CURL *curl, const std::string& url, std::string *responseBuffer, const RequestTimeouts& timeouts = RequestTimeouts());
+
+/**
+ * @brief Set the common options of a streamed Yahoo Finance request on a curl handle
+ * @param curl Easy handle to prepare
+ * @param url URL to download
+ * @param onChunk Called with every chunk of the response body, must outlive the transfer
+ * @param timeouts Time limits of this request
+ */
+void prepareYahooRequest(CURL *curl, const std::string& url, const OnChunk *onChunk, const RequestTimeouts& timeouts = RequestTimeouts());
+
+/**
+ * @brief Read the timings of a completed transfer
+ * @param curl Easy handle of the transfer
+ * @param result Result code of the transfer
+ * @return Timings of the transfer
+ */
+TransferStats collectTransferStats(CURL *curl, CURLcode result);
+
+/**
+ * @brief Reusable per thread curl handle, keeps connections alive between requests
+ */
+class TransferContext {
+
+public:
+
+    /**
+     * @brief Transfer context of the calling thread
+     * @return Context, created on first call
+     */
+    static TransferContext& current();
+
+    /**
+     * @brief TransferContext destructor
+     */
+    ~TransferContext();
+
+    /**
+     * @brief Download a Yahoo Finance URL
+     * @param url URL to download
+     * @param stats Set to the timings of the transfer, can be null
+     * @param timeouts Time limits of the transfer
+     * @return Response body, empty if the transfer failed
+     */
+    std::string get(const std::string& url, TransferStats *stats = nullptr, const RequestTimeouts& timeouts = RequestTimeouts());
+
+    /**
+     * @brief Download a Yahoo Finance URL without keeping the body
+     * @param url URL to download
+     * @param onChunk Called with every chunk of the response body as it arrives
+     * @param stats Set to the timings of the transfer, can be null
+     * @param timeouts Time limits of the transfer
+     * @return False if the transfer failed, some chunks may have been received
+     */
+    bool stream(const std::string& url, const OnChunk& onChunk, TransferStats *stats = nullptr, const RequestTimeouts& timeouts = RequestTimeouts());
+
+private:
+
+    TransferContext();
+    TransferContext(const TransferContext&) = delete;
+    TransferContext& operator=(const TransferContext&) = delete;
+
+    /**
+     * @brief Easy handle reused by every transfer of the thread
+     */
+    CURL *curl;
+};
+
 /**
  * @brief Download the spots CSV file from Yahoo Finance
  * @param symbol Quote symbol
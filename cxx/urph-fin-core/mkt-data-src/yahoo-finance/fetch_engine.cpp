@@ -0,0 +1,274 @@
+#include "fetch_engine.hpp"
+#include "curl_utils.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <curl/curl.h>
+
+namespace YahooFinance{
+
+namespace {
+    typedef RequestScheduler::Clock Clock;
+
+    /**
+     * @brief State of one running transfer
+     */
+    struct Transfer {
+        CURL *curl = nullptr;
+        size_t index = 0;
+        int attempt = 0;
+        std::string url;
+        std::string responseBuffer;
+        /**
+         * @brief Passes the chunks on to the engine callback when streamed
+         */
+        OnChunk onChunk;
+        bool statusChecked = false;
+        /**
+         * @brief False for error responses, their body is not passed on
+         */
+        bool forwarding = true;
+        /**
+         * @brief Some body was passed on, the request cannot be retried any more
+         */
+        bool forwarded = false;
+    };
+
+    /**
+     * @brief Request waiting for a transfer
+     */
+    struct Pending {
+        size_t index;
+        int attempt;
+        Clock::time_point readyAt;
+    };
+
+    void start(CURLM *multi, Transfer& t, const Pending& p, const FetchRequest& r, const FetchEngine::OnReceived *onReceived, const RequestTimeouts& timeouts, Clock::duration untilDeadline) {
+        t.index = p.index;
+        t.attempt = p.attempt;
+        t.url = r.url.empty() ? yahooCsvUrl(r.symbol, r.period1, r.period2, r.interval) : r.url;
+        t.responseBuffer.clear();
+        t.statusChecked = false;
+        t.forwarding = true;
+        t.forwarded = false;
+
+        curl_easy_reset(t.curl);
+        if (onReceived != nullptr) {
+            t.onChunk = [onReceived, &t](const char *data, size_t size) {
+                // the status is known once the body starts
+                if (!t.statusChecked) {
+                    long httpCode = 0;
+                    curl_easy_getinfo(t.curl, CURLINFO_RESPONSE_CODE, &httpCode);
+                    t.forwarding = httpCode < 400;
+                    t.statusChecked = true;
+                }
+                if (t.forwarding) {
+                    t.forwarded = true;
+                    (*onReceived)(t.index, data, size);
+                }
+            };
+            prepareYahooRequest(t.curl, t.url, &t.onChunk, timeouts);
+        }
+        else {
+            prepareYahooRequest(t.curl, t.url, &t.responseBuffer, timeouts);
+        }
+        // the transfer cannot outlive the deadline
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(untilDeadline);
+        if (left < timeouts.total) {
+            curl_easy_setopt(t.curl, CURLOPT_TIMEOUT_MS, (long)std::max<int64_t>(1, left.count()));
+        }
+        curl_easy_setopt(t.curl, CURLOPT_PRIVATE, &t);
+        curl_multi_add_handle(multi, t.curl);
+    }
+
+    Clock::duration retryAfter(CURL *curl) {
+        curl_off_t seconds = 0;
+#if LIBCURL_VERSION_NUM >= 0x074200
+        curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &seconds);
+#endif
+        return std::chrono::seconds(seconds);
+    }
+}
+
+FetchEngine::FetchEngine(size_t maxInFlight) {
+    SchedulerOptions options;
+    options.maxInFlight = maxInFlight == 0 ? 1 : maxInFlight;
+    this->ownScheduler.reset(new RequestScheduler(options));
+    this->scheduler = this->ownScheduler.get();
+}
+
+FetchEngine::FetchEngine(RequestScheduler& scheduler) {
+    this->scheduler = &scheduler;
+}
+
+void FetchEngine::add(FetchRequest request) {
+    this->requests.push_back(std::move(request));
+}
+
+void FetchEngine::setDeadline(RequestScheduler::Clock::time_point deadline) {
+    this->deadline = deadline;
+}
+
+void FetchEngine::setTimeouts(const RequestTimeouts& timeouts) {
+    this->timeouts = timeouts;
+}
+
+bool FetchEngine::deadlinePassed() const {
+    return this->expired;
+}
+
+const std::vector<TransferStats>& FetchEngine::transferStats() const {
+    return this->stats;
+}
+
+const SchedulerCounters& FetchEngine::counters() const {
+    return this->runCounters;
+}
+
+size_t FetchEngine::nbRequests() const {
+    return this->requests.size();
+}
+
+void FetchEngine::run(const OnFetched& onFetched) {
+    this->transfer(nullptr, &onFetched, nullptr);
+}
+
+void FetchEngine::run(const OnReceived& onReceived, const OnDone& onDone) {
+    this->transfer(&onReceived, nullptr, &onDone);
+}
+
+void FetchEngine::transfer(const OnReceived *onReceived, const OnFetched *onFetched, const OnDone *onDone) {
+    this->expired = false;
+    this->stats.clear();
+    this->runCounters = SchedulerCounters();
+    if (this->requests.empty()) {
+        return;
+    }
+    auto done = [&](Transfer& t, bool ok) {
+        if (onFetched != nullptr) {
+            (*onFetched)(t.index, ok ? std::move(t.responseBuffer) : std::string());
+        }
+        else {
+            (*onDone)(t.index, ok);
+        }
+    };
+
+    // initializes libcurl before any handle is created
+    sharedCurlCache();
+    CURLM *multi = curl_multi_init();
+    if (multi == nullptr) {
+        Transfer failed;
+        for (size_t i = 0; i < this->requests.size(); ++i) {
+            failed.index = i;
+            done(failed, false);
+        }
+        return;
+    }
+
+    // every request goes to the same host, so the per host limit is the one that matters
+    const size_t slots = std::min(this->scheduler->maxConcurrency(), this->requests.size());
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)slots);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)slots);
+
+    // easy handles are reused by the next request once their transfer is done
+    std::vector<Transfer> transfers(slots);
+    std::vector<Transfer*> idle;
+    for (auto& t: transfers) {
+        t.curl = curl_easy_init();
+        idle.push_back(&t);
+    }
+
+    // retries go back to the queue with the time they can start
+    std::deque<Pending> queue;
+    const auto begining = Clock::now();
+    for (size_t i = 0; i < this->requests.size(); ++i) {
+        queue.push_back({i, 0, begining});
+    }
+
+    int running = 0;
+    size_t completed = 0;
+    while (completed < this->requests.size()) {
+        auto now = Clock::now();
+        if (now >= this->deadline) {
+            // what is still running or waiting fails, partial bodies included
+            this->expired = true;
+            for (auto& t: transfers) {
+                if (std::find(idle.begin(), idle.end(), &t) != idle.end()) {
+                    continue;
+                }
+                curl_multi_remove_handle(multi, t.curl);
+                this->scheduler->release();
+                done(t, false);
+            }
+            Transfer waiting;
+            for (const auto& p: queue) {
+                waiting.index = p.index;
+                done(waiting, false);
+            }
+            break;
+        }
+        // the scheduler bounds the transfers in flight of every engine sharing it
+        while (!idle.empty() && !queue.empty()) {
+            auto ready = std::find_if(queue.begin(), queue.end(), [now](const Pending& p) { return p.readyAt <= now; });
+            if (ready == queue.end() || !this->scheduler->tryAcquire(now)) {
+                break;
+            }
+            Transfer *t = idle.back();
+            idle.pop_back();
+            start(multi, *t, *ready, this->requests[ready->index], onReceived, this->timeouts, this->deadline - now);
+            queue.erase(ready);
+        }
+
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        while (CURLMsg *msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            Transfer *t = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&t);
+            const CURLcode result = msg->data.result;
+            this->stats.push_back(collectTransferStats(t->curl, result));
+            const TransferStats& stats = this->stats.back();
+            curl_multi_remove_handle(multi, t->curl);
+            this->scheduler->release();
+            idle.push_back(t);
+
+            const auto outcome = RequestScheduler::classify(stats.ok, stats.httpCode);
+            // a body already passed on cannot be taken back
+            const int attempt = t->forwarded ? std::numeric_limits<int>::max() : t->attempt;
+            Clock::duration delay;
+            now = Clock::now();
+            if (this->scheduler->onCompleted(outcome, attempt, retryAfter(t->curl), now, delay, &this->runCounters)) {
+                queue.push_back({t->index, t->attempt + 1, now + delay});
+                continue;
+            }
+            ++completed;
+            done(*t, outcome == RequestScheduler::Outcome::Success);
+        }
+
+        if (completed < this->requests.size()) {
+            // wake up for the transfers, or when the next request can start
+            auto wait = std::chrono::milliseconds(1000);
+            now = Clock::now();
+            if (this->deadline - now < wait) {
+                wait = std::chrono::ceil<std::chrono::milliseconds>(this->deadline - now);
+            }
+            if (!queue.empty() && !idle.empty()) {
+                auto earliest = std::min_element(queue.begin(), queue.end(), [](const Pending& a, const Pending& b) { return a.readyAt < b.readyAt; })->readyAt;
+                auto until = std::max(this->scheduler->waitTime(now), earliest - now);
+                wait = std::min(wait, std::chrono::ceil<std::chrono::milliseconds>(until));
+            }
+            curl_multi_poll(multi, nullptr, 0, (int)std::max<int64_t>(1, wait.count()), nullptr);
+        }
+    }
+
+    for (auto& t: transfers) {
+        curl_easy_cleanup(t.curl);
+    }
+    curl_multi_cleanup(multi);
+}
+
+}
@@ -0,0 +1,183 @@
+#ifndef FETCH_ENGINE_HPP
+#define FETCH_ENGINE_HPP
+
+#include "request_scheduler.hpp"
+#include "curl_utils.hpp"
+
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace YahooFinance{
+
+/**
+ * @brief One historical spots CSV download, or any other Yahoo Finance URL
+ */
+struct FetchRequest {
+    std::string symbol;
+    std::time_t period1;
+    std::time_t period2;
+    std::string interval;
+    /**
+     * @brief URL downloaded instead of the spots CSV file when not empty, none by default
+     */
+    std::string url = "";
+};
+
+/**
+ * @brief Concurrent downloader of Yahoo Finance requests
+ *
+ * Drives all the requests over one curl multi handle. A RequestScheduler
+ * decides how many transfers run at the same time, with those of the other
+ * engines sharing it, when they start and which are retried: throttled (429), 5xx and failed transfers are retried as long as
+ * none of their body was passed on, 4xx responses fail right away. Past the
+ * deadline, if one is set, the requests still running or waiting are given up
+ * and fail. The callbacks are called from the thread calling run(), so they do
+ * not need any locking.
+ */
+class FetchEngine {
+
+public:
+
+    /**
+     * @brief Called when a request completed
+     * @param index Index of the request, in the order they were added
+     * @param csv Response body, empty if the request failed
+     */
+    typedef std::function<void(size_t index, std::string&& csv)> OnFetched;
+
+    /**
+     * @brief Called with every chunk of a response body as it arrives
+     * @param index Index of the request, in the order they were added
+     * @param data Next bytes of the body
+     * @param size Number of bytes
+     */
+    typedef std::function<void(size_t index, const char *data, size_t size)> OnReceived;
+
+    /**
+     * @brief Called when a streamed request completed
+     * @param index Index of the request, in the order they were added
+     * @param ok False if the request failed, the body may be truncated
+     */
+    typedef std::function<void(size_t index, bool ok)> OnDone;
+
+    /**
+     * @brief FetchEngine constructor, with a scheduler of its own and no rate limit
+     * @param maxInFlight Max number of concurrent transfers
+     */
+    explicit FetchEngine(size_t maxInFlight);
+
+    /**
+     * @brief FetchEngine constructor
+     * @param scheduler Scheduler of the transfers, not owned, can be shared by several engines
+     */
+    explicit FetchEngine(RequestScheduler& scheduler);
+
+    /**
+     * @brief Queue a request
+     * @param request Request to download
+     */
+    void add(FetchRequest request);
+
+    /**
+     * @brief Give up the requests not completed by a point in time, run() returns by then
+     * @param deadline When the remaining requests fail, transfers are also cut short to end by then
+     */
+    void setDeadline(RequestScheduler::Clock::time_point deadline);
+
+    /**
+     * @brief Time limits of each transfer of this engine, the defaults unless set
+     * @param timeouts Time limits, the deadline still cuts a transfer short
+     */
+    void setTimeouts(const RequestTimeouts& timeouts);
+
+    /**
+     * @brief Whether the last run() gave up requests at the deadline
+     * @return True once the deadline passed with requests not completed
+     */
+    bool deadlinePassed() const;
+
+    /**
+     * @brief Timings of the transfers of the last run(), retries included
+     * @return Timings, in completion order
+     */
+    const std::vector<TransferStats>& transferStats() const;
+
+    /**
+     * @brief What happened to the requests of the last run(), the scheduler counts those of every run
+     * @return Counters of the last run
+     */
+    const SchedulerCounters& counters() const;
+
+    /**
+     * @brief Requests number
+     * @return Number of queued requests
+     */
+    size_t nbRequests() const;
+
+    /**
+     * @brief Download all queued requests, return when all are completed
+     * @param onFetched Completion callback, called once per request
+     */
+    void run(const OnFetched& onFetched);
+
+    /**
+     * @brief Download all queued requests without keeping their bodies, return when all are completed
+     *
+     * Lets the caller parse while the rest of the body is still on the way.
+     * @param onReceived Called with every chunk of every response body
+     * @param onDone Completion callback, called once per request after its last chunk
+     */
+    void run(const OnReceived& onReceived, const OnDone& onDone);
+
+private:
+
+    /**
+     * @brief Drive the transfers, bodies are buffered unless onReceived is set
+     */
+    void transfer(const OnReceived *onReceived, const OnFetched *onFetched, const OnDone *onDone);
+
+    /**
+     * @brief Scheduler created by the engine, if it was not given one
+     */
+    std::unique_ptr<RequestScheduler> ownScheduler;
+
+    /**
+     * @brief Scheduler of the transfers
+     */
+    RequestScheduler *scheduler;
+
+    /**
+     * @brief Queued requests
+     */
+    std::vector<FetchRequest> requests;
+
+    /**
+     * @brief When the remaining requests are given up, none by default
+     */
+    RequestScheduler::Clock::time_point deadline = RequestScheduler::Clock::time_point::max();
+
+    /**
+     * @brief Time limits of each transfer, kept per engine so concurrent loads do not change each other's
+     */
+    RequestTimeouts timeouts;
+
+    /**
+     * @brief Requests were given up at the deadline
+     */
+    bool expired = false;
+
+    /**
+     * @brief Timings of the last run, kept per engine so concurrent loads do not mix theirs
+     */
+    std::vector<TransferStats> stats;
+
+    /**
+     * @brief Counters of the last run
+     */
+    SchedulerCounters runCounters;
+};
+}
+#endif /* FETCH_ENGINE_HPP */
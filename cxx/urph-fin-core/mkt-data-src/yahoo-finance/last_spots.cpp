@@ -0,0 +1,55 @@
+#include "last_spots.hpp"
+
+#include <algorithm>
+
+namespace YahooFinance{
+
+namespace {
+    const std::time_t ONE_DAY = 24 * 60 * 60;
+
+    inline std::time_t dayOf(std::time_t t) {
+        return t - ((t % ONE_DAY) + ONE_DAY) % ONE_DAY;
+    }
+}
+
+bool LastSpots::find(const std::string& symbol, LastSpot& last) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->spots.find(symbol);
+    if (it == this->spots.end()) {
+        return false;
+    }
+    last = it->second;
+    return true;
+}
+
+void LastSpots::update(const std::string& symbol,
+                       std::time_t date,
+                       double close,
+                       std::time_t checkedTo) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto& last = this->spots[symbol];
+    if (date >= last.date) {
+        last.date = date;
+        last.close = close;
+    }
+    last.checkedTo = std::max(last.checkedTo, checkedTo);
+}
+
+void LastSpots::clear() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->spots.clear();
+}
+
+bool LastSpots::missingPeriod(const LastSpot& last,
+                              std::time_t period1,
+                              std::time_t period2,
+                              std::time_t& from) {
+    from = std::max(period1, dayOf(last.date) + ONE_DAY);
+    // a day already checked without spot is a day without trading
+    if (dayOf(last.checkedTo) >= dayOf(period2)) {
+        return false;
+    }
+    return dayOf(from) <= dayOf(period2);
+}
+
+}
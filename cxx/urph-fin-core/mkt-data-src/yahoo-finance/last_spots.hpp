@@ -0,0 +1,77 @@
+#ifndef LAST_SPOTS_HPP
+#define LAST_SPOTS_HPP
+
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace YahooFinance{
+
+/**
+ * @brief Latest daily spot known for a symbol
+ */
+struct LastSpot {
+    std::time_t date = 0;
+    double close = 0.0;
+    /**
+     * @brief Ending of the last period successfully downloaded, no newer spot before it
+     */
+    std::time_t checkedTo = 0;
+};
+
+/**
+ * @brief Process wide registry of the latest spot of each symbol
+ *
+ * Lets a reload only ask for the days after what is already known.
+ */
+class LastSpots {
+
+public:
+
+    /**
+     * @brief Latest spot of a symbol
+     * @param symbol Quote symbol
+     * @param last Set to the latest spot if the symbol is known
+     * @return False if nothing is known about the symbol
+     */
+    bool find(const std::string& symbol, LastSpot& last) const;
+
+    /**
+     * @brief Record a successful download, keeps the newest spot
+     * @param symbol Quote symbol
+     * @param date Date of the latest spot (POSIX timestamp)
+     * @param close Close of the latest spot
+     * @param checkedTo Ending of the downloaded period (POSIX timestamp)
+     */
+    void update(const std::string& symbol,
+                std::time_t date,
+                double close,
+                std::time_t checkedTo);
+
+    /**
+     * @brief Forget every symbol
+     */
+    void clear();
+
+    /**
+     * @brief Find the period still to be downloaded
+     * @param last Latest spot known
+     * @param period1 Begining of the wanted period (POSIX timestamp)
+     * @param period2 Ending of the wanted period (POSIX timestamp)
+     * @param from Set to the day after the latest spot, not before period1
+     * @return False if the symbol is current up to period2
+     */
+    static bool missingPeriod(const LastSpot& last,
+                              std::time_t period1,
+                              std::time_t period2,
+                              std::time_t& from);
+
+private:
+
+    mutable std::mutex mutex;
+
+    std::unordered_map<std::string, LastSpot> spots;
+};
+}
+#endif /* LAST_SPOTS_HPP */
@@ -0,0 +1,147 @@
+#include "price_series.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace YahooFinance{
+
+namespace {
+    template<typename T>
+    void permute(std::vector<T>& column, const std::vector<size_t>& order) {
+        std::vector<T> sorted;
+        sorted.reserve(order.size());
+        for (auto i: order) {
+            sorted.push_back(column[i]);
+        }
+        column.swap(sorted);
+    }
+}
+
+void PriceSeries::reserve(size_t n) {
+    this->dateColumn.reserve(n);
+    this->openColumn.reserve(n);
+    this->highColumn.reserve(n);
+    this->lowColumn.reserve(n);
+    this->closeColumn.reserve(n);
+}
+
+void PriceSeries::add(std::time_t date, double open, double high, double low, double close) {
+    this->dateColumn.push_back(date);
+    this->openColumn.push_back(open);
+    this->highColumn.push_back(high);
+    this->lowColumn.push_back(low);
+    this->closeColumn.push_back(close);
+}
+
+void PriceSeries::add(const Spot& spot) {
+    this->add(spot.getDate(), spot.getOpen(), spot.getHigh(), spot.getLow(), spot.getClose());
+}
+
+void PriceSeries::clear() {
+    this->dateColumn.clear();
+    this->openColumn.clear();
+    this->highColumn.clear();
+    this->lowColumn.clear();
+    this->closeColumn.clear();
+}
+
+Spot PriceSeries::spot(size_t i) const {
+    return Spot(this->dateColumn[i], this->openColumn[i], this->highColumn[i], this->lowColumn[i], this->closeColumn[i]);
+}
+
+void PriceSeries::sortByDate() {
+    const auto& dates = this->dateColumn;
+    // downloads come in order, only a merge can break it
+    if (std::is_sorted(dates.begin(), dates.end()) && std::adjacent_find(dates.begin(), dates.end()) == dates.end()) {
+        return;
+    }
+
+    std::vector<size_t> order(dates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&dates](size_t a, size_t b) { return dates[a] < dates[b]; });
+    order.erase(std::unique(order.begin(), order.end(), [&dates](size_t a, size_t b) { return dates[a] == dates[b]; }), order.end());
+
+    permute(this->dateColumn, order);
+    permute(this->openColumn, order);
+    permute(this->highColumn, order);
+    permute(this->lowColumn, order);
+    permute(this->closeColumn, order);
+}
+
+size_t PriceSeries::lowerBound(std::time_t date) const {
+    return std::lower_bound(this->dateColumn.begin(), this->dateColumn.end(), date) - this->dateColumn.begin();
+}
+
+size_t PriceSeries::upperBound(std::time_t date) const {
+    return std::upper_bound(this->dateColumn.begin(), this->dateColumn.end(), date) - this->dateColumn.begin();
+}
+
+PriceSeriesView PriceSeries::view() const {
+    return this->slice(0, this->size());
+}
+
+PriceSeriesView PriceSeries::view(std::time_t from, std::time_t to) const {
+    const size_t first = this->lowerBound(from);
+    const size_t last = std::max(first, this->upperBound(to));
+    return this->slice(first, last);
+}
+
+PriceSeriesView PriceSeries::slice(size_t first, size_t last) const {
+    const size_t n = last - first;
+    return PriceSeriesView{
+        this->dates().subspan(first, n),
+        this->open().subspan(first, n),
+        this->high().subspan(first, n),
+        this->low().subspan(first, n),
+        this->close().subspan(first, n)
+    };
+}
+
+std::vector<double> simpleReturns(Span<const double> prices) {
+    if (prices.size() < 2) {
+        return {};
+    }
+    std::vector<double> returns(prices.size() - 1);
+    const double *p = prices.data();
+    double *r = returns.data();
+    // no dependency between iterations, the compiler can vectorize it
+    for (size_t i = 0; i < returns.size(); ++i) {
+        r[i] = p[i + 1] / p[i] - 1.0;
+    }
+    return returns;
+}
+
+std::vector<double> logReturns(Span<const double> prices) {
+    if (prices.size() < 2) {
+        return {};
+    }
+    std::vector<double> returns(prices.size() - 1);
+    const double *p = prices.data();
+    double *r = returns.data();
+    for (size_t i = 0; i < returns.size(); ++i) {
+        r[i] = std::log(p[i + 1] / p[i]);
+    }
+    return returns;
+}
+
+std::vector<double> rollingMean(Span<const double> values, size_t window) {
+    if (window == 0 || values.size() < window) {
+        return {};
+    }
+    // prefix sums make every window a subtraction, sums[i] is the sum of the first i values
+    std::vector<double> sums(values.size() + 1);
+    sums[0] = 0.0;
+    std::partial_sum(values.begin(), values.end(), sums.begin() + 1);
+
+    std::vector<double> means(values.size() - window + 1);
+    const double *s = sums.data();
+    double *m = means.data();
+    const double inverse = 1.0 / window;
+    for (size_t i = 0; i < means.size(); ++i) {
+        m[i] = (s[i + window] - s[i]) * inverse;
+    }
+    return means;
+}
+
+}
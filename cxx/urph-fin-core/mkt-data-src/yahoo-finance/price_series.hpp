@@ -0,0 +1,160 @@
+#ifndef PRICE_SERIES_HPP
+#define PRICE_SERIES_HPP
+
+#include "spot.hpp"
+#include "span.hpp"
+
+#include <ctime>
+#include <vector>
+
+namespace YahooFinance{
+
+/**
+ * @brief Read only view of consecutive spots of a PriceSeries, one span per column
+ */
+struct PriceSeriesView {
+    Span<const std::time_t> dates;
+    Span<const double> open;
+    Span<const double> high;
+    Span<const double> low;
+    Span<const double> close;
+
+    size_t size() const { return this->dates.size(); }
+
+    bool empty() const { return this->dates.empty(); }
+
+    /**
+     * @brief Spot getter by index
+     * @param i spot index, must be smaller than size()
+     * @return Spot i
+     */
+    Spot spot(size_t i) const {
+        return Spot(this->dates[i], this->open[i], this->high[i], this->low[i], this->close[i]);
+    }
+};
+
+/**
+ * @brief Daily spots stored by column: dates, open, high, low and close arrays
+ *
+ * Calculations over one column, e.g. returns of the close prices, only read
+ * that column from contiguous memory.
+ */
+class PriceSeries {
+
+public:
+
+    /**
+     * @brief Spots number
+     */
+    size_t size() const { return this->dateColumn.size(); }
+
+    bool empty() const { return this->dateColumn.empty(); }
+
+    /**
+     * @brief Reserve room for spots
+     * @param n Total number of spots
+     */
+    void reserve(size_t n);
+
+    /**
+     * @brief Append a spot
+     */
+    void add(std::time_t date, double open, double high, double low, double close);
+
+    /**
+     * @brief Append a spot
+     */
+    void add(const Spot& spot);
+
+    /**
+     * @brief Remove every spot
+     */
+    void clear();
+
+    /**
+     * @brief Spot getter by index
+     * @param i spot index, must be smaller than size()
+     * @return Spot i
+     */
+    Spot spot(size_t i) const;
+
+    /**
+     * @brief Sort the spots by date, the first spot of a date wins
+     */
+    void sortByDate();
+
+    /**
+     * @brief Index of the first spot not before a date, O(log n)
+     * @param date POSIX timestamp
+     * @return Index, size() if every spot is before date
+     */
+    size_t lowerBound(std::time_t date) const;
+
+    /**
+     * @brief Index of the first spot after a date, O(log n)
+     * @param date POSIX timestamp
+     * @return Index, size() if no spot is after date
+     */
+    size_t upperBound(std::time_t date) const;
+
+    /**
+     * @brief View of every spot
+     */
+    PriceSeriesView view() const;
+
+    /**
+     * @brief View of the spots of a period, O(log n)
+     * @param from Begining of the period, included (POSIX timestamp)
+     * @param to Ending of the period, included (POSIX timestamp)
+     * @return View, valid until the series is modified
+     */
+    PriceSeriesView view(std::time_t from, std::time_t to) const;
+
+    Span<const std::time_t> dates() const { return this->dateColumn; }
+
+    Span<const double> open() const { return this->openColumn; }
+
+    Span<const double> high() const { return this->highColumn; }
+
+    Span<const double> low() const { return this->lowColumn; }
+
+    Span<const double> close() const { return this->closeColumn; }
+
+private:
+
+    /**
+     * @brief View of spots [first, last)
+     */
+    PriceSeriesView slice(size_t first, size_t last) const;
+
+    std::vector<std::time_t> dateColumn;
+    std::vector<double> openColumn;
+    std::vector<double> highColumn;
+    std::vector<double> lowColumn;
+    std::vector<double> closeColumn;
+};
+
+/**
+ * @brief Period over period returns, prices[i] / prices[i - 1] - 1
+ * @param prices Prices sorted by date, e.g. PriceSeries::close()
+ * @return One return less than prices, empty if there are less than 2 prices
+ */
+std::vector<double> simpleReturns(Span<const double> prices);
+
+/**
+ * @brief Period over period log returns, log(prices[i] / prices[i - 1])
+ * @param prices Prices sorted by date, e.g. PriceSeries::close()
+ * @return One return less than prices, empty if there are less than 2 prices
+ */
+std::vector<double> logReturns(Span<const double> prices);
+
+/**
+ * @brief Mean of every window of consecutive values
+ * @param values Values sorted by date
+ * @param window Window length
+ * @return Mean of values[i, i + window) at i, empty if there are less than window values
+ */
+std::vector<double> rollingMean(Span<const double> values, size_t window);
+
+}
+#endif /* PRICE_SERIES_HPP */
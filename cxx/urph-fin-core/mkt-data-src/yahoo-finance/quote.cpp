@@ -1,15 +1,21 @@
 #include "quote.hpp"
 #include "time_utils.hpp"
 #include "curl_utils.hpp"
+#include "spot_csv.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <curl/curl.h>
 
 namespace YahooFinance{
 
-Quote::Quote(std::string symbol) {
+Quote::Quote(std::string symbol) : Quote(symbol, nullptr) {}
+
+Quote::Quote(std::string symbol, SpotCache *cache) {
     this->symbol = symbol;
+    this->cache = cache;
 }
 
 Quote::~Quote() {}
@@ -20,7 +26,7 @@ size_t Quote::nbSpots() {
 
 Spot Quote::getSpot(size_t i) {
     if (i < this->spots.size()) {
-        return this->spots[i];
+        return this->spots.spot(i);
     }
     std::stringstream ss;
     ss << this->spots.size();
@@ -31,12 +37,8 @@ Spot Quote::getSpot(size_t i) {
 }
 
 Spot Quote::getSpot(std::time_t date) {
-    for (std::vector<Spot>::iterator it = this->spots.begin();
-         it != this->spots.end();
-         ++it) {
-        if (it->getDate() == date) {
-            return *it;
-        }
+    if (auto spot = this->findSpot(date)) {
+        return *spot;
     }
     std::stringstream ss;
     ss << "ERROR getSpot(date) - There is not spot at " << date;
@@ -44,11 +46,12 @@ Spot Quote::getSpot(std::time_t date) {
 }
 
 Spot Quote::getSpot(std::string date) {
-    for (std::vector<Spot>::iterator it = this->spots.begin();
-         it != this->spots.end();
-         ++it) {
-        if (it->getDateToString() == date) {
-            return *it;
+    // any spot of that day
+    std::time_t epoch;
+    if (parseIsoDate(date, epoch)) {
+        auto day = this->getSpots(epoch, epoch + 24 * 60 * 60 - 1);
+        if (!day.empty()) {
+            return day.spot(0);
         }
     }
     std::stringstream ss;
@@ -56,11 +59,46 @@ Spot Quote::getSpot(std::string date) {
     throw std::invalid_argument(ss.str());
 }
 
+std::optional<Spot> Quote::findSpot(std::time_t date) const {
+    const size_t i = this->spots.lowerBound(date);
+    if (i < this->spots.size() && this->spots.dates()[i] == date) {
+        return this->spots.spot(i);
+    }
+    return std::nullopt;
+}
+
+std::optional<Spot> Quote::findSpotAsOf(std::time_t date) const {
+    const size_t i = this->spots.upperBound(date);
+    if (i == 0) {
+        return std::nullopt;
+    }
+    return this->spots.spot(i - 1);
+}
+
+Spot Quote::getSpotAsOf(std::time_t date) {
+    if (auto spot = this->findSpotAsOf(date)) {
+        return *spot;
+    }
+    std::stringstream ss;
+    ss << "ERROR getSpotAsOf(date) - There is not spot on or before " << date;
+    throw std::invalid_argument(ss.str());
+}
+
+const PriceSeries& Quote::getPriceSeries() const {
+    return this->spots;
+}
+
+PriceSeriesView Quote::getSpots() const {
+    return this->spots.view();
+}
+
+PriceSeriesView Quote::getSpots(std::time_t from, std::time_t to) const {
+    return this->spots.view(from, to);
+}
+
 void Quote::printSpots() {
-    for (std::vector<Spot>::iterator it = this->spots.begin();
-         it != this->spots.end();
-         ++it) {
-        std::cout << it->toString() << std::endl;
+    for (size_t i = 0; i < this->spots.size(); ++i) {
+        std::cout << this->spots.spot(i).toString() << std::endl;
     }
 }
 
@@ -76,36 +114,116 @@ std::string Quote::getHistoricalCsv(
     return downloadYahooCsv(this->symbol, period1, period2, interval);
 }
 
+void Quote::parseHistoricalCsv(const std::string& csv) {
+    // a daily row is about 60 bytes
+    this->spots.reserve(this->spots.size() + csv.size() / 60 + 1);
+    parseSpotsCsv(csv, [this](std::time_t date, double open, double high, double low, double close) {
+        this->spots.add(date, open, high, low, close);
+    });
+    this->spots.sortByDate();
+}
+
+bool Quote::loadCachedSpots(std::time_t period1,
+                            std::time_t period2,
+                            std::time_t &from,
+                            std::time_t &to) {
+    if (this->cache == nullptr) {
+        from = period1;
+        to = period2;
+        return true;
+    }
+
+    this->cached = this->cache->read(this->symbol);
+    for (auto& spot: this->cached.spots) {
+        if (spot.getDate() >= period1 && spot.getDate() <= period2) {
+            this->spots.add(spot);
+        }
+    }
+    this->spots.sortByDate();
+    return SpotCache::missingPeriod(this->cached, period1, period2, from, to);
+}
+
+void Quote::addDownloadedSpots(const std::string& csv,
+                               std::time_t from,
+                               std::time_t to) {
+    // merged with the cached spots already loaded, sorted by date
+    this->parseHistoricalCsv(csv);
+
+    // failed download, keep the cache as it is so the period is retried next time
+    if (csv.compare(0, 5, "Date,") == 0) {
+        this->cacheDownloadedSpots(from, to);
+    }
+}
+
+void Quote::addDownloadedChunk(const char *data, size_t size) {
+    this->download.feed(std::string_view(data, size), [this](std::time_t date, double open, double high, double low, double close) {
+        this->spots.add(date, open, high, low, close);
+    });
+}
+
+bool Quote::endDownload(bool ok) {
+    this->download.finish([this](std::time_t date, double open, double high, double low, double close) {
+        this->spots.add(date, open, high, low, close);
+    });
+    const bool csv = ok && this->download.isCsv();
+    this->download.reset();
+    this->spots.sortByDate();
+    return csv;
+}
+
+void Quote::cacheDownloadedSpots(std::time_t from,
+                                 std::time_t to) {
+    if (this->cache == nullptr) {
+        return;
+    }
+
+    auto byDate = [](const Spot& s1, const Spot& s2) { return s1.getDate() < s2.getDate(); };
+    auto sameDate = [](const Spot& s1, const Spot& s2) { return s1.getDate() == s2.getDate(); };
+
+    const std::time_t closed = std::min(to, SpotCache::closedUntil(currentEpoch()));
+    if (closed < from) {
+        return;
+    }
+
+    // merge the downloaded period into the cached one when they touch, or start over
+    CachedSpots& c = this->cached;
+    const bool contiguous = !c.empty() && from <= c.coveredTo + 24 * 60 * 60 && closed >= c.coveredFrom - 24 * 60 * 60;
+    if (contiguous) {
+        c.coveredFrom = std::min(c.coveredFrom, from);
+        c.coveredTo = std::max(c.coveredTo, closed);
+    }
+    else {
+        c.spots.clear();
+        c.coveredFrom = from;
+        c.coveredTo = closed;
+    }
+    auto downloaded = this->spots.view(from, closed);
+    for (size_t i = 0; i < downloaded.size(); ++i) {
+        c.spots.push_back(downloaded.spot(i));
+    }
+    std::stable_sort(c.spots.begin(), c.spots.end(), byDate);
+    c.spots.erase(std::unique(c.spots.begin(), c.spots.end(), sameDate), c.spots.end());
+    this->cache->write(this->symbol, c);
+}
+
 void Quote::getHistoricalSpots(std::time_t period1,
                                std::time_t period2,
                                const char *interval) {
-    // Download the historical prices Csv
-    std::string csv = this->getHistoricalCsv(period1, period2, interval);
-    std::istringstream csvStream(csv);
-    std::string line;
-
-    // Remove the header line
-    std::getline(csvStream, line);
-
-    while (std::getline(csvStream, line)) {
-        // Split line delimited by comma separator into a vector
-        std::vector<std::string> spotVector;
-        std::stringstream iss(line);
-        std::string lineItem;
-        while (std::getline(iss, lineItem, ',')) {
-            spotVector.push_back(lineItem);
-        }
+    // only daily spots are cached
+    std::time_t from = period1, to = period2;
+    const bool daily = std::strcmp(interval, "1d") == 0;
+    if (daily && !this->loadCachedSpots(period1, period2, from, to)) {
+        return;
+    }
 
-        if (spotVector[0] != "null" && spotVector[1] != "null") {
-            Spot spot = Spot(
-                spotVector[0],                      // date
-                std::atof(spotVector[1].c_str()),   // open
-                std::atof(spotVector[2].c_str()),   // high
-                std::atof(spotVector[3].c_str()),   // low
-                std::atof(spotVector[4].c_str())    // close
-            );
-            this->spots.push_back(spot);
-        }
+    // Parse the historical prices Csv while it is downloaded
+    const std::string url = yahooCsvUrl(this->symbol, from, to, interval);
+    const bool ok = TransferContext::current().stream(url, [this](const char *data, size_t size) {
+        this->addDownloadedChunk(data, size);
+    });
+    // failed download, keep the cache as it is so the period is retried next time
+    if (this->endDownload(ok) && daily) {
+        this->cacheDownloadedSpots(from, to);
     }
 }
 
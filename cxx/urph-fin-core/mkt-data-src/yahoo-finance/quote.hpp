@@ -2,7 +2,11 @@
 #define QUOTE_HPP
 
 #include "spot.hpp"
+#include "spot_cache.hpp"
+#include "price_series.hpp"
+#include "spot_csv.hpp"
 
+#include <optional>
 #include <vector>
 
 namespace YahooFinance{
@@ -19,6 +23,13 @@ public:
      */
     Quote(std::string symbol);
 
+    /**
+     * @brief Quote constructor
+     * @param symbol
+     * @param cache Cache of the daily spots, not owned, can be null
+     */
+    Quote(std::string symbol, SpotCache *cache);
+
     /**
      * @brief Quote destructor
      */
@@ -38,19 +49,60 @@ public:
     Spot getSpot(size_t i);
 
     /**
-     * @brief Spot getter by date
+     * @brief Spot getter by date, O(log n)
      * @param date Spot date
-     * @return spots(date)
+     * @return spots(date), throws std::invalid_argument if there is none
      */
     Spot getSpot(std::time_t date);
 
     /**
-     * @brief Spot getter by date
-     * @param date Spot date
-     * @return spots(date)
+     * @brief Spot getter by date, O(log n)
+     * @param date Spot date (format yyyy-MM-dd)
+     * @return spots(date), throws std::invalid_argument if there is none
      */
     Spot getSpot(std::string date);
 
+    /**
+     * @brief Spot getter by date, O(log n)
+     * @param date Spot date
+     * @return Spot at date, empty if there is none
+     */
+    std::optional<Spot> findSpot(std::time_t date) const;
+
+    /**
+     * @brief Latest spot on or before a date, O(log n)
+     * @param date Any POSIX timestamp
+     * @return Last spot not after date, empty if every spot is after date
+     */
+    std::optional<Spot> findSpotAsOf(std::time_t date) const;
+
+    /**
+     * @brief Latest spot on or before a date, O(log n)
+     * @param date Any POSIX timestamp
+     * @return Last spot not after date, throws std::invalid_argument if there is none
+     */
+    Spot getSpotAsOf(std::time_t date);
+
+    /**
+     * @brief All the spots, by column and sorted by date
+     * @return Series, the analytics read its columns directly
+     */
+    const PriceSeries& getPriceSeries() const;
+
+    /**
+     * @brief All the spots, sorted by date
+     * @return View valid until the spots are modified
+     */
+    PriceSeriesView getSpots() const;
+
+    /**
+     * @brief Spots of a period, O(log n)
+     * @param from Begining of the period, included (POSIX timestamp)
+     * @param to Ending of the period, included (POSIX timestamp)
+     * @return View sorted by date, valid until the spots are modified
+     */
+    PriceSeriesView getSpots(std::time_t from, std::time_t to) const;
+
     /**
      * @brief Print all the spots
      */
@@ -75,6 +127,57 @@ public:
                                  std::time_t period2,
                                  const char *interval);
 
+    /**
+     * @brief Fill spots vector from a downloaded historical CSV file
+     * @param csv Content of the historical CSV file
+     */
+    void parseHistoricalCsv(const std::string& csv);
+
+    /**
+     * @brief Fill spots vector with the cached daily spots of a period
+     * @param period1 Begining date (POSIX timestamp)
+     * @param period2 Ending date (POSIX timestamp)
+     * @param from Set to the begining of the period still to be downloaded
+     * @param to Set to the ending of the period still to be downloaded
+     * @return False if every day of the period came from the cache
+     */
+    bool loadCachedSpots(std::time_t period1,
+                         std::time_t period2,
+                         std::time_t &from,
+                         std::time_t &to);
+
+    /**
+     * @brief Add the spots downloaded after loadCachedSpots() and update the cache
+     * @param csv Content of the historical CSV file
+     * @param from Begining date of the download (POSIX timestamp)
+     * @param to Ending date of the download (POSIX timestamp)
+     */
+    void addDownloadedSpots(const std::string& csv,
+                            std::time_t from,
+                            std::time_t to);
+
+    /**
+     * @brief Add the spots of the next chunk of a historical CSV download
+     * @param data Next bytes of the CSV file, rows may be split between chunks
+     * @param size Number of bytes
+     */
+    void addDownloadedChunk(const char *data, size_t size);
+
+    /**
+     * @brief End the download fed to addDownloadedChunk()
+     * @param ok False if the transfer failed
+     * @return True if a complete CSV file was received
+     */
+    bool endDownload(bool ok);
+
+    /**
+     * @brief Put the spots of a completed download in the cache
+     * @param from Begining date of the download (POSIX timestamp)
+     * @param to Ending date of the download (POSIX timestamp)
+     */
+    void cacheDownloadedSpots(std::time_t from,
+                              std::time_t to);
+
     /**
      * @brief Fill spots vector on a period
      * @param period1 Begining date (POSIX timestamp)
@@ -109,9 +212,24 @@ private:
     std::string symbol;
 
     /**
-     * @brief Spots vector
+     * @brief Spots by column, sorted by date without duplicated date
+     */
+    PriceSeries spots;
+
+    /**
+     * @brief Cache of the daily spots, can be null
+     */
+    SpotCache *cache;
+
+    /**
+     * @brief Spots read from the cache by loadCachedSpots()
+     */
+    CachedSpots cached;
+
+    /**
+     * @brief Parser of the download fed to addDownloadedChunk()
      */
-    std::vector<Spot> spots;
+    SpotCsvStream download;
 };
 }
 #endif /* QUOTE_HPP */
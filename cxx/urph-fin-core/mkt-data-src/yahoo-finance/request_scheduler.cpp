@@ -0,0 +1,198 @@
+#include "request_scheduler.hpp"
+
+#include <algorithm>
+
+namespace YahooFinance{
+
+namespace {
+    /**
+     * @brief How often to try again while every request allowed is in flight, the slot may be
+     *        freed by the transfer of another run the caller cannot wait for
+     */
+    const std::chrono::milliseconds FULL_POLL(10);
+}
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst) {
+    this->rate = ratePerSecond;
+    this->capacity = std::max(1.0, burst);
+    this->tokens = this->capacity;
+    this->last = Clock::now();
+}
+
+void TokenBucket::refill(Clock::time_point now) {
+    if (now <= this->last) {
+        return;
+    }
+    const double elapsed = std::chrono::duration<double>(now - this->last).count();
+    this->tokens = std::min(this->capacity, this->tokens + elapsed * this->rate);
+    this->last = now;
+}
+
+bool TokenBucket::tryTake(Clock::time_point now) {
+    if (this->rate <= 0.0) {
+        return true;
+    }
+    this->refill(now);
+    if (this->tokens < 1.0) {
+        return false;
+    }
+    this->tokens -= 1.0;
+    return true;
+}
+
+TokenBucket::Clock::duration TokenBucket::waitTime(Clock::time_point now) const {
+    if (this->rate <= 0.0) {
+        return Clock::duration::zero();
+    }
+    const double elapsed = now > this->last ? std::chrono::duration<double>(now - this->last).count() : 0.0;
+    const double missing = 1.0 - std::min(this->capacity, this->tokens + elapsed * this->rate);
+    if (missing <= 0.0) {
+        return Clock::duration::zero();
+    }
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(missing / this->rate));
+}
+
+RequestScheduler::Outcome RequestScheduler::classify(bool transferOk, long httpCode) {
+    if (!transferOk) {
+        return Outcome::NetworkError;
+    }
+    if (httpCode == 429) {
+        return Outcome::Throttled;
+    }
+    if (httpCode >= 500) {
+        return Outcome::ServerError;
+    }
+    if (httpCode >= 400) {
+        return Outcome::Rejected;
+    }
+    return Outcome::Success;
+}
+
+RequestScheduler::RequestScheduler(const SchedulerOptions& options)
+    : options(options), bucket(options.ratePerSecond, options.burst) {
+    this->options.maxInFlight = std::max<size_t>(1, this->options.maxInFlight);
+    this->options.minInFlight = std::min(std::max<size_t>(1, this->options.minInFlight), this->options.maxInFlight);
+    this->inFlight = this->options.maxInFlight;
+    this->random.seed(options.seed != 0 ? options.seed : std::random_device()());
+}
+
+size_t RequestScheduler::concurrency() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->inFlight;
+}
+
+size_t RequestScheduler::maxConcurrency() const {
+    return this->options.maxInFlight;
+}
+
+bool RequestScheduler::tryAcquire(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (now < this->pausedUntil || this->started >= this->inFlight) {
+        return false;
+    }
+    if (!this->bucket.tryTake(now)) {
+        return false;
+    }
+    ++this->started;
+    return true;
+}
+
+void RequestScheduler::release() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->started > 0) {
+        --this->started;
+    }
+}
+
+size_t RequestScheduler::running() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->started;
+}
+
+RequestScheduler::Clock::duration RequestScheduler::waitTime(Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    const auto paused = now < this->pausedUntil ? this->pausedUntil - now : Clock::duration::zero();
+    const auto full = this->started >= this->inFlight ? Clock::duration(FULL_POLL) : Clock::duration::zero();
+    return std::max({paused, full, this->bucket.waitTime(now)});
+}
+
+RequestScheduler::Clock::duration RequestScheduler::backoff(int attempt) {
+    const auto ceiling = std::min<int64_t>(this->options.maxBackoff.count(),
+                                           this->options.baseBackoff.count() << std::min(attempt, 20));
+    std::uniform_int_distribution<int64_t> jitter(0, std::max<int64_t>(0, ceiling));
+    return std::chrono::milliseconds(jitter(this->random));
+}
+
+bool RequestScheduler::onCompleted(Outcome outcome,
+                                   int attempt,
+                                   Clock::duration retryAfter,
+                                   Clock::time_point now,
+                                   Clock::duration& retryDelay,
+                                   SchedulerCounters *runCounters) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto count = [this, runCounters](size_t SchedulerCounters::*counter) {
+        ++(this->stats.*counter);
+        if (runCounters != nullptr) {
+            ++(runCounters->*counter);
+        }
+    };
+    count(&SchedulerCounters::completed);
+
+    switch (outcome) {
+    case Outcome::Success:
+        // additive increase, one more once a whole window of requests went through
+        if (++this->successes >= this->inFlight && this->inFlight < this->options.maxInFlight) {
+            ++this->inFlight;
+            count(&SchedulerCounters::concurrencyIncreases);
+            this->successes = 0;
+        }
+        return false;
+    case Outcome::Rejected:
+        count(&SchedulerCounters::failed);
+        return false;
+    case Outcome::Throttled:
+        count(&SchedulerCounters::throttled);
+        break;
+    case Outcome::ServerError:
+        count(&SchedulerCounters::serverErrors);
+        break;
+    case Outcome::NetworkError:
+        count(&SchedulerCounters::networkErrors);
+        break;
+    }
+
+    // multiplicative decrease
+    this->successes = 0;
+    if (now >= this->lastDecrease + this->options.baseBackoff && this->inFlight > this->options.minInFlight) {
+        this->inFlight = std::max(this->options.minInFlight, this->inFlight / 2);
+        count(&SchedulerCounters::concurrencyDecreases);
+        this->lastDecrease = now;
+    }
+
+    // a Retry-After far in the future would stall the next runs too
+    const Clock::duration maxBackoff = this->options.maxBackoff;
+    retryDelay = std::min(maxBackoff, std::max(this->backoff(attempt), retryAfter));
+    if (outcome == Outcome::Throttled) {
+        // the provider wants every request to slow down, not only this one
+        this->pausedUntil = std::max(this->pausedUntil, now + std::min(maxBackoff, std::max<Clock::duration>(retryAfter, this->options.baseBackoff)));
+    }
+
+    if (attempt >= this->options.maxRetries) {
+        count(&SchedulerCounters::failed);
+        return false;
+    }
+    count(&SchedulerCounters::retries);
+    return true;
+}
+
+SchedulerCounters RequestScheduler::counters() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+void RequestScheduler::resetCounters() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats = SchedulerCounters();
+}
+
+}
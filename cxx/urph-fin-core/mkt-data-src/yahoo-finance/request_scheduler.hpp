@@ -0,0 +1,276 @@
+#ifndef REQUEST_SCHEDULER_HPP
+#define REQUEST_SCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+namespace YahooFinance{
+
+/**
+ * @brief Tuning of a RequestScheduler
+ */
+struct SchedulerOptions {
+    /**
+     * @brief Requests started per second on average, 0 for no limit
+     */
+    double ratePerSecond = 0.0;
+    /**
+     * @brief Requests that can be started at once after an idle period
+     */
+    double burst = 1.0;
+    /**
+     * @brief Concurrency bounds, the scheduler starts at maxInFlight
+     */
+    size_t minInFlight = 1;
+    size_t maxInFlight = 8;
+    /**
+     * @brief Retries of a throttled, failed or 5xx request before giving up
+     */
+    int maxRetries = 3;
+    /**
+     * @brief Backoff of the first retry, doubled at every retry up to maxBackoff
+     */
+    std::chrono::milliseconds baseBackoff = std::chrono::milliseconds(500);
+    std::chrono::milliseconds maxBackoff = std::chrono::milliseconds(30000);
+    /**
+     * @brief Seed of the retry jitter, 0 for a random one
+     */
+    uint32_t seed = 0;
+};
+
+/**
+ * @brief What happened to the requests of a scheduler
+ */
+struct SchedulerCounters {
+    size_t completed = 0;
+    size_t retries = 0;
+    /**
+     * @brief 429 responses
+     */
+    size_t throttled = 0;
+    /**
+     * @brief 5xx responses
+     */
+    size_t serverErrors = 0;
+    /**
+     * @brief Transfers that failed without response
+     */
+    size_t networkErrors = 0;
+    /**
+     * @brief Requests that failed after their last retry, or got a 4xx response
+     */
+    size_t failed = 0;
+    size_t concurrencyIncreases = 0;
+    size_t concurrencyDecreases = 0;
+
+    /**
+     * @brief Add the counters of other requests
+     */
+    SchedulerCounters& operator+=(const SchedulerCounters& o) {
+        completed += o.completed;
+        retries += o.retries;
+        throttled += o.throttled;
+        serverErrors += o.serverErrors;
+        networkErrors += o.networkErrors;
+        failed += o.failed;
+        concurrencyIncreases += o.concurrencyIncreases;
+        concurrencyDecreases += o.concurrencyDecreases;
+        return *this;
+    }
+};
+
+/**
+ * @brief Token bucket rate limiter
+ */
+class TokenBucket {
+
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief TokenBucket constructor, the bucket starts full
+     * @param ratePerSecond Tokens added per second, 0 for no limit
+     * @param burst Max tokens in the bucket
+     */
+    TokenBucket(double ratePerSecond, double burst);
+
+    /**
+     * @brief Take a token if there is one
+     * @param now Current time
+     * @return False if the bucket is empty
+     */
+    bool tryTake(Clock::time_point now);
+
+    /**
+     * @brief Time until a token is available
+     * @param now Current time
+     * @return 0 if there is one already
+     */
+    Clock::duration waitTime(Clock::time_point now) const;
+
+private:
+
+    void refill(Clock::time_point now);
+
+    double rate;
+    double capacity;
+    double tokens;
+    Clock::time_point last;
+};
+
+/**
+ * @brief Decides when requests to the provider start, how many run at once and which are retried
+ *
+ * Requests are started at the pace of a token bucket. The number of requests
+ * in flight grows by one every time as many requests succeeded in a row
+ * (additive increase), and is halved when the provider throttles or fails
+ * (multiplicative decrease), so it settles around what the provider tolerates.
+ * Throttled, failed and 5xx requests are retried after an exponential backoff
+ * with full jitter, a throttled response also pauses every new request for that
+ * backoff or for the Retry-After of the response, never longer than maxBackoff.
+ *
+ * Thread safe, one scheduler can be shared by several FetchEngine runs, at the
+ * same time or one after the other, so what it learnt about the provider is kept.
+ * The limit of requests in flight holds for all of them together. The pause is
+ * the provider's and is meant to outlive the run that got throttled: a later run
+ * waits for the rest of it, which is at most maxBackoff.
+ */
+class RequestScheduler {
+
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief How a request ended
+     */
+    enum class Outcome {
+        Success,
+        Throttled,
+        ServerError,
+        NetworkError,
+        Rejected
+    };
+
+    /**
+     * @brief Outcome of a transfer
+     * @param transferOk False if the transfer failed (connection, timeout...)
+     * @param httpCode HTTP status code of the response, 0 if none
+     * @return Outcome
+     */
+    static Outcome classify(bool transferOk, long httpCode);
+
+    /**
+     * @brief RequestScheduler constructor
+     * @param options Tuning
+     */
+    explicit RequestScheduler(const SchedulerOptions& options = SchedulerOptions());
+
+    /**
+     * @brief Number of requests allowed in flight right now
+     */
+    size_t concurrency() const;
+
+    /**
+     * @brief Max number of requests ever allowed in flight
+     */
+    size_t maxConcurrency() const;
+
+    /**
+     * @brief Take the right to start a request now, to give back with release() once it ended
+     * @param now Current time
+     * @return False if a throttling pause, the rate limit or the requests in flight forbid it
+     */
+    bool tryAcquire(Clock::time_point now);
+
+    /**
+     * @brief Give back the right taken by tryAcquire(), whether the request is retried or not
+     */
+    void release();
+
+    /**
+     * @brief Number of requests started and not released yet, by every run sharing the scheduler
+     */
+    size_t running() const;
+
+    /**
+     * @brief Time until tryAcquire() can succeed
+     * @param now Current time
+     * @return 0 if a request can start now, a short poll interval while too many are in flight
+     */
+    Clock::duration waitTime(Clock::time_point now) const;
+
+    /**
+     * @brief Record how a request ended and adapt the concurrency
+     * @param outcome How the request ended
+     * @param attempt Number of retries the request already had
+     * @param retryAfter Retry-After of the response, 0 if none
+     * @param now Current time
+     * @param retryDelay Set to the delay before the retry
+     * @param runCounters Also counted in, e.g. the counters of one run, can be null
+     * @return True if the request must be retried
+     */
+    bool onCompleted(Outcome outcome,
+                     int attempt,
+                     Clock::duration retryAfter,
+                     Clock::time_point now,
+                     Clock::duration& retryDelay,
+                     SchedulerCounters *runCounters = nullptr);
+
+    /**
+     * @brief What happened so far, to the requests of every run sharing the scheduler
+     */
+    SchedulerCounters counters() const;
+
+    /**
+     * @brief Forget what happened so far, the learnt concurrency and the pause are kept
+     */
+    void resetCounters();
+
+private:
+
+    /**
+     * @brief Exponential backoff with full jitter
+     */
+    Clock::duration backoff(int attempt);
+
+    SchedulerOptions options;
+
+    mutable std::mutex mutex;
+
+    TokenBucket bucket;
+
+    /**
+     * @brief Requests allowed in flight, learnt from the outcomes
+     */
+    size_t inFlight;
+
+    /**
+     * @brief Requests acquired and not released yet
+     */
+    size_t started = 0;
+
+    /**
+     * @brief Successes since the last concurrency change
+     */
+    size_t successes = 0;
+
+    /**
+     * @brief No request starts before, set by throttled responses
+     */
+    Clock::time_point pausedUntil;
+
+    /**
+     * @brief Decreases are at most one per backoff, the requests in flight fail together
+     */
+    Clock::time_point lastDecrease;
+
+    std::mt19937 random;
+
+    SchedulerCounters stats;
+};
+}
+#endif /* REQUEST_SCHEDULER_HPP */
@@ -0,0 +1,85 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace YahooFinance{
+
+/**
+ * @brief Non owning view of contiguous elements, the C++17 stand-in for std::span
+ *
+ * Only valid as long as the viewed storage is neither modified nor destroyed.
+ */
+template<typename T>
+class Span {
+
+public:
+
+    typedef T element_type;
+    typedef T* iterator;
+
+    Span() : first(nullptr), count(0) {}
+
+    Span(T *first, std::size_t count) : first(first), count(count) {}
+
+    Span(T *first, T *last) : first(first), count(last - first) {}
+
+    template<typename U>
+    Span(const std::vector<U>& v) : first(v.data()), count(v.size()) {}
+
+    template<typename U>
+    Span(std::vector<U>& v) : first(v.data()), count(v.size()) {}
+
+    T* begin() const { return this->first; }
+
+    T* end() const { return this->first + this->count; }
+
+    T* data() const { return this->first; }
+
+    std::size_t size() const { return this->count; }
+
+    bool empty() const { return this->count == 0; }
+
+    T& operator[](std::size_t i) const { return this->first[i]; }
+
+    /**
+     * @brief Element getter with bound check
+     * @param i element index
+     * @return Element i, throws std::out_of_range past the end
+     */
+    T& at(std::size_t i) const {
+        if (i >= this->count) {
+            throw std::out_of_range("Span::at");
+        }
+        return this->first[i];
+    }
+
+    T& front() const { return this->first[0]; }
+
+    T& back() const { return this->first[this->count - 1]; }
+
+    /**
+     * @brief View of a part of the elements
+     * @param offset Index of the first element
+     * @param n Number of elements, clamped to the end
+     */
+    Span subspan(std::size_t offset, std::size_t n) const {
+        if (offset > this->count) {
+            offset = this->count;
+        }
+        if (n > this->count - offset) {
+            n = this->count - offset;
+        }
+        return Span(this->first + offset, n);
+    }
+
+private:
+
+    T *first;
+
+    std::size_t count;
+};
+}
+#endif /* SPAN_HPP */
@@ -0,0 +1,147 @@
+#include "spot_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace YahooFinance{
+
+namespace {
+    const std::time_t ONE_DAY = 24 * 60 * 60;
+    const char HEADER[] = "urph-fin-spots";
+
+    inline std::time_t dayOf(std::time_t t) {
+        return t - ((t % ONE_DAY) + ONE_DAY) % ONE_DAY;
+    }
+}
+
+SpotCache::SpotCache(std::string directory) {
+    this->directory = std::move(directory);
+}
+
+std::string SpotCache::defaultDirectory() {
+    const char *dir = std::getenv("QUOTE_CACHE_DIR");
+    if (dir != nullptr) {
+        return dir;
+    }
+#ifdef _WIN32
+    const char *home = std::getenv("USERPROFILE");
+#else
+    const char *home = std::getenv("HOME");
+#endif
+    if (home == nullptr) {
+        return std::string();
+    }
+    return (std::filesystem::path(home) / ".urph-fin" / "quotes").string();
+}
+
+std::string SpotCache::path(const std::string& symbol) const {
+    std::string name = symbol;
+    std::replace_if(name.begin(), name.end(), [](char c) {
+        return c == '/' || c == '\\' || c == ':';
+    }, '_');
+    return (std::filesystem::path(this->directory) / (name + ".csv")).string();
+}
+
+CachedSpots SpotCache::read(const std::string& symbol) {
+    CachedSpots cached;
+    std::ifstream in(this->path(symbol));
+    if (!in) {
+        return cached;
+    }
+
+    // header line: urph-fin-spots,<covered from>,<covered to>
+    std::string line;
+    if (!std::getline(in, line) || line.compare(0, sizeof(HEADER) - 1, HEADER) != 0) {
+        return cached;
+    }
+    long long from = 0, to = 0;
+    if (std::sscanf(line.c_str() + sizeof(HEADER) - 1, ",%lld,%lld", &from, &to) != 2) {
+        return cached;
+    }
+
+    // spot lines: <date>,<open>,<high>,<low>,<close>
+    while (std::getline(in, line)) {
+        long long date;
+        double open, high, low, close;
+        if (std::sscanf(line.c_str(), "%lld,%lf,%lf,%lf,%lf", &date, &open, &high, &low, &close) == 5) {
+            cached.spots.emplace_back((std::time_t)date, open, high, low, close);
+        }
+    }
+    cached.coveredFrom = (std::time_t)from;
+    cached.coveredTo = (std::time_t)to;
+    return cached;
+}
+
+void SpotCache::write(const std::string& symbol, const CachedSpots& cached) {
+    if (this->directory.empty() || cached.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    std::error_code ec;
+    std::filesystem::create_directories(this->directory, ec);
+
+    const std::string target = this->path(symbol);
+    const std::string tmp = target + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out.precision(std::numeric_limits<double>::max_digits10);
+        out << HEADER << "," << (long long)cached.coveredFrom << "," << (long long)cached.coveredTo << "\n";
+        for (auto spot: cached.spots) {
+            if (spot.getDate() > cached.coveredTo) {
+                continue;
+            }
+            out << (long long)spot.getDate() << ","
+                << spot.getOpen() << ","
+                << spot.getHigh() << ","
+                << spot.getLow() << ","
+                << spot.getClose() << "\n";
+        }
+        if (!out) {
+            return;
+        }
+    }
+    // readers never see a half written file
+    std::filesystem::rename(tmp, target, ec);
+}
+
+bool SpotCache::missingPeriod(const CachedSpots& cached,
+                              std::time_t period1,
+                              std::time_t period2,
+                              std::time_t& from,
+                              std::time_t& to) {
+    from = period1;
+    to = period2;
+    if (cached.empty()) {
+        return true;
+    }
+
+    // spots are dated at the begining of their day, compare days only
+    const bool coversBegining = dayOf(period1) >= dayOf(cached.coveredFrom);
+    const bool coversEnding = dayOf(period2) <= dayOf(cached.coveredTo);
+
+    if (coversBegining && coversEnding) {
+        return false;
+    }
+    if (coversBegining) {
+        from = dayOf(cached.coveredTo) + ONE_DAY;
+    }
+    else if (coversEnding) {
+        to = dayOf(cached.coveredFrom) - 1;
+    }
+    return from <= to;
+}
+
+std::time_t SpotCache::closedUntil(std::time_t now) {
+    return now - ONE_DAY;
+}
+
+}
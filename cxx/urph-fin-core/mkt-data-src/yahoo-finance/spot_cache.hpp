@@ -0,0 +1,103 @@
+#ifndef SPOT_CACHE_HPP
+#define SPOT_CACHE_HPP
+
+#include "spot.hpp"
+
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace YahooFinance{
+
+/**
+ * @brief Daily spots of one symbol read from or written to the cache
+ *
+ * Every trading day in [coveredFrom, coveredTo] is in spots, a day in that
+ * range without spot is a day without trading.
+ */
+struct CachedSpots {
+    std::time_t coveredFrom = 0;
+    std::time_t coveredTo = 0;
+    std::vector<Spot> spots;
+
+    /**
+     * @brief Whether anything was cached
+     */
+    bool empty() const { return coveredTo <= coveredFrom; }
+};
+
+/**
+ * @brief File backed cache of closed daily spots, one CSV file per symbol
+ */
+class SpotCache {
+
+public:
+
+    /**
+     * @brief SpotCache constructor
+     * @param directory Directory holding the cache files, created on first write
+     */
+    explicit SpotCache(std::string directory);
+
+    /**
+     * @brief Default cache directory: $QUOTE_CACHE_DIR or ~/.urph-fin/quotes
+     * @return Directory, empty if it cannot be determined
+     */
+    static std::string defaultDirectory();
+
+    /**
+     * @brief Read the cached spots of a symbol
+     * @param symbol Quote symbol
+     * @return Cached spots sorted by date, empty if nothing is cached
+     */
+    CachedSpots read(const std::string& symbol);
+
+    /**
+     * @brief Replace the cached spots of a symbol
+     * @param symbol Quote symbol
+     * @param cached Spots to write, only the ones up to cached.coveredTo are written
+     */
+    void write(const std::string& symbol, const CachedSpots& cached);
+
+    /**
+     * @brief Find the period still to be downloaded
+     * @param cached Spots read from the cache
+     * @param period1 Begining of the wanted period (POSIX timestamp)
+     * @param period2 Ending of the wanted period (POSIX timestamp)
+     * @param from Set to the begining of the period to download
+     * @param to Set to the ending of the period to download
+     * @return False if the cache has every day of the wanted period
+     */
+    static bool missingPeriod(const CachedSpots& cached,
+                              std::time_t period1,
+                              std::time_t period2,
+                              std::time_t& from,
+                              std::time_t& to);
+
+    /**
+     * @brief Last timestamp whose daily spot cannot change any more
+     * @param now Current POSIX timestamp
+     * @return now minus one day, by then every market has closed that day
+     */
+    static std::time_t closedUntil(std::time_t now);
+
+private:
+
+    /**
+     * @brief Cache file path of a symbol
+     */
+    std::string path(const std::string& symbol) const;
+
+    /**
+     * @brief Directory holding the cache files
+     */
+    std::string directory;
+
+    /**
+     * @brief Serializes writers of this process
+     */
+    std::mutex mutex;
+};
+}
+#endif /* SPOT_CACHE_HPP */
@@ -0,0 +1,250 @@
+#ifndef SPOT_CSV_HPP
+#define SPOT_CSV_HPP
+
+#include "../../src/civil_date.hxx"
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+// floating point from_chars needs GCC 11, MSVC 2019 16.4 or a recent libc++, strtod in the "C" locale otherwise
+#ifndef __cpp_lib_to_chars
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#endif
+
+namespace YahooFinance{
+
+/**
+ * @brief Decode a yyyy-MM-dd date
+ * @param s Date, anything after the 10th character is ignored
+ * @param epoch Set to the POSIX timestamp of the date at 00:00 UTC
+ * @return False if the date is malformed
+ */
+inline bool parseIsoDate(std::string_view s, std::time_t& epoch) {
+    int64_t e = 0;
+    if (!civil::parse_date(s, e)) {
+        return false;
+    }
+    epoch = static_cast<std::time_t>(e);
+    return true;
+}
+
+/**
+ * @brief Decode a number
+ * @param s Number, the whole view must be consumed
+ * @param v Set to the number
+ * @return False if s is not a number ("null" etc.)
+ */
+inline bool parseDouble(std::string_view s, double& v) {
+#ifdef __cpp_lib_to_chars
+    const char *last = s.data() + s.size();
+    auto r = std::from_chars(s.data(), last, v);
+    return r.ec == std::errc() && r.ptr == last;
+#else
+    // what from_chars rejects: spaces, a plus sign, hex; the decimal point is '.' whatever the app locale is
+    char buf[64];
+    if (s.empty() || s.size() >= sizeof(buf) || s[0] == '+' || s[0] == ' ' || s[0] == '\t' ||
+        s.find_first_of("xX") != std::string_view::npos) {
+        return false;
+    }
+    std::memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    static const locale_t cLocale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    char *last = nullptr;
+    const double d = strtod_l(buf, &last, cLocale);
+    if (last != buf + s.size()) {
+        return false;
+    }
+    v = d;
+    return true;
+#endif
+}
+
+/**
+ * @brief Parse a row of a historical CSV file: Date,Open,High,Low,Close[,...]
+ * @param line Row without its line break
+ * @param onSpot Called with (date, open, high, low, close) if the row is valid
+ * @return True if the row is valid
+ */
+template<typename OnSpot>
+bool parseSpotRow(std::string_view line, OnSpot&& onSpot) {
+    std::string_view fields[5];
+    size_t start = 0;
+    for (int i = 0; i < 5; ++i) {
+        if (start > line.size()) {
+            return false;
+        }
+        size_t comma = line.find(',', start);
+        if (comma == std::string_view::npos) {
+            comma = line.size();
+        }
+        fields[i] = line.substr(start, comma - start);
+        start = comma + 1;
+    }
+
+    std::time_t date;
+    double open, high, low, close;
+    if (!parseIsoDate(fields[0], date) ||
+        !parseDouble(fields[1], open) ||
+        !parseDouble(fields[2], high) ||
+        !parseDouble(fields[3], low) ||
+        !parseDouble(fields[4], close)) {
+        return false;
+    }
+    onSpot(date, open, high, low, close);
+    return true;
+}
+
+/**
+ * @brief Parse a historical CSV file without copying it
+ *
+ * The first line is the header, rows with a "null" or malformed field are skipped.
+ *
+ * @param csv Content of the CSV file
+ * @param onSpot Called with (date, open, high, low, close) for every valid row
+ * @return Number of valid rows
+ */
+template<typename OnSpot>
+size_t parseSpotsCsv(std::string_view csv, OnSpot&& onSpot) {
+    size_t pos = csv.find('\n');
+    if (pos == std::string_view::npos) {
+        return 0;
+    }
+    ++pos;
+
+    size_t nbSpots = 0;
+    while (pos < csv.size()) {
+        size_t eol = csv.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            eol = csv.size();
+        }
+        std::string_view line = csv.substr(pos, eol - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (parseSpotRow(line, onSpot)) {
+            ++nbSpots;
+        }
+        pos = eol + 1;
+    }
+    return nbSpots;
+}
+
+/**
+ * @brief Resumable parser of a historical CSV file received in chunks
+ *
+ * Complete rows are parsed in place in the chunk, only a row split between
+ * two chunks is copied, so the memory used is one row whatever the file size.
+ * The first line must be the "Date,..." header, otherwise the body is not a
+ * CSV file (error page...) and is ignored.
+ */
+class SpotCsvStream {
+
+public:
+
+    /**
+     * @brief Parse the complete rows of a chunk
+     * @param chunk Next bytes of the body
+     * @param onSpot Called with (date, open, high, low, close) for every valid row
+     */
+    template<typename OnSpot>
+    void feed(std::string_view chunk, OnSpot&& onSpot) {
+        while (!chunk.empty() && !this->rejected) {
+            const size_t eol = chunk.find('\n');
+            if (eol == std::string_view::npos) {
+                this->keep(chunk);
+                return;
+            }
+            if (this->pending.empty()) {
+                this->line(chunk.substr(0, eol), onSpot);
+            }
+            else {
+                this->pending.append(chunk.data(), eol);
+                this->line(this->pending, onSpot);
+                this->pending.clear();
+            }
+            chunk.remove_prefix(eol + 1);
+        }
+    }
+
+    /**
+     * @brief Parse the last row when the body does not end with a line break
+     * @param onSpot Called with (date, open, high, low, close) if the row is valid
+     */
+    template<typename OnSpot>
+    void finish(OnSpot&& onSpot) {
+        if (!this->pending.empty() && !this->rejected) {
+            this->line(this->pending, onSpot);
+        }
+        this->pending.clear();
+    }
+
+    /**
+     * @brief Whether the body started with the CSV header
+     */
+    bool isCsv() const { return this->headerParsed && !this->rejected; }
+
+    /**
+     * @brief Number of valid rows so far
+     */
+    size_t nbSpots() const { return this->spots; }
+
+    /**
+     * @brief Get ready for another body
+     */
+    void reset() {
+        this->pending.clear();
+        this->headerParsed = false;
+        this->rejected = false;
+        this->spots = 0;
+    }
+
+private:
+
+    /**
+     * @brief Longest row or header kept between chunks, anything longer is no spots CSV
+     */
+    static const size_t MAX_LINE = 4096;
+
+    void keep(std::string_view partial) {
+        if (this->pending.size() + partial.size() > MAX_LINE) {
+            this->rejected = true;
+            this->pending.clear();
+            return;
+        }
+        this->pending.append(partial.data(), partial.size());
+    }
+
+    template<typename OnSpot>
+    void line(std::string_view l, OnSpot& onSpot) {
+        if (!l.empty() && l.back() == '\r') {
+            l.remove_suffix(1);
+        }
+        if (!this->headerParsed) {
+            this->headerParsed = true;
+            this->rejected = l.substr(0, 5) != "Date,";
+            return;
+        }
+        if (parseSpotRow(l, onSpot)) {
+            ++this->spots;
+        }
+    }
+
+    std::string pending;
+
+    bool headerParsed = false;
+
+    bool rejected = false;
+
+    size_t spots = 0;
+};
+
+}
+#endif /* SPOT_CSV_HPP */
@@ -13,7 +13,7 @@ std::time_t currentEpoch();
 /**
  * @brief Convert date to POSIX timestamp
  * @param date Date to convert in yyyy-MM-dd format (ignore hour)
- * @return Date in epoch format
+ * @return Date in epoch format, 0 if date is malformed
  */
 std::time_t dateToEpoch(const char *date);
 
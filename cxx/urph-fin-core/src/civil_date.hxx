@@ -0,0 +1,199 @@
+#ifndef CIVIL_DATE_HXX_
+#define CIVIL_DATE_HXX_
+
+// Date arithmetic and formatting without libc time functions:
+// no strftime/put_time/stringstream, no static tm buffer (gmtime/localtime
+// are not thread safe), no allocation. Everything but the local time zone
+// offset is constexpr.
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+namespace civil{
+
+constexpr int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+struct ymd{
+    int64_t year;
+    unsigned month; // [1, 12]
+    unsigned day;   // [1, 31]
+};
+
+// rounds toward negative infinity, dates before 1970 have a negative epoch
+constexpr int64_t floor_div(int64_t a, int64_t b)
+{
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+// days since 1970-01-01, http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+constexpr int64_t days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// inverse of days_from_civil
+constexpr ymd civil_from_days(int64_t z)
+{
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    return ymd{static_cast<int64_t>(yoe) + era * 400 + (m <= 2), m, d};
+}
+
+constexpr bool is_leap(int64_t y)
+{
+    return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+// m in [1, 12]
+constexpr unsigned last_day_of_month(int64_t y, unsigned m)
+{
+    return m == 2 ? (is_leap(y) ? 29 : 28) : (m == 4 || m == 6 || m == 9 || m == 11 ? 30 : 31);
+}
+
+constexpr int64_t days_from_epoch(int64_t epoch)
+{
+    return floor_div(epoch, SECONDS_PER_DAY);
+}
+
+// epoch of 00:00 UTC of the day of epoch
+constexpr int64_t start_of_day(int64_t epoch)
+{
+    return days_from_epoch(epoch) * SECONDS_PER_DAY;
+}
+
+constexpr ymd civil_from_epoch(int64_t epoch)
+{
+    return civil_from_days(days_from_epoch(epoch));
+}
+
+constexpr int64_t epoch_from_civil(int64_t y, unsigned m, unsigned d)
+{
+    return days_from_civil(y, m, d) * SECONDS_PER_DAY;
+}
+
+// "yyyy-MM-dd" (or "yyyyMMdd" with sep '\0'), anything after the date is ignored
+// returns false if s is malformed or no such date, epoch is 00:00 UTC of the date
+constexpr bool parse_date(std::string_view s, int64_t& epoch, char sep = '-')
+{
+    const size_t len = sep == '\0' ? 8 : 10;
+    if(s.size() < len) return false;
+    if(sep != '\0' && (s[4] != sep || s[7] != sep)) return false;
+
+    unsigned v[8] = {};
+    for(size_t i = 0, j = 0; i < len; ++i){
+        if(sep != '\0' && (i == 4 || i == 7)) continue;
+        const unsigned digit = static_cast<unsigned>(s[i] - '0');
+        if(digit > 9) return false;
+        v[j++] = digit;
+    }
+    const int64_t y = v[0] * 1000 + v[1] * 100 + v[2] * 10 + v[3];
+    const unsigned m = v[4] * 10 + v[5];
+    const unsigned d = v[6] * 10 + v[7];
+    if(m < 1 || m > 12 || d < 1 || d > last_day_of_month(y, m)) return false;
+    epoch = epoch_from_civil(y, m, d);
+    return true;
+}
+
+namespace detail{
+    constexpr char* digits(char* out, int64_t v, int width)
+    {
+        for(int i = width - 1; i >= 0; --i){
+            out[i] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        }
+        return out + width;
+    }
+}
+
+// buffer sizes, without terminating null
+constexpr size_t DATE_LEN = 10;      // yyyy-MM-dd
+constexpr size_t COMPACT_DATE_LEN = 8; // yyyyMMdd
+constexpr size_t DATE_TIME_LEN = 19; // yyyy-MM-dd HH:mm:ss
+
+// writes yyyy-MM-dd (UTC) for years 0 to 9999, returns the end of what was written
+constexpr char* format_date(int64_t epoch, char* out)
+{
+    const ymd c = civil_from_epoch(epoch);
+    out = detail::digits(out, c.year, 4);
+    *out++ = '-';
+    out = detail::digits(out, c.month, 2);
+    *out++ = '-';
+    return detail::digits(out, c.day, 2);
+}
+
+// writes yyyyMMdd (UTC), the document id format of the cloud storages
+constexpr char* format_compact_date(int64_t epoch, char* out)
+{
+    const ymd c = civil_from_epoch(epoch);
+    out = detail::digits(out, c.year, 4);
+    out = detail::digits(out, c.month, 2);
+    return detail::digits(out, c.day, 2);
+}
+
+// writes yyyy-MM-dd HH:mm:ss of epoch shifted by offset seconds (0 for UTC)
+constexpr char* format_date_time(int64_t epoch, char* out, int64_t offset = 0)
+{
+    const int64_t t = epoch + offset;
+    out = format_date(t, out);
+    const int64_t s = t - start_of_day(t);
+    *out++ = ' ';
+    out = detail::digits(out, s / 3600, 2);
+    *out++ = ':';
+    out = detail::digits(out, s / 60 % 60, 2);
+    *out++ = ':';
+    return detail::digits(out, s % 60, 2);
+}
+
+inline std::string to_date_string(int64_t epoch)
+{
+    char buf[DATE_LEN];
+    return std::string(buf, format_date(epoch, buf));
+}
+
+// seconds to add to an UTC epoch to get the local time, e.g. 32400 in Japan
+// calls the thread safe localtime_r/localtime_s once per hour of epoch and thread, then hits a small cache
+inline int64_t local_utc_offset(int64_t epoch)
+{
+    struct entry{ int64_t hour = INT64_MIN; int64_t offset = 0; };
+    constexpr size_t SLOTS = 64;
+    thread_local entry cache[SLOTS];
+
+    const int64_t hour = floor_div(epoch, 3600);
+    entry& e = cache[static_cast<uint64_t>(hour) % SLOTS];
+    if(e.hour != hour){
+        const std::time_t t = static_cast<std::time_t>(hour * 3600);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &t);
+#else
+        localtime_r(&t, &local);
+#endif
+        const int64_t local_epoch = epoch_from_civil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday)
+            + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+        e.offset = local_epoch - static_cast<int64_t>(t);
+        e.hour = hour;
+    }
+    return e.offset;
+}
+
+// writes yyyy-MM-dd HH:mm:ss in the local time zone
+inline char* format_local_date_time(int64_t epoch, char* out)
+{
+    return format_date_time(epoch, out, local_utc_offset(epoch));
+}
+
+}
+#endif // CIVIL_DATE_HXX_
@@ -0,0 +1,96 @@
+#include "arena.hxx"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace{
+    inline char* align_up(char* p, size_t align)
+    {
+        const auto v = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char*>((v + align - 1) & ~(uintptr_t)(align - 1));
+    }
+}
+
+Arena* Arena::create(size_t block_size)
+{
+    const size_t header = sizeof(Arena) + OWNER_SIZE;
+    auto* p = static_cast<char*>(::operator new(header + block_size));
+    return new (p) Arena(p + header, p + header + block_size, std::min(block_size * 2, MAX_BLOCK_SIZE));
+}
+
+Arena::Arena(char* b, char* e, size_t block_size): cur(b), end(e), next_block_size(block_size)
+{
+}
+
+void Arena::release(Arena* arena)
+{
+    if(arena == nullptr) return;
+    if(arena->shares.fetch_sub(1, std::memory_order_acq_rel) > 0) return;
+    if(arena->held){
+        arena->release_pending = true;
+        return;
+    }
+    for(Block* b = arena->last_block; b != nullptr;){
+        Block* prev = b->prev;
+        ::operator delete(b);
+        b = prev;
+    }
+    // the owner and the arena are in the first block, nothing to destroy: all of them are C structs
+    arena->~Arena();
+    ::operator delete(arena);
+}
+
+void Arena::unhold(Arena* arena)
+{
+    if(arena == nullptr) return;
+    arena->held = false;
+    if(!arena->owned || arena->release_pending) release(arena);
+}
+
+void* Arena::allocate(size_t size, size_t align)
+{
+    char* p = align_up(cur, align);
+    if(p + size > end){
+        return allocate_in_new_block(size, align);
+    }
+    cur = p + size;
+    used += size;
+    return p;
+}
+
+void* Arena::allocate_in_new_block(size_t size, size_t align)
+{
+    const size_t header = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    const size_t block_size = std::max(next_block_size, size + align);
+    auto* raw = static_cast<char*>(::operator new(header + block_size));
+    auto* b = reinterpret_cast<Block*>(raw);
+    b->prev = last_block;
+    b->size = block_size;
+    last_block = b;
+    ++blocks;
+    next_block_size = std::min(next_block_size * 2, MAX_BLOCK_SIZE);
+
+    cur = raw + header;
+    end = cur + block_size;
+    char* p = align_up(cur, align);
+    cur = p + size;
+    used += size;
+    return p;
+}
+
+char* Arena::copy_str(const std::string_view& s)
+{
+    auto* p = static_cast<char*>(allocate(s.size() + 1, 1));
+    std::memcpy(p, s.data(), s.size());
+    p[s.size()] = 0;
+    return p;
+}
+
+bool Arena::extend(void* p, size_t old_size, size_t new_size)
+{
+    auto* c = static_cast<char*>(p);
+    if(c + old_size != cur || c + new_size > end) return false;
+    cur = c + new_size;
+    used += new_size - old_size;
+    return true;
+}
@@ -0,0 +1,175 @@
+#ifndef URPH_FIN_ARENA_HXX_
+#define URPH_FIN_ARENA_HXX_
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Monotonic allocator for the object graph of one C result (quotes, funds, stock portfolio, brokers).
+// The structs and strings of the graph are bumped one after another in a few blocks, nothing is
+// freed on its own: releasing the arena frees the whole graph at once.
+//
+// The arena sits at the start of its first block, followed by a slot for the top level result,
+// so the result finds its arena without any extra member (the C structs layout is fixed):
+//   [Arena][top level result][structs and strings ...]
+class alignas(std::max_align_t) Arena{
+public:
+    // room for the top level result, all of them are a handful of pointers and counters
+    static constexpr size_t OWNER_SIZE = 64;
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
+    // blocks double up to this size
+    static constexpr size_t MAX_BLOCK_SIZE = 1 << 20;
+
+    // the first block holds at least block_size bytes after the arena and the result slot
+    static Arena* create(size_t block_size = DEFAULT_BLOCK_SIZE);
+    // frees every block, the top level result and the arena itself included, null is ignored
+    // deferred to unhold() while the arena is held
+    static void release(Arena* arena);
+
+    // a builder holds its arena until it is done with it: the result may be freed
+    // by the success callback before the builder returns
+    inline void hold() { held = true; }
+    // releases the arena unless it has a top level result that was not freed yet
+    static void unhold(Arena* arena);
+
+    // one more owner of the top level result, such as a cache handing it out: each owner frees it
+    // and the last release() frees the arena
+    inline void share() { shares.fetch_add(1, std::memory_order_relaxed); }
+
+    // arena of a top level result created by create_owner()
+    template<typename R>
+    static Arena* of(R* owner){
+        return reinterpret_cast<Arena*>(reinterpret_cast<char*>(owner) - sizeof(Arena));
+    }
+
+    // storage of the top level result, the result constructed there owns the arena
+    template<typename R>
+    void* owner_slot(){
+        static_assert(sizeof(R) <= OWNER_SIZE, "top level result does not fit its slot");
+        static_assert(alignof(R) <= alignof(std::max_align_t));
+        owned = true;
+        return reinterpret_cast<char*>(this) + sizeof(Arena);
+    }
+
+    // constructs the top level result in its slot
+    template<typename R, typename... Args>
+    R* create_owner(Args&&... args){
+        return new (owner_slot<R>()) R(std::forward<Args>(args)...);
+    }
+    inline bool has_owner() const { return owned; }
+
+    // a view of the top level result built along with it in this arena, such as the columns of a fund portfolio
+    inline void set_companion(void* p) { companion_ptr = p; }
+    template<typename T>
+    T* companion() const { return static_cast<T*>(companion_ptr); }
+
+    void* allocate(size_t size, size_t align);
+
+    // uninitialized storage for n T
+    template<typename T>
+    T* allocate_array(size_t n){
+        return static_cast<T*>(allocate(sizeof(T) * n, alignof(T)));
+    }
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args){
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // null terminated copy
+    char* copy_str(const std::string_view& s);
+
+    // grows the last allocation in place if its block has room
+    bool extend(void* p, size_t old_size, size_t new_size);
+
+    inline size_t used_bytes() const { return used; }
+    inline int block_num() const { return blocks; }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+private:
+    // header of every block but the first one
+    struct Block{
+        Block* prev;
+        size_t size;
+    };
+
+    Arena(char* begin, char* end, size_t block_size);
+    ~Arena() = default;
+    void* allocate_in_new_block(size_t size, size_t align);
+
+    Block* last_block = nullptr;
+    void* companion_ptr = nullptr;
+    char* cur;
+    char* end;
+    size_t next_block_size;
+    size_t used = 0;
+    int blocks = 1;
+    // owners besides the first one
+    std::atomic<int> shares{0};
+    bool owned = false;
+    bool held = false;
+    bool release_pending = false;
+};
+
+// frees the object graph of a top level result created by Arena::create_owner()
+template<typename R>
+inline void release_owner(R* owner)
+{
+    if(owner != nullptr) Arena::release(Arena::of(owner));
+}
+
+// Growable array of C structs in an arena, what PlacementNew is to the heap.
+// The slots are not constructed until next() hands them out, growing copies the
+// structs to a bigger array of the same arena, in place when nothing was allocated after it.
+template<typename T>
+class ArenaArray{
+    static_assert(std::is_trivially_copyable_v<T>, "only C structs can be moved around by memcpy");
+
+    Arena& _arena;
+    T* _head;
+    T* _current;
+    int _max_counter;
+    float _ratio;
+public:
+    ArenaArray(Arena& arena, int max_num, float increment_ratio = 0.5):
+        _arena(arena),
+        _head(arena.allocate_array<T>(max_num)),
+        _current(_head),
+        _max_counter(max_num),
+        _ratio(1 + increment_ratio){}
+
+    ArenaArray(const ArenaArray&) = delete;
+    ArenaArray& operator=(const ArenaArray&) = delete;
+
+    inline Arena& arena() const { return _arena; }
+    inline long allocated_num() const { return _current - _head;}
+    inline T* end() const{ return _current;}
+    inline bool has_enough_counter() const { return allocated_num() >= _max_counter;}
+    inline int inc_counter() { return allocated_num(); }
+    inline T* head() const { return _head; }
+    inline int counter() const { return allocated_num(); }
+    inline int max_counter() const { return _max_counter; }
+    T* next(){
+        if(allocated_num() >= _max_counter){
+            int new_max = std::ceil(_max_counter * _ratio);
+            if(new_max <= _max_counter) new_max = _max_counter + 1;
+            if(!_arena.extend(_head, sizeof(T) * _max_counter, sizeof(T) * new_max)){
+                auto* p = _arena.allocate_array<T>(new_max);
+                std::memcpy(static_cast<void*>(p), _head, sizeof(T) * _max_counter);
+                _head = p;
+                _current = p + _max_counter;
+            }
+            _max_counter = new_max;
+        }
+        return _current++;
+    }
+};
+
+#endif
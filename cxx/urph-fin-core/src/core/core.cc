@@ -9,6 +9,7 @@
 
 #include <cstring>
 #include <cassert>
+#include <cmath>
 #include <numeric>
 #include <mutex>
 #include <condition_variable>
@@ -17,6 +18,7 @@
 #include <thread>
 #include <chrono>
 #include <tuple>
+#include <utility>
 
 #include "../storage/storage.hxx"
 #include "urph-fin-core.hxx"
@@ -24,11 +26,21 @@
 
 #include "../utils.hxx"
 #include "core_internal.hxx"
+#include "arena.hxx"
+#include "intern.hxx"
+#include "fund_columns.hxx"
+#include "overview.hxx"
+#include "handle_table.hxx"
 
 #include "../storage/storage.hxx"
 
 #ifdef YAHOO_FINANCE
 #include "../../mkt-data-src/yahoo-finance/quote.hpp"
+#include "../../mkt-data-src/yahoo-finance/fetch_engine.hpp"
+#include "../../mkt-data-src/yahoo-finance/spot_cache.hpp"
+#include "../../mkt-data-src/yahoo-finance/last_spots.hpp"
+#include "../../mkt-data-src/yahoo-finance/batch_quote.hpp"
+#include "../../mkt-data-src/yahoo-finance/curl_utils.hpp"
 #endif
 
 // dont forget to free
@@ -50,37 +62,70 @@ char* copy_str(const std::string& str)
     return copy_str(str.c_str(), str.size());
 }
 
-CashBalance::CashBalance(const std::string_view& n, float v)
+CashBalance::CashBalance(const std::string_view& n, double v)
 {
-    ccy = copy_str(n);
+    // interned names are never written to
+    ccy = const_cast<char*>(intern(n));
     balance = v;
 }
 
-CashBalance::~CashBalance()
+// in front of strs, in the same allocation
+struct Strings::Blob
 {
-    delete[] ccy;
+    char* chars;
+    size_t used;
+    size_t size;
+};
+
+char** Strings::allocate_strs(long capacity)
+{
+    auto* p = static_cast<char*>(::operator new(sizeof(Blob) + sizeof(char*) * capacity));
+    return reinterpret_cast<char**>(p + sizeof(Blob));
 }
 
-Strings::Strings(int n)
+Strings::Blob* Strings::blob() const
+{
+    return reinterpret_cast<Blob*>(reinterpret_cast<char*>(strs) - sizeof(Blob));
+}
+
+Strings::Strings(int n, size_t chars_per_str)
 {
     capacity = n;
-    if(n == 0){
-        strs = nullptr;
-        last_str = nullptr;
-        
-    }
-    else{
-        strs = new char* [n];
-        last_str = strs;
-    }
+    strs = allocate_strs(n);
+    last_str = strs;
+    const size_t size = n * chars_per_str;
+    new (blob()) Blob{size == 0 ? nullptr : new char[size], 0, size};
 }
 
 void Strings::add(const std::string_view& i, float increment_ratio )
 {
     if(size() == capacity){
-        increase_capacity(std::ceil(capacity *  increment_ratio));
+        increase_capacity(std::max<long>(1, std::ceil(capacity *  increment_ratio)));
+    }
+    reserve_chars(i.size() + 1);
+    auto* b = blob();
+    char* p = b->chars + b->used;
+    memcpy(p, i.data(), i.size());
+    p[i.size()] = 0;
+    b->used += i.size() + 1;
+    *last_str++ = p;
+}
+
+void Strings::reserve_chars(size_t n)
+{
+    auto* b = blob();
+    if(b->used + n <= b->size) return;
+
+    const size_t size = std::max(b->size * 2, b->used + n);
+    auto* chars = new char[size];
+    if(b->used > 0) memcpy(chars, b->chars, b->used);
+    // the strings keep their offsets in the new blob
+    for(char** p = strs; p != last_str; ++p){
+        *p = chars + (*p - b->chars);
     }
-    *last_str++ = copy_str(i);
+    delete []b->chars;
+    b->chars = chars;
+    b->size = size;
 }
 
 void Strings::increase_capacity(long additional)
@@ -88,15 +133,14 @@ void Strings::increase_capacity(long additional)
     if(additional <= 0 )  return;
     LDEBUG( "increase strings capacity by " << additional << " from " << capacity);
 
+    const long n = size();
+    auto** new_strs = allocate_strs(capacity + additional);
+    new (reinterpret_cast<char*>(new_strs) - sizeof(Blob)) Blob(*blob());
+    memcpy(new_strs, strs, sizeof(char*) * n);
+    ::operator delete(blob());
     capacity += additional;
-    auto** new_strs = new char*[capacity];
-    auto** new_head = new_strs;
-    for(char** p=strs; p!=last_str; ++p){
-        *new_strs++=*p;
-    }
-    delete []strs;
-    strs = new_head;
-    last_str = new_strs;
+    strs = new_strs;
+    last_str = new_strs + n;
 }
 
 long Strings::size() const
@@ -116,12 +160,9 @@ char** Strings::to_str_array()
 
 Strings::~Strings()
 {
-    for(char** p=strs; p!=last_str; ++p){
-        LDEBUG( *p << ",");
-        delete []*p;
-    }
     LDEBUG(" deleted. capacity=" << capacity << ",allocated=" <<size());
-    delete []strs;
+    delete []blob()->chars;
+    ::operator delete(blob());
 }
 
 void free_strings(strings* ss)
@@ -132,55 +173,38 @@ void free_strings(strings* ss)
 Broker::Broker(const std::string_view&n, int ccy_num, cash_balance* first_ccy_balance, char* yyyymmdd, strings* active_funds)
 {
     LDEBUG( "broker constructor: " << n);
-    name = copy_str(n);
+    name = const_cast<char*>(intern(n));
     num = ccy_num;
     first_cash_balance = first_ccy_balance;
     funds_update_date = yyyymmdd;
     active_fund_ids = active_funds;
 }
 
-Broker::~Broker(){
-    LDEBUG( "freeing broker " << name << " : cash balances:");
-    delete[] name;
-
-    delete[] funds_update_date;
-
-    free_placement_allocated_structs<Broker, CashBalance>(this);
-    delete[] first_cash_balance;
-
-    LDEBUG( " - active funds");
-    free_strings(active_fund_ids);
-    LDEBUG( " - active funds freed!");
-}
-
 AllBrokers::AllBrokers(int n, broker* broker)
 {
     num = n;
     first_broker = broker;
 }
 
-AllBrokers::~AllBrokers()
-{
-    LDEBUG( "freeing " << num << " brokers");
-    free_placement_allocated_structs<AllBrokers, Broker>(this);
-    delete []first_broker;
-}
-
 FundPortfolio::FundPortfolio(int n, fund* f)
 {
     num = n;
     first_fund = f;
 }
-FundPortfolio::~FundPortfolio()
+
+const FundColumns* FundPortfolio::columns()
 {
-    free_placement_allocated_structs<FundPortfolio, Fund>(this);
-    delete []first_fund;
+    Arena* arena = Arena::of(this);
+    if(arena->companion<FundColumns>() == nullptr){
+        arena->set_companion(FundColumns::build(*arena, first_fund, num));
+    }
+    return arena->companion<FundColumns>();
 }
 
-Fund::Fund(const std::string_view& b,  const std::string_view&n, int a, double c, double m, double prc, double p, double r,asset_class_ratio&& ratios, timestamp d)
+Fund::Fund(Arena& arena, const std::string_view& b,  const std::string_view&n, int a, double c, double m, double prc, double p, double r,asset_class_ratio&& ratios, timestamp d)
 {
-    broker = copy_str(b);
-    name = copy_str(n);
+    broker = intern(b);
+    name = arena.copy_str(n);
     amount = a;
     capital = c;
     market_value = m;
@@ -191,102 +215,57 @@ Fund::Fund(const std::string_view& b,  const std::string_view&n, int a, double c
     date = d;
 }
 
-Fund::~Fund()
-{
-    delete []broker;
-    delete []name;
-}
-
-Quote::Quote(const std::string& s, timestamp t, double r)
+Quote::Quote(const std::string_view& s, timestamp t, double r)
 {
-    symbol = copy_str(s);
+    symbol = const_cast<char*>(intern(s));
     date = t;
     rate = r;
 }
 
-Quote::~Quote()
-{
-    delete []symbol;
-}
-
-OverviewItem::OverviewItem(const std::string& n, const std::string& ccy,double v, double v2, double p, double p2)
+OverviewItem::OverviewItem(char* n, char* ccy, double v, double v2, double p, double p2)
 {
-    name = copy_str(n);
-    currency = copy_str(ccy);
+    name = n;
+    currency = ccy;
     value = v;
     value_in_main_ccy = v2;
     profit = p;
     profit_in_main_ccy = p2;
 }
 
-OverviewItem::~OverviewItem()
-{
-    delete []name;
-    delete []currency;
-}
-
-
 OverviewItemList::OverviewItemList(int n, overview_item* head)
 {
     this->num = n;
     this->first = head;
 }
 
-OverviewItemList::~OverviewItemList()
+OverviewItemContainer::OverviewItemContainer(char* n, char* item_name, double sum, double sum_profit, int num, overview_item* head)
 {
-    free_placement_allocated_structs<OverviewItemList, OverviewItem>(this);
-}
-
-OverviewItemContainer::OverviewItemContainer(const std::string& n, const std::string& item_name,double sum, double sum_profit,int num, overview_item* head)
-{
-    name = copy_str(n);
-    this->item_name = copy_str(item_name);
+    name = n;
+    this->item_name = item_name;
     value_sum_in_main_ccy = sum;
     profit_sum_in_main_ccy = sum_profit;
     this->num = num;
     items = head;
 }
-OverviewItemContainer::~OverviewItemContainer()
-{
-    delete []name;
-    delete []item_name;
-    free_placement_allocated_structs<OverviewItemContainer, OverviewItem>(this);
-    delete []items;
-}
-
 
-OverviewItemContainerContainer::OverviewItemContainerContainer(const std::string& name, const std::string& item_name, double sum, double sum_profit, int num, overview_item_container* head)
+OverviewItemContainerContainer::OverviewItemContainerContainer(char* name, char* item_name, double sum, double sum_profit, int num, overview_item_container* head)
 {
-    this->name = copy_str(name);
-    this->item_name = copy_str(item_name);
+    this->name = name;
+    this->item_name = item_name;
     this->num = num;
     value_sum_in_main_ccy = sum;
     profit_sum_in_main_ccy = sum_profit;
     this->containers = head;
 }
-OverviewItemContainerContainer::~OverviewItemContainerContainer()
-{
-    delete []name;
-    delete []item_name;
-    free_placement_allocated_structs<OverviewItemContainerContainer, OverviewItemContainer>(this);
-    delete []containers;
-}
-
 
-Overview::Overview(const std::string& item_name, double value_sum_in_main_ccy, double profit_sum_in_main_ccy,int num, overview_item_container_container* head)
+Overview::Overview(char* item_name, double value_sum_in_main_ccy, double profit_sum_in_main_ccy,int num, overview_item_container_container* head)
 {
-    this->item_name = copy_str(item_name);
+    this->item_name = item_name;
     this->value_sum_in_main_ccy = value_sum_in_main_ccy;
     this->profit_sum_in_main_ccy = profit_sum_in_main_ccy;
     this->num = num;
     this->first = head;
 }
-Overview::~Overview()
-{
-    delete []item_name;
-    free_placement_allocated_structs<Overview, OverviewItemContainerContainer>(this);
-    delete []first;
-}
 
 namespace{
     IDataStorage *storage = nullptr;
@@ -327,6 +306,12 @@ bool urph_fin_core_init(OnDone onInitDone, void* caller_provided_param)
     }
 }
 
+// for unit tests, the storage without urph_fin_core_init, returns the one it replaces
+IDataStorage* set_storage(IDataStorage* s)
+{
+    return std::exchange(storage, s);
+}
+
 void urph_fin_core_close()
 {
     LINFO( "Freeing storage ... ");
@@ -351,8 +336,7 @@ void get_brokers(OnAllBrokers onAllBrokers, void* param)
 
 void free_brokers(all_brokers* b)
 {
-    auto* brokers = static_cast<AllBrokers*>(b);
-    delete brokers;
+    release_owner(static_cast<AllBrokers*>(b));
 }
 
 void get_broker(const char* name, OnBroker onBroker, void* param)
@@ -365,7 +349,7 @@ void get_broker(const char* name, OnBroker onBroker, void* param)
 
 void free_broker(broker* b)
 {
-    delete static_cast<Broker*>(b);
+    release_owner(static_cast<Broker*>(b));
 }
 
 void get_funds(std::vector<FundsParam>& params, OnFunds onFunds, void*param,const std::function<void()>& clean_func)
@@ -440,7 +424,7 @@ void get_active_funds_from_all_brokers(all_brokers *bks, bool free_the_brokers,
     auto *helper = new get_active_funds_async_helper(onFunds, param);
     auto *brokers = static_cast<AllBrokers*>(bks);
     do_get_active_funds_from_all_brokers(brokers, helper, [free_the_brokers, brokers](){
-        if(free_the_brokers) delete brokers;
+        if(free_the_brokers) free_brokers(brokers);
     });
 }
 
@@ -458,13 +442,13 @@ void get_active_funds(const char* broker_name, OnFunds onFunds, void*param)
             h->fund_num = the_broker->size(Broker::active_fund_tag());
             h->fund_update_date = the_broker->funds_update_date;
             h->all_broker_pointers.push_back(the_broker);
-            h->run([the_broker](){delete the_broker;});
+            h->run([the_broker](){free_broker(the_broker);});
         }, helper);
     }else{
         get_brokers([](all_brokers* bks, void* ctx){
             auto *brokers = static_cast<AllBrokers*>(bks);
             auto *h = reinterpret_cast<get_active_funds_async_helper*>(ctx) ;
-            do_get_active_funds_from_all_brokers(brokers, h, [brokers](){delete brokers;});
+            do_get_active_funds_from_all_brokers(brokers, h, [brokers](){free_brokers(brokers);});
         }, helper);
     }
 
@@ -473,22 +457,17 @@ void get_active_funds(const char* broker_name, OnFunds onFunds, void*param)
 
 void free_funds(fund_portfolio* f)
 {
-    auto p = static_cast<FundPortfolio*>(f);
-    delete p;
+    release_owner(static_cast<FundPortfolio*>(f));
 }
 
 
 fund_sum calc_fund_sum(fund_portfolio* portfolio)
 {
-    struct fund_sum init = { 0.0, 0.0, 0.0 };
-
-    auto r = std::accumulate(portfolio->first_fund, portfolio->first_fund + portfolio->num, init, [](fund_sum& sum, fund& f){
-        sum.capital += f.capital;
-        sum.market_value += f.market_value;
-        sum.profit +=  f.market_value - f.capital;
-        return sum;
-    });
-
+    const auto* cols = static_cast<FundPortfolio*>(portfolio)->columns();
+    fund_sum r;
+    r.capital = compensated_sum(cols->capital, cols->num);
+    r.market_value = compensated_sum(cols->market_value, cols->num);
+    r.profit = r.market_value - r.capital;
     r.ROI = r.profit / r.capital;
 
     return r;
@@ -512,8 +491,7 @@ void get_stock_portfolio(const char* broker, const char* symbol, OnAllStockTx ca
 
 void free_stock_portfolio(stock_portfolio *p)
 {
-    auto port = static_cast<StockPortfolio*>(p);
-    delete port;
+    release_owner(static_cast<StockPortfolio*>(p));
 }
 
 stock_balance get_stock_balance(stock_tx_list* tx)
@@ -525,17 +503,116 @@ stock_balance get_stock_balance(stock_tx_list* tx)
 #ifdef YAHOO_FINANCE
 namespace{
     int BACK_DAYS = 5;
-    const char usdjpy[] = "USDJPY=X";
-    const char cnyjpy[] = "CNYJPY=X";
-    const char hkdjpy[] = "HKDJPY=X";
+    // max concurrent quote downloads, can be overridden by env var QUOTE_MAX_IN_FLIGHT
+    int MAX_IN_FLIGHT = 8;
+    // quote requests started per second, can be overridden by env var QUOTE_RATE_LIMIT, 0 means no limit
+    double RATE_LIMIT = 0.0;
+    // max symbols per batched quote request, can be overridden by env var QUOTE_BATCH_SIZE, 0 disables batching.
+    // Off unless asked for: a batch answers intraday prices, not the daily closes the cache and the known spots keep,
+    // so the symbols it answers are downloaded again on the next loading
+    int BATCH_SIZE = 0;
+    // seconds a quote loading may take, can be overridden by env var QUOTE_DEADLINE
+    // the symbols not answered by then get their latest known spot, or no price
+    int DEADLINE = 60;
+    // seconds a single quote request may take, can be overridden by env var QUOTE_REQUEST_TIMEOUT
+    int REQUEST_TIMEOUT = 20;
+    // currencies quoted against FX_PIVOT, can be overridden by env vars QUOTE_FX_CCYS (comma separated) and QUOTE_FX_PIVOT
+    // the rates between any two of them are crossed through the pivot
+    const char FX_CCYS[] = "USD,CNY,HKD";
+    const char FX_PIVOT[] = "JPY";
 
     void add_fx_pairs(strings* symbols)
     {
+        auto* v = getenv("QUOTE_FX_CCYS");
+        const std::string ccys = v == nullptr ? FX_CCYS : v;
+        v = getenv("QUOTE_FX_PIVOT");
+        const std::string pivot = v == nullptr ? FX_PIVOT : v;
+
         auto* const sym = static_cast<Strings* const>(symbols);
-        sym->increase_capacity(3);
-        sym->add(usdjpy);
-        sym->add(cnyjpy);
-        sym->add(hkdjpy);
+        for(size_t b = 0; b < ccys.size();){
+            auto e = std::min(ccys.find(',', b), ccys.size());
+            const auto ccy = ccys.substr(b, e - b);
+            const auto pair = ccy + pivot + "=X";
+            if(ccy != pivot && FxMatrix::is_pair(pair)) sym->add(pair);
+            else LERROR("Ignored FX currency " << ccy << " against " << pivot);
+            b = e + 1;
+        }
+    }
+
+    int max_in_flight()
+    {
+        auto* v = getenv("QUOTE_MAX_IN_FLIGHT");
+        auto n = v == nullptr ? 0 : atoi(v);
+        return n > 0 ? n : MAX_IN_FLIGHT;
+    }
+
+    // shared by every quote loading so the concurrency the provider tolerates is not learnt again each time
+    YahooFinance::RequestScheduler& request_scheduler()
+    {
+        static YahooFinance::RequestScheduler scheduler([](){
+            YahooFinance::SchedulerOptions options;
+            options.maxInFlight = max_in_flight();
+            auto* v = getenv("QUOTE_RATE_LIMIT");
+            options.ratePerSecond = v == nullptr ? RATE_LIMIT : atof(v);
+            options.burst = options.maxInFlight;
+            return options;
+        }());
+        return scheduler;
+    }
+
+    int batch_size()
+    {
+        auto* v = getenv("QUOTE_BATCH_SIZE");
+        auto n = v == nullptr ? -1 : atoi(v);
+        return n >= 0 ? n : BATCH_SIZE;
+    }
+
+    int seconds_from_env(const char* name, int default_seconds)
+    {
+        auto* v = getenv(name);
+        auto n = v == nullptr ? 0 : atoi(v);
+        return n > 0 ? n : default_seconds;
+    }
+
+    // where the quote loading time went, all and c are those of one loading only
+    void log_transfer_stats(const std::vector<TransferStats>& all, const YahooFinance::SchedulerCounters& c)
+    {
+        if(all.empty()) return;
+        int reused = 0, failed = 0;
+        double dns = 0.0, connect = 0.0, tls = 0.0, first_byte = 0.0, total = 0.0, slowest = 0.0;
+        long long bytes = 0;
+        for(const auto& s: all){
+            if(s.reusedConnection) ++reused;
+            if(!s.ok) ++failed;
+            dns += s.dns;
+            connect += s.connect;
+            tls += s.tls;
+            first_byte += s.firstByte;
+            total += s.total;
+            bytes += s.bytes;
+            slowest = std::max(slowest, s.total);
+        }
+        const auto n = all.size();
+        LINFO( n << " quote downloads, " << reused << " reused connections, " << failed << " failed, " << bytes << " bytes, avg seconds: dns=" << dns / n
+            << " connect=" << connect / n << " tls=" << tls / n << " first byte=" << first_byte / n << " total=" << total / n << ", slowest=" << slowest);
+
+        LINFO( c.retries << " retries, " << c.throttled << " throttled, " << c.serverErrors << " server errors, " << c.networkErrors << " network errors, "
+            << c.failed << " given up, concurrency " << request_scheduler().concurrency() << " (+" << c.concurrencyIncreases << " -" << c.concurrencyDecreases << ")");
+    }
+
+    // null if there is no where to put the cache
+    YahooFinance::SpotCache* spot_cache()
+    {
+        static const std::string dir = YahooFinance::SpotCache::defaultDirectory();
+        static YahooFinance::SpotCache cache(dir);
+        return dir.empty() ? nullptr : &cache;
+    }
+
+    // latest spot of every symbol loaded by this process
+    YahooFinance::LastSpots& last_spots()
+    {
+        static YahooFinance::LastSpots spots;
+        return spots;
     }
 }
 void get_quotes(strings* symbols, OnProgress onProgress, void *progress_ctx, OnQuotes onQuotes, void* quotes_context)
@@ -559,31 +636,167 @@ void get_quotes(strings* symbols, OnProgress onProgress, void *progress_ctx, OnQ
             auto* const sym = static_cast<Strings* const>(symbols);
 
             auto* builder = static_cast<LatestQuotesBuilder*>(LatestQuotesBuilder::create(sym->capacity,[onQuotes, quotes_context](LatestQuotesBuilder::Alloc* alloc){
-                onQuotes(new Quotes(alloc->allocated_num(), alloc->head()), quotes_context);
+                onQuotes(alloc->arena().create_owner<Quotes>(alloc->allocated_num(), alloc->head()), quotes_context);
             }));
 
-            int i = 0;
+            const auto deadline = YahooFinance::RequestScheduler::Clock::now() + std::chrono::seconds(seconds_from_env("QUOTE_DEADLINE", DEADLINE));
+            RequestTimeouts timeouts;
+            timeouts.total = std::chrono::seconds(seconds_from_env("QUOTE_REQUEST_TIMEOUT", REQUEST_TIMEOUT));
+            timeouts.connect = std::min(timeouts.connect, timeouts.total);
+
+            auto to = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now() - std::chrono::hours(24));
+            auto from  = to - 24 * 60 * 60 * BACK_DAYS;
+            auto* cache = spot_cache();
+
+            std::vector<YahooFinance::Quote> quotes;
+            quotes.reserve(sym->size());
             for(auto name: *sym){
-                LDEBUG( "Getting quote for " << name);
+                quotes.emplace_back(name, cache);
+            }
+
+            int i = 0;
+            auto& known = last_spots();
+            auto add_known_quote = [&](const char* name){
                 onProgress(progress_ctx, ++i, sym->size());
-                YahooFinance::Quote q(name);
-                auto to = std::chrono::system_clock::now() - std::chrono::hours(24);
-                auto from  = to - std::chrono::hours(24 * BACK_DAYS);
-                q.getHistoricalSpots(
-                    std::chrono::system_clock::to_time_t(from),
-                    std::chrono::system_clock::to_time_t(to),
-                    "1d"
-                );
-                auto spots = q.nbSpots();
-                if(spots == 0){
-                    LERROR( "No quote for " << name << " since " << BACK_DAYS << " days ago");
+                YahooFinance::LastSpot last;
+                if(known.find(name, last) && last.date > 0){
+                    builder->add_quote(name, last.date, last.close);
                 }
                 else{
+                    LERROR( "No quote for " << name << " since " << BACK_DAYS << " days ago");
+                }
+            };
+            // checked_to is 0 when nothing new could be downloaded
+            auto add_latest_quote = [&](const char* name, YahooFinance::Quote& q, std::time_t checked_to){
+                auto spots = q.nbSpots();
+                if(spots > 0){
                     auto s = q.getSpot(spots - 1);
-                    builder->add_quote(name, s.getDate(), s.getClose());
+                    known.update(name, s.getDate(), s.getClose(), checked_to);
+                }
+                else if(checked_to > 0){
+                    known.update(name, 0, 0.0, checked_to);
+                }
+                add_known_quote(name);
+            };
+            // past the deadline, a stale spot is better than nothing, a NaN rate with no date tells the symbol is missing
+            auto add_late_quote = [&](const char* name, YahooFinance::Quote& q){
+                auto spots = q.nbSpots();
+                if(spots > 0){
+                    auto s = q.getSpot(spots - 1);
+                    known.update(name, s.getDate(), s.getClose(), 0);
+                }
+                onProgress(progress_ctx, ++i, sym->size());
+                YahooFinance::LastSpot last;
+                if(known.find(name, last) && last.date > 0){
+                    LERROR( "Stale quote for " << name << ", nothing newer arrived before the deadline");
+                    builder->add_quote(name, last.date, last.close);
+                }
+                else{
+                    LERROR( "No quote for " << name << " before the deadline");
+                    builder->add_quote(name, 0, std::nan(""));
+                }
+            };
+
+            // only the days after the latest known spot are downloaded, closed ones may come from the cache
+            std::vector<std::tuple<size_t, std::time_t, std::time_t>> downloads;
+            for(size_t idx = 0; idx < quotes.size(); ++idx){
+                const char* name = sym->begin()[idx];
+                YahooFinance::LastSpot last;
+                const bool is_known = known.find(name, last);
+                std::time_t fetch_from, fetch_to, after_last;
+                if(is_known && !YahooFinance::LastSpots::missingPeriod(last, from, to, after_last)){
+                    LDEBUG( "Quote for " << name << " is current");
+                    add_known_quote(name);
+                }
+                else if(!quotes[idx].loadCachedSpots(from, to, fetch_from, fetch_to)){
+                    LDEBUG( "Got quote for " << name << " from cache");
+                    add_latest_quote(name, quotes[idx], to);
+                }
+                else{
+                    if(is_known && YahooFinance::LastSpots::missingPeriod(last, fetch_from, fetch_to, after_last)){
+                        fetch_from = after_last;
+                    }
+                    downloads.emplace_back(idx, fetch_from, fetch_to);
+                }
+            }
+
+            std::vector<TransferStats> transfers;
+            YahooFinance::SchedulerCounters counters;
+            const auto batch = batch_size();
+            if(batch > 0 && !downloads.empty()){
+                // one request answers the latest price of a whole batch, but it is no closed daily spot
+                // so it goes neither to the cache nor to the latest known spots, see BATCH_SIZE
+                std::unordered_map<std::string, size_t> pending;
+                std::vector<std::string> names;
+                names.reserve(downloads.size());
+                for(size_t d = 0; d < downloads.size(); ++d){
+                    names.emplace_back(sym->begin()[std::get<0>(downloads[d])]);
+                    pending.emplace(names.back(), d);
+                }
+
+                YahooFinance::FetchEngine batch_engine(request_scheduler());
+                batch_engine.setDeadline(deadline);
+                batch_engine.setTimeouts(timeouts);
+                for(const auto& b: YahooFinance::makeBatches(names, batch)){
+                    batch_engine.add({"", 0, 0, "", yahooQuoteUrl(b)});
+                }
+                std::vector<bool> answered(downloads.size(), false);
+                batch_engine.run([&](size_t, std::string&& json){
+                    std::vector<YahooFinance::LatestPrice> prices;
+                    if(!YahooFinance::parseBatchQuote(json, prices)){
+                        LDEBUG( "Batched quote request failed, its symbols are downloaded one by one");
+                        return;
+                    }
+                    for(const auto& p: prices){
+                        auto it = pending.find(p.symbol);
+                        if(it == pending.end() || answered[it->second]) continue;
+                        answered[it->second] = true;
+                        onProgress(progress_ctx, ++i, sym->size());
+                        builder->add_quote(p.symbol, p.time, p.price);
+                    }
+                });
+                transfers = batch_engine.transferStats();
+                counters += batch_engine.counters();
+
+                size_t kept = 0;
+                for(size_t d = 0; d < downloads.size(); ++d){
+                    if(!answered[d]) downloads[kept++] = downloads[d];
                 }
+                downloads.resize(kept);
             }
 
+            // what the batches did not answer, completion order is the network order, not the symbol order
+            YahooFinance::FetchEngine engine(request_scheduler());
+            engine.setDeadline(deadline);
+            engine.setTimeouts(timeouts);
+            for(const auto& [idx, fetch_from, fetch_to]: downloads){
+                engine.add({sym->begin()[idx], fetch_from, fetch_to, "1d"});
+            }
+            // spots are parsed as their chunks arrive, no body is kept
+            engine.run([&](size_t download_idx, const char* data, size_t size){
+                quotes[std::get<0>(downloads[download_idx])].addDownloadedChunk(data, size);
+            },
+            [&](size_t download_idx, bool ok){
+                const auto& [idx, fetch_from, fetch_to] = downloads[download_idx];
+                const char* name = sym->begin()[idx];
+                LDEBUG( "Got quote for " << name);
+                const bool downloaded = quotes[idx].endDownload(ok);
+                if(!ok && engine.deadlinePassed()){
+                    add_late_quote(name, quotes[idx]);
+                    return;
+                }
+                if(!ok){
+                    LERROR( "Quote download failed for " << name);
+                }
+                if(downloaded){
+                    quotes[idx].cacheDownloadedSpots(fetch_from, fetch_to);
+                }
+                add_latest_quote(name, quotes[idx], downloaded ? fetch_to : 0);
+            });
+            transfers.insert(transfers.end(), engine.transferStats().begin(), engine.transferStats().end());
+            counters += engine.counters();
+            log_transfer_stats(transfers, counters);
+
             builder->succeed();
             delete sym;
             LDEBUG( "get quotes end");
@@ -636,7 +849,7 @@ void get_all_quotes(QuoteBySymbol& quotes_by_symbol, OnProgress OnProgress, void
         auto* q = reinterpret_cast<QuoteBySymbol*>(ctx);
         auto *all = static_cast<Quotes*>(all_quotes);
         for(auto const& quote: *all){
-            q->add(quote.symbol, &quote);
+            q->add(&quote);
         }
         q->notify(all_quotes);
     }, &quotes_by_symbol);
@@ -645,15 +858,28 @@ void get_all_quotes(QuoteBySymbol& quotes_by_symbol, OnProgress OnProgress, void
 
 void free_quotes(quotes* q)
 {
-    auto quotes = static_cast<Quotes*>(q);
-    delete quotes;
+    release_owner(static_cast<Quotes*>(q));
+}
+
+namespace{
+    // a tx add_stock_tx saves, applied to the loaded assets once it is in storage
+    struct added_stock_tx{
+        Name symbol;
+        StockTx tx;
+        OnDone onDone;
+        void* caller_provided_param;
+    };
+    void on_stock_tx_added(void* param);
 }
 
 void add_stock_tx(const char* broker, const char* symbol, double shares, double price, double fee, const char* side, timestamp date, OnDone onDone, void*caller_provided_param)
 {
     assert(storage != nullptr);
     TRY
-    storage->add_tx(broker, symbol,shares, price, fee, side, date, onDone, caller_provided_param);
+    auto added = std::make_unique<added_stock_tx>(added_stock_tx{symbol, StockTx(broker, shares, price, fee, side, date), onDone, caller_provided_param});
+    storage->add_tx(broker, symbol,shares, price, fee, side, date, on_stock_tx_added, added.get());
+    // owned by on_stock_tx_added from here
+    added.release();
     CATCH_NO_RET
 }
 
@@ -675,178 +901,286 @@ namespace{
     const char assets_tag[] = "assets";
 }
 
-AllAssets::AllAssets(const std::function<void()>& onLoaded, OnProgress onProgress, void* progress_ctx):notifyLoaded(onLoaded), quotes_by_symbol(nullptr){
-    load(onProgress, progress_ctx);
+AllAssets::AllAssets(const std::function<void()>& onLoaded):notifyLoaded(onLoaded), quotes_by_symbol(nullptr), q(nullptr), stocks(nullptr), funds(nullptr){
 }
 
+// The load is a small DAG of tasks, each one started as soon as what it needs is in:
+// brokers -> funds, stocks and quotes fetched side by side, and the stocks valued once both of them are in.
+// notify() tracks what is in and runs the tasks waiting for it.
 void AllAssets::load(OnProgress onProgress, void* progress_ctx){
     quotes_by_symbol = new QuoteBySymbol([this](quotes* all_quotes){
-        this->q = static_cast<::Quotes*>(all_quotes);
-        this->notify(AllAssets::Loaded::Quotes);
-        // stock portfolio value calculation needs quotes to be loaded first
-        get_stock_portfolio(nullptr, nullptr,[](stock_portfolio*p, void* param){
-            AllAssets *me = reinterpret_cast<AllAssets*>(param);
-            me->stocks = static_cast<StockPortfolio*>(p);
-            me->load_stocks(me->stocks);
-            me->notify(AllAssets::Loaded::Stocks);
-        },this);
+        this->quotes_in(static_cast<::Quotes*>(all_quotes));
     });
 
+    // only valuing the stocks needs the quotes, not fetching them
+    get_stock_portfolio(nullptr, nullptr,[](stock_portfolio*p, void* param){
+        reinterpret_cast<AllAssets*>(param)->stocks_in(static_cast<StockPortfolio*>(p));
+    },this);
+
     get_brokers([](all_brokers* b, void* param){
             // if this lambda captures any closures its signature won't match the raw C function pointer declaration
             auto *me = reinterpret_cast<AllAssets*>(param);
             auto *brokers = static_cast<AllBrokers*>(b);
-            me->load_cash(brokers);
-
+            // before the funds fetch, it frees the brokers once done and may be done before it returns
+            me->brokers_in(brokers);
             get_active_funds_from_all_brokers(brokers,true, [](fund_portfolio* fp, void *param){
-                AllAssets *me = reinterpret_cast<AllAssets*>(param);
-                me->funds = static_cast<FundPortfolio*>(fp);
-                me->load_funds(me->funds);
-                me->notify(AllAssets::Loaded::Funds);
+                reinterpret_cast<AllAssets*>(param)->funds_in(static_cast<FundPortfolio*>(fp));
             }, me);
-
-            me->notify(AllAssets::Loaded::Brokers);
     }, this);
 
     get_all_quotes(*quotes_by_symbol, onProgress, progress_ctx);
 }
 
+void AllAssets::quotes_in(::Quotes* all){
+    q = all;
+    fx_rates = FxMatrix(*quotes_by_symbol);
+    notify(Loaded::Quotes);
+}
+
+void AllAssets::brokers_in(AllBrokers* brokers){
+    load_cash(brokers);
+    notify(Loaded::Brokers);
+}
+
+void AllAssets::funds_in(FundPortfolio* fp){
+    funds = fp;
+    load_funds(fp);
+    notify(Loaded::Funds);
+}
+
+void AllAssets::stocks_in(StockPortfolio* sp){
+    stocks = sp;
+    notify(Loaded::Stocks);
+}
+
 void AllAssets::notify(AllAssets::Loaded loaded){
-    load_status |= loaded;
-    if (all_loaded(load_status)){
+    // release what the source filled in to the thread running the tasks it completes
+    const int before = load_status.fetch_or(loaded, std::memory_order_acq_rel);
+    const int after = before | loaded;
+    if(completes(before, after, Loaded::Stocks | Loaded::Quotes)){
+        load_stocks(stocks);
+        notify(Loaded::Valued);
+        return;
+    }
+    if(completes(before, after, Loaded::All)){
+        merge_items();
+        overviews.clear();
         notifyLoaded();
     }
 }
 
+void AllAssets::merge_items()
+{
+    std::lock_guard lock(positions_mutex);
+    std::unique_lock items_lock(items_mutex);
+    items.reserve(cash_items.size() + fund_items.size() + stock_items.size());
+    items.insert(items.end(), cash_items.begin(), cash_items.end());
+    items.insert(items.end(), fund_items.begin(), fund_items.end());
+    // the stock items go last, their sums point at them in items from now on
+    const size_t stock_base = items.size();
+    items.insert(items.end(), stock_items.begin(), stock_items.end());
+    for(auto& [broker_ccy, sum]: stock_sums){
+        if(sum.item != StockSum::no_item) sum.item += stock_base;
+    }
+    AssetItems().swap(cash_items);
+    AssetItems().swap(fund_items);
+    AssetItems().swap(stock_items);
+    merged = true;
+}
+
 // for unit tests
 AllAssets::AllAssets(QuoteBySymbol& quotes, AllBrokers *brokers, FundPortfolio* fp, StockPortfolio* sp)
 {
     q = nullptr;
     quotes_by_symbol = &quotes;
+    fx_rates = FxMatrix(quotes);
+
+    funds =  fp;
+    stocks = sp;
 
     if(brokers!=nullptr) load_cash(brokers);
     if(fp!=nullptr) load_funds(fp);
     if(sp!=nullptr) load_stocks(sp);
+    merge_items();
+    load_status = Loaded::All;
+}
 
-    funds =  fp;
-    stocks = sp;
+// for unit tests of the load
+AllAssets::AllAssets(const std::function<void()>& onLoaded, QuoteBySymbol& quotes)
+    :notifyLoaded(onLoaded), quotes_by_symbol(&quotes), q(nullptr), stocks(nullptr), funds(nullptr)
+{
 }
 
 AllAssets::~AllAssets(){
-    delete funds;
-    delete stocks;
-    delete q;
+    free_funds(funds);
+    free_stock_portfolio(stocks);
+    free_quotes(q);
 }
 
 
 std::set<std::string> AllAssets::get_all_ccy() const
 {
     std::set<std::string> all_ccy;
+    std::shared_lock lock(items_mutex);
     for(auto& i: this->items){
-        all_ccy.insert(i.currency);
+        all_ccy.insert(i.currency.c_str());
     }
     return all_ccy;
 }
 
 
-// stock and FX pairs have quotes, so if we exclude all stocks from quotes what's left is FX pairs
 std::set<std::string> AllAssets::get_all_ccy_pairs() const
 {
-    std::set<std::string> all_ccy_pairs;
-    for (auto& [symbol, _]: quotes_by_symbol->mapping) {
-        all_ccy_pairs.insert(symbol);
-    }
-    for(auto& stx: *stocks){
-        all_ccy_pairs.erase(std::string(stx.instrument->symbol));
-    }
-    return all_ccy_pairs;
+    return std::set<std::string>(fx_rates.pairs().begin(), fx_rates.pairs().end());
 }
 
 double AllAssets::to_main_ccy(double value, const char* ccy, const char* main_ccy)
 {
-    if(strcmp(ccy, main_ccy) == 0){
-        return value;
+    // looked up by their characters, a caller's strings are not interned
+    if(std::strcmp(ccy, main_ccy) == 0) return value;
+    const int from = fx_rates.find(ccy), to = fx_rates.find(main_ccy);
+    return from < 0 || to < 0 ? std::nan("") : value * fx_rates.rate(from, to);
+}
+
+double AllAssets::get_price(const char* symbol) const
+{
+    auto* q = quotes_by_symbol->index.find(symbol);
+    return q == nullptr ? std::nan("") : q->rate;
+}
+
+void AllAssets::load_funds(FundPortfolio* fp)
+{
+    const auto* cols = fp->columns();
+    std::vector<double> values(cols->broker_num), profits(cols->broker_num);
+    compensated_group_sum(cols->market_value, cols->broker_id, cols->num, values.data(), cols->broker_num);
+    compensated_group_sum(cols->profit, cols->broker_id, cols->num, profits.data(), cols->broker_num);
+    // brokers are in alphabetical order
+    for(int b = 0; b < cols->broker_num; ++b){
+        fund_items.emplace_back(ASSET_TYPE_FUNDS, Name::of_interned(cols->brokers[b]), "JPY", values[b], profits[b]);
     }
+}
 
-    auto fx = quotes_by_symbol->mapping.find(std::string(ccy) + main_ccy + "=X");
-    if(fx != quotes_by_symbol->mapping.end()){
-        return value * fx->second->rate;
+void AllAssets::load_stocks(StockPortfolio* sp)
+{
+    std::lock_guard lock(positions_mutex);
+    for(auto const& stockWithTx: *sp){
+        const Name symbol = Name::of_interned(stockWithTx.instrument->symbol);
+        LDEBUG( "stock=" << symbol);
+        // in broker order, the order their values are summed in
+        std::map<Name, StockPosition*> by_broker;
+        std::set<Name> unsorted;
+        for(auto const& tx: *static_cast<StockTxList*>(stockWithTx.tx_list)){
+            const Name broker = Name::of_interned(tx.broker);
+            auto*& p = by_broker[broker];
+            if(p == nullptr){
+                p = &positions[{symbol, broker}];
+                p->stock = &stockWithTx;
+            }
+            if(tx.date < p->position.last_date()) unsorted.insert(broker);
+            else p->position.apply(tx);
+        }
+        for(auto& [broker, p]: by_broker){
+            LDEBUG( "broker=" << broker);
+            if(unsorted.count(broker) > 0) replay(*p, broker);
+            count(*p, broker, true);
+        }
     }
-    else{
-        // try the other convention
-        auto fx2 = quotes_by_symbol->mapping.find(std::string(main_ccy) + ccy + "=X");
-        if(fx == quotes_by_symbol->mapping.end()) return std::nan("");
-        return value / fx2->second->rate;
+    // one item per broker and ccy
+    for(auto& [broker_ccy, sum]: stock_sums){
+        update_item(broker_ccy, sum, stock_items);
     }
 }
 
-double AllAssets::get_price(const char* symbol) const
-{
-    auto r = quotes_by_symbol->mapping.find(std::string(symbol));
-    return r == quotes_by_symbol->mapping.end() ? std::nan("") : r->second->rate;
+bool AllAssets::add_stock_tx(Name symbol, const stock_tx& tx)
+{
+    std::lock_guard lock(positions_mutex);
+    // not loaded yet, nothing to apply the tx to
+    if(stocks == nullptr || !merged) return false;
+    const Name broker = Name::of_interned(tx.broker);
+    auto it = positions.find({symbol, broker});
+    if(it == positions.end()){
+        // first tx of the stock at this broker
+        const stock_with_tx* stock = nullptr;
+        for(auto const& s: *stocks){
+            if(symbol == Name::of_interned(s.instrument->symbol)){
+                stock = &s;
+                break;
+            }
+        }
+        if(stock == nullptr){
+            // no currency to put it under until the portfolio is reloaded
+            LINFO( "stock " << symbol << " is not in the loaded portfolio");
+            return false;
+        }
+        it = positions.try_emplace({symbol, broker}).first;
+        it->second.stock = stock;
+    }
+    auto& p = it->second;
+    count(p, broker, false);
+    p.added.push_back(tx);
+    if(tx.date < p.position.last_date()) replay(p, broker);
+    else p.position.apply(tx);
+    count(p, broker, true);
+
+    const Name ccy = Name::of_interned(p.stock->instrument->currency);
+    auto sum = stock_sums.find({broker, ccy});
+    if(sum != stock_sums.end()){
+        // a new item may move the others
+        std::unique_lock items_lock(items_mutex);
+        update_item(sum->first, sum->second, items);
+    }
+    overviews.clear();
+    return true;
 }
 
-template<typename RandomAccessIterator,  typename FieldSelectorUnaryFn>
-auto group_by(RandomAccessIterator _first, RandomAccessIterator _last, const FieldSelectorUnaryFn& fieldChooser)
+void AllAssets::replay(StockPosition& p, Name broker)
 {
-    using FieldType = decltype(fieldChooser(*_first));
-    std::map<FieldType, std::vector<typename RandomAccessIterator::value_type>> instancesByField;
-    for(RandomAccessIterator i = _first; i != _last; ++i)
-    {
-        instancesByField[fieldChooser(*i)].push_back(*i);
+    std::vector<const stock_tx*> txs;
+    const stock_tx_list* loaded = p.stock->tx_list;
+    for(int i = 0; i < loaded->num; ++i){
+        if(broker == Name::of_interned(loaded->first_tx[i].broker)) txs.push_back(loaded->first_tx + i);
+    }
+    for(auto const& tx: p.added) txs.push_back(&tx);
+    std::stable_sort(txs.begin(), txs.end(), [](const stock_tx* tx1, const stock_tx* tx2){ return tx1->date < tx2->date; });
+    p.position.reset();
+    for(auto* tx: txs){
+        if(!p.position.apply(*tx)) break;
     }
-    return instancesByField;
 }
 
-void AllAssets::load_funds(FundPortfolio* fp)
+void AllAssets::count(StockPosition& p, Name broker, bool add)
 {
-    using ValueProfit = std::pair<double, double>;
-    // don't iterate by Fund& , as group_by would copy it to vector and it will trigger ~Fund() , causing double free when the original Fund frees string it manages
-    for(auto& by_broker: group_by(fp->ptr_begin(), fp->ptr_end(),[](Fund* f){ return std::string(f->broker); })){
-        auto const& broker = by_broker.first;
-        auto vp = std::accumulate(by_broker.second.begin(), by_broker.second.end(), std::make_pair(0.0, 0.0), [](ValueProfit& a, Fund* x){
-            a.first += x->market_value;
-            a.second += x->profit;
-            return a;
-        });
-        items.emplace_back(ASSET_TYPE_FUNDS, broker.c_str(), "JPY", vp.first, vp.second);
+    if(add){
+        const auto& balance = p.position.balance();
+        p.counted = balance.shares != 0;
+        p.value = p.profit = std::nan("");
+        double price = get_price(p.stock->instrument->symbol);
+        if(!std::isnan(price)){
+            p.value = price * balance.shares;
+            p.profit = (price - balance.vwap) * balance.shares;
+        }
     }
+    if(!p.counted) return;
+    auto& sum = stock_sums[{broker, Name::of_interned(p.stock->instrument->currency)}];
+    const int sign = add ? 1 : -1;
+    if(std::isnan(p.value)) sum.nan_values += sign;
+    else sum.value += sign * p.value;
+    if(std::isnan(p.profit)) sum.nan_profits += sign;
+    else sum.profit += sign * p.profit;
 }
 
-void AllAssets::load_stocks(StockPortfolio* sp)
+void AllAssets::update_item(const std::pair<Name, Name>& broker_ccy, StockSum& sum, AssetItems& into)
 {
     const double nan = std::nan("");
-
-    AssetItems grouped_by_sym_and_broker;
-    for(auto const& stockWithTx: *sp){
-        StockTxList *tx_list = static_cast<StockTxList*>(stockWithTx.tx_list);
-        LDEBUG( "stock=" << stockWithTx.instrument->symbol);
-        // group tx by broker
-        for(auto& by_broker: group_by(tx_list->ptr_begin(),tx_list->ptr_end(), [](const StockTx* tx){ return std::string(tx->broker); })){
-            auto& broker = by_broker.first;
-            LDEBUG( "broker=" << broker);
-            const auto& balance = StockTxList::calc(by_broker.second.begin(), by_broker.second.end());
-            if(balance.shares == 0) continue;
-            double value, profit =  nan;
-            double price = get_price(stockWithTx.instrument->symbol);
-            if(!std::isnan(price)){
-                value = price * balance.shares;
-                profit = (price - balance.vwap) * balance.shares;
-            }
-            grouped_by_sym_and_broker.emplace_back(ASSET_TYPE_STOCK, const_cast<std::string&>(broker), stockWithTx.instrument->currency, value, profit);
-        }
+    const double value = sum.nan_values > 0 ? nan : sum.value;
+    const double profit = sum.nan_profits > 0 ? nan : sum.profit;
+    if(sum.item == StockSum::no_item){
+        sum.item = into.size();
+        into.emplace_back(ASSET_TYPE_STOCK, broker_ccy.first, broker_ccy.second, value, profit);
     }
-    // merge items with same broker and ccy
-    for(auto& by_broker_ccy: group_by(grouped_by_sym_and_broker.begin(), grouped_by_sym_and_broker.end(), [](const AssetItem& i) -> std::string { return i.broker + i.currency; })){
-        auto& first = by_broker_ccy.second.front();
-        auto& list = by_broker_ccy.second;
-        items.push_back(std::accumulate(list.begin(), list.end(), AssetItem(first.asset_type, first.broker.c_str(), first.currency.c_str(),0.0,0.0),
-            [](AssetItem& a, AssetItem& x){
-                a.profit += x.profit;
-                a.value  += x.value;
-                return a;
-            }
-        ));
+    else{
+        into[sum.item].value = value;
+        into[sum.item].profit = profit;
     }
 }
 
@@ -858,37 +1192,56 @@ void AllAssets::load_cash(AllBrokers *brokers)
             continue;
         }
         for(const CashBalance& balance: broker){
-            items.push_back(AssetItem(ASSET_TYPE_CASH, broker.name, balance.ccy, balance.balance, 0));
+            cash_items.push_back(AssetItem(ASSET_TYPE_CASH, Name::of_interned(broker.name), Name::of_interned(balance.ccy), balance.balance, 0));
         }
     }
 }
 
 namespace{
-    std::map<AssetHandle, AllAssets*> all_assets_by_handle;
-    AssetHandle next_asset_handle = 0;
-    AllAssets* get_assets_by_handle(AssetHandle asset_handle)
+    // called from Dart isolates and the thread pool at the same time
+    HandleTable<AllAssets> all_assets_by_handle;
+    // keeps the assets from being freed until the end of the full expression using it
+    HandleTable<AllAssets>::Ref get_assets_by_handle(AssetHandle asset_handle)
     {
         auto assets = all_assets_by_handle.find(asset_handle);
-        if(assets != all_assets_by_handle.end()){
-            return assets->second;
-        }
-        else{
+        if(assets == nullptr){
             LERROR( "Cannot find assets by handle " << asset_handle);
-            return nullptr;
         }
+        return assets;
+    }
+}
+
+namespace{
+    void on_stock_tx_added(void* param)
+    {
+        std::unique_ptr<added_stock_tx> added(static_cast<added_stock_tx*>(param));
+        all_assets_by_handle.for_each([&added](AllAssets* assets){
+            assets->add_stock_tx(added->symbol, added->tx);
+        });
+        if(added->onDone != nullptr) added->onDone(added->caller_provided_param);
     }
 }
 
 void load_assets(OnAssetLoaded onLoaded, void* ctx,OnProgress onProgress, void* progressCtx)
 {
-    AssetHandle h = ++next_asset_handle;
-    all_assets_by_handle[h] = new AllAssets([onLoaded=std::move(onLoaded), h, ctx, onProgress=std::move(onProgress), progressCtx]{ onLoaded(ctx, h); }, onProgress, progressCtx);
+    AssetHandle h = all_assets_by_handle.reserve();
+    if(h == 0){
+        LERROR( "Too many assets loaded, free_assets the ones not used any more");
+        return;
+    }
+    auto* assets = new AllAssets([onLoaded=std::move(onLoaded), h, ctx]{ onLoaded(ctx, h); });
+    // published before the load starts, so onLoaded finds it by its handle
+    if(!all_assets_by_handle.publish(h, assets)){
+        LERROR( "Assets handle " << h << " freed before it was loaded");
+        delete assets;
+        return;
+    }
+    assets->load(onProgress, progressCtx);
 }
 
 const Quote* AllAssets::get_latest_quote(const char* symbol) const
 {
-    auto it = quotes_by_symbol->mapping.find(std::string(symbol));
-    return it == quotes_by_symbol->mapping.end() ? nullptr : it->second;
+    return quotes_by_symbol->index.find(symbol);
 }
 
 
@@ -909,7 +1262,7 @@ const quotes* get_latest_quotes(AllAssets* assets, int num, const char** symbols
 
     Quotes *quotes = nullptr;
     auto *builder = static_cast<LatestQuotesBuilder *>(LatestQuotesBuilder::create(num, [&quotes](LatestQuotesBuilder::Alloc *alloc){
-        quotes = new Quotes(alloc->allocated_num(), alloc->head());
+        quotes = alloc->arena().create_owner<Quotes>(alloc->allocated_num(), alloc->head());
     }));
 
     for(int i = 0; i < num; ++i){
@@ -962,6 +1315,7 @@ const quotes* get_latest_quotes_delimeter(AssetHandle handle, int num, const cha
 
 strings* get_all_ccy(AllAssets* assets)
 {
+    if(assets == nullptr) return nullptr;
     const auto all_ccy = assets->get_all_ccy();
     StringsBuilder sb(all_ccy.size());
     for(auto i = all_ccy.cbegin(); i != all_ccy.cend(); ++i){
@@ -972,12 +1326,13 @@ strings* get_all_ccy(AllAssets* assets)
 
 quotes* get_all_ccy_pairs_quote(AllAssets* assets)
 {
+    if(assets == nullptr) return nullptr;
     Quotes *quotes = nullptr;
 
     auto all_pairs = assets->get_all_ccy_pairs();
 
     auto *builder = static_cast<LatestQuotesBuilder *>(LatestQuotesBuilder::create(all_pairs.size(), [&quotes](LatestQuotesBuilder::Alloc *alloc){
-        quotes = new Quotes(alloc->allocated_num(), alloc->head());
+        quotes = alloc->arena().create_owner<Quotes>(alloc->allocated_num(), alloc->head());
     }));
 
     for(auto& pair: all_pairs) {
@@ -1002,92 +1357,16 @@ strings* get_all_ccy(AssetHandle handle)
 
 void free_assets(AssetHandle handle)
 {
-    auto assets = all_assets_by_handle.find(handle);
-    if(assets != all_assets_by_handle.end()){
-        delete assets->second;
-        all_assets_by_handle.erase(assets);
-    }
+    // waits for the calls still using the assets
+    delete all_assets_by_handle.remove(handle);
 }
 
-namespace{
-    char GROUP_ASSET [] = "Asset";
-    char GROUP_BROKER[] = "Broker";
-    char GROUP_CCY   [] = "Currency";
-    char *GROUPS[] = {GROUP_ASSET, GROUP_BROKER, GROUP_CCY};
-    char overview_tag[] = "overview";
-}
-
-struct LvlGroup
-{
-    LvlGroup(GROUP byGroup){
-        switch (byGroup)
-        {
-        case GROUP_BY_ASSET:
-            key = [](const AssetItem& a){ return std::string(a.asset_type);};
-            group_name = GROUP_ASSET;
-            break;
-        case GROUP_BY_BROKER:
-            key = [](const AssetItem& a){ return a.broker;};
-            group_name = GROUP_BROKER;
-            break;
-        case GROUP_BY_CCY:
-            key = [](const AssetItem& a){ return a.currency;};
-            group_name = GROUP_CCY;
-            break;
-        default:
-            group_name = nullptr;
-            key = nullptr;
-            break;
-        }
-    }
-    std::string group_name;
-    std::function<std::string(const AssetItem&)> key;
-    inline std::string operator() (const AssetItem& a) const { return key(a); }
-};
-
 overview* get_overview(AllAssets* assets, const char* main_ccy, GROUP level1_group, GROUP level2_group, GROUP level3_group)
 {
-    auto lvl1 = LvlGroup(level1_group);
-    auto lvl2 = LvlGroup(level2_group);
-    auto lvl3 = LvlGroup(level3_group);
-
-    LDEBUG( "lvl1=" << lvl1.group_name << ",lvl2="<<lvl2.group_name<<",lvl3="<<lvl3.group_name);
-
-    double lvl1_sum = 0.0, lvl1_sum_profit = 0.0;
-    const auto& lvl1_grp = group_by(assets->items.begin(),assets->items.end(), lvl1);
-    PlacementNew<overview_item_container_container> container_container_alloc(lvl1_grp.size());
-    for(auto& l1: lvl1_grp){
-        const auto& l1_name = l1.first;
-        auto& lvl2_grp = l1.second;
-
-        LDEBUG( "Level 1 " << l1_name);
-
-        PlacementNew<overview_item_container> container_alloc(lvl2_grp.size());
-
-        double lvl2_sum = 0.0, lvl2_sum_profit = 0.0;
-        for(auto& l2: group_by(lvl2_grp.begin(),lvl2_grp.end(),lvl2)){
-            const auto& l2_name = l2.first;
-            LDEBUG( "Level 2 " << l2_name);
-            PlacementNew<overview_item> item_alloc(l2.second.size());
-            double sum = 0.0, sum_profit = 0.0;
-            for(auto&& l3: l2.second){
-                double main_ccy_value  = assets->to_main_ccy(l3.value, l3.currency.c_str(), main_ccy);
-                double main_ccy_profit = assets->to_main_ccy(l3.profit,l3.currency.c_str(), main_ccy);
-                new (item_alloc.next()) OverviewItem(lvl3.key(l3),l3.currency, l3.value, main_ccy_value,l3.profit, main_ccy_profit);
-                sum += main_ccy_value;
-                sum_profit += main_ccy_profit;
-            }
-            new (container_alloc.next()) OverviewItemContainer(l2_name, lvl3.group_name, sum, sum_profit, item_alloc.allocated_num(), item_alloc.head());
-            lvl2_sum += sum;
-            lvl2_sum_profit += sum_profit;
-        }
-
-        new (container_container_alloc.next()) OverviewItemContainerContainer(l1_name, lvl2.group_name, lvl2_sum, lvl2_sum_profit, container_alloc.allocated_num(), container_alloc.head());
-        lvl1_sum += lvl2_sum;
-        lvl1_sum_profit += lvl2_sum_profit;
-    }
-
-    return new Overview(lvl1.group_name, lvl1_sum, lvl1_sum_profit, container_container_alloc.allocated_num(), container_container_alloc.head());
+    if(assets == nullptr) return nullptr;
+    return assets->overviews.get<Overview>(main_ccy, OverviewCache::overview_levels(level1_group, level2_group, level3_group), [&](){
+        return OverviewAggregator(*assets, main_ccy).overview(level1_group, level2_group, level3_group);
+    });
 }
 
 overview* get_overview(AssetHandle asset_handle, const char* main_ccy, GROUP level1_group, GROUP level2_group, GROUP level3_group)
@@ -1098,21 +1377,9 @@ overview* get_overview(AssetHandle asset_handle, const char* main_ccy, GROUP lev
 overview_item_list* get_sum_group(AllAssets* assets, const char* main_ccy, GROUP group)
 {
     if(assets == nullptr) return nullptr;
-
-    const LvlGroup lvl(group);
-    const auto& groupedData = group_by(assets->items.begin(),assets->items.end(), lvl);
-    PlacementNew<overview_item> item_alloc(groupedData.size());
-    typedef std::pair<double, double> ValueAndProfit;
-    std::string dummyCcy;
-    for(auto& data : groupedData){
-        ValueAndProfit s = {0.0, 0.0};
-        for(const auto&a : data.second){
-            s.first += assets->to_main_ccy(a.value, a.currency.c_str(), main_ccy);
-            s.second+= assets->to_main_ccy(a.profit, a.currency.c_str(), main_ccy);
-        };
-        new (item_alloc.next()) OverviewItem(data.first, dummyCcy, 0.0, s.first, 0.0, s.second);
-    }
-    return new OverviewItemList(item_alloc.allocated_num(), item_alloc.head());
+    return assets->overviews.get<OverviewItemList>(main_ccy, OverviewCache::sum_group_levels(group), [&](){
+        return OverviewAggregator(*assets, main_ccy).sum_group(group);
+    });
 }
 
 overview_item_list* get_sum_group_by_asset(AssetHandle asset_handle, const char* main_ccy)
@@ -1127,11 +1394,11 @@ overview_item_list* get_sum_group_by_broker(AssetHandle asset_handle, const char
 
 void free_overview_item_list(overview_item_list *list)
 {
-    delete static_cast<OverviewItemList*>(list);
+    release_owner(static_cast<OverviewItemList*>(list));
 }
 
 void free_overview(overview* o)
 {
-    delete static_cast<Overview*>(o);
+    release_owner(static_cast<Overview*>(o));
 }
 //// Overview calculation End
\ No newline at end of file
@@ -1,10 +1,19 @@
 #ifndef URPH_CORE_INTERNAL_HXX_
 #define URPH_CORE_INTERNAL_HXX_
 
+#include <atomic>
 #include <string>
 #include <set>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 #include <condition_variable>
 #include "urph-fin-core.hxx"
+#include "intern.hxx"
+#include "stock.hxx"
+#include "fx_matrix.hxx"
+#include "overview_cache.hxx"
 
 #include <BS_thread_pool.hpp>
 
@@ -15,14 +24,9 @@ class StockPortfolio;
 class AssetItem
 {
 public:
-    AssetItem(const char* asset_type, const char* b, const char* ccy, double v, double p)
-        :asset_type(asset_type), broker(std::string(b)),currency(std::string(ccy)),value(v), profit(p){}
-
-    AssetItem(const char* asset_type, std::string& broker, const char* ccy, double v, double p)
-        :asset_type(asset_type), currency(std::string(ccy)),value(v), profit(p)
-    {
-        this->broker = std::move(broker);
-    }
+    // names are interned, items are grouped and compared by pointer
+    AssetItem(Name asset_type, Name b, Name ccy, double v, double p)
+        :asset_type(asset_type), broker(b),currency(ccy),value(v), profit(p){}
     /*
     AssetItem(AssetItem&& other)
     {
@@ -37,15 +41,15 @@ public:
     */
 
     friend bool operator == (const AssetItem& a, const AssetItem& b) { 
-        return strcmp(a.asset_type, b.asset_type) == 0 && a.broker == b.broker && a.currency == b.currency &&
+        return a.asset_type == b.asset_type && a.broker == b.broker && a.currency == b.currency &&
             a.value == b.value && a.profit == b.profit;
     };
 
     //AssetItem& operator=(const AssetItem& t) = default;
 
-    const char* asset_type;
-    std::string broker;
-    std::string currency;
+    Name asset_type;
+    Name broker;
+    Name currency;
     double value;
     double profit;
 };
@@ -60,26 +64,94 @@ public:
         Quotes = 1,
         Brokers = 2,
         Stocks = 4,
-        Funds = 8
+        Funds = 8,
+        // the stocks valued with the quotes, once both are in
+        Valued = 16,
+        All = Quotes | Brokers | Stocks | Funds | Valued
     };
-    explicit AllAssets(const std::function<void()>& onLoaded,OnProgress onProgress, void* progressCtx);
+    // nothing is loaded until load(), onLoaded may run on another thread before it returns
+    explicit AllAssets(const std::function<void()>& onLoaded);
     // for unit tests
     AllAssets(QuoteBySymbol& quotes, AllBrokers *brokers, FundPortfolio* fp, StockPortfolio* sp);
+    // for unit tests of the load: nothing is in until the sources are passed to the *_in calls
+    AllAssets(const std::function<void()>& onLoaded, QuoteBySymbol& quotes);
     ~AllAssets();
 
     void load(OnProgress onProgress, void* progress_ctx);
     void notify(Loaded loadedData);
-
+    // a source is in, called on the thread its callback runs on; each notifies what it completes.
+    // The assets own the quotes, funds and stocks passed in
+    void quotes_in(::Quotes* all);
+    void brokers_in(AllBrokers* brokers);
+    void funds_in(FundPortfolio* fp);
+    void stocks_in(StockPortfolio* sp);
+
+    // direct, inverse and crossed rates of the FX quotes by ccy index, for the overviews to look their ccys up once
+    inline const FxMatrix& fx_matrix() const { return fx_rates; }
+    // value in the main ccy at the rate of the FX quotes, direct, inverse or crossed, NaN without one
     double to_main_ccy(double value, const char* ccy, const char* main_ccy);
 
     const Quote* get_latest_quote(const char* symbol) const;
     std::set<std::string> get_all_ccy() const;
     std::set<std::string> get_all_ccy_pairs() const;
 
+    // applies a tx just saved to storage to the loaded stock positions and their items,
+    // false if the symbol is not in the loaded portfolio
+    bool add_stock_tx(Name symbol, const stock_tx& tx);
+
     AssetItems items;
+    // add_stock_tx changes items from the storage threads while overviews read them:
+    // changed under a unique lock, read under a shared one
+    mutable std::shared_mutex items_mutex;
+    // results built from items, cleared whenever they or the quotes change
+    OverviewCache overviews;
 private:
+    // running position of a stock at a broker
+    struct StockPosition{
+        Position position;
+        const stock_with_tx* stock = nullptr;
+        // tx added since the portfolio was loaded, a backdated one replays them with the loaded ones
+        std::vector<stock_tx> added;
+        // what it adds to the item of its broker and ccy, counted only if it holds shares
+        bool counted = false;
+        double value = 0.0;
+        double profit = 0.0;
+    };
+    // stock value and profit of a broker in a ccy, NaN ones are counted instead of summed
+    // so a position can be taken out again
+    struct StockSum{
+        double value = 0.0;
+        double profit = 0.0;
+        int nan_values = 0;
+        int nan_profits = 0;
+        static constexpr size_t no_item = static_cast<size_t>(-1);
+        size_t item = no_item;
+    };
+    struct NamePairHash{
+        size_t operator()(const std::pair<Name, Name>& p) const noexcept {
+            return std::hash<Name>()(p.first) * 31 + std::hash<Name>()(p.second);
+        }
+    };
+    // by symbol and broker
+    std::unordered_map<std::pair<Name, Name>, StockPosition, NamePairHash> positions;
+    // by broker and ccy
+    std::map<std::pair<Name, Name>, StockSum> stock_sums;
+    std::mutex positions_mutex;
+
+    void replay(StockPosition& p, Name broker);
+    void count(StockPosition& p, Name broker, bool add);
+    void update_item(const std::pair<Name, Name>& broker_ccy, StockSum& sum, AssetItems& into);
+    // appends the items of every source to items, in a fixed order whichever source came in first
+    void merge_items();
+
+    // each source fills its own items while they load on different threads
+    AssetItems cash_items, fund_items, stock_items;
+    // guarded by positions_mutex, stock tx are only added to the merged items
+    bool merged = false;
+
     std::function<void()> notifyLoaded;
-    char load_status = Loaded::None;
+    // the Loaded bits of the sources in, set from the threads their callbacks run on
+    std::atomic<int> load_status = Loaded::None;
 
     double get_price(const char* symbol) const;
     void load_funds(FundPortfolio* fp);
@@ -87,13 +159,16 @@ private:
     void load_cash(AllBrokers *brokers);
     std::condition_variable cv;
     QuoteBySymbol* quotes_by_symbol;
+    // built from quotes_by_symbol once it is loaded
+    FxMatrix fx_rates;
 
     ::Quotes* q;
     StockPortfolio *stocks;
     FundPortfolio *funds;
 
-    constexpr bool all_loaded(char status) const{
-        return status == (AllAssets::Loaded::Brokers | AllAssets::Loaded::Funds | AllAssets::Loaded::Quotes | AllAssets::Loaded::Stocks);
+    // true only for the notify that completes the sources a task needs, so the task runs once
+    static constexpr bool completes(int before, int after, int needs){
+        return (before & needs) != needs && (after & needs) == needs;
     }
 
     AllAssets(const AllAssets&) = delete;
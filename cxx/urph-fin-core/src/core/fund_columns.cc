@@ -0,0 +1,97 @@
+#include "fund_columns.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "arena.hxx"
+#include "intern.hxx"
+
+namespace{
+    // Neumaier's variant of Kahan, also exact when the addend is bigger than the sum
+    struct CompensatedSum{
+        double sum = 0.0;
+        double c = 0.0;
+        inline void add(double x){
+            const double t = sum + x;
+            if(std::fabs(sum) >= std::fabs(x)) c += (sum - t) + x;
+            else c += (x - t) + sum;
+            sum = t;
+        }
+        inline double result() const { return sum + c; }
+    };
+
+    constexpr size_t LANES = 8;
+}
+
+FundColumns* FundColumns::build(Arena& arena, const fund* first, int n)
+{
+    auto* cols = arena.make<FundColumns>();
+    cols->num = n;
+    cols->capital      = arena.allocate_array<double>(n);
+    cols->market_value = arena.allocate_array<double>(n);
+    cols->profit       = arena.allocate_array<double>(n);
+    cols->price        = arena.allocate_array<double>(n);
+    cols->amount       = arena.allocate_array<int>(n);
+    cols->date         = arena.allocate_array<timestamp>(n);
+    cols->broker_id    = arena.allocate_array<int>(n);
+
+    // broker names are interned, the same broker is the same pointer
+    std::vector<const char*> brokers;
+    for(int i = 0; i < n; ++i) brokers.push_back(first[i].broker);
+    std::sort(brokers.begin(), brokers.end(), [](const char* a, const char* b){ return Name::of_interned(a) < Name::of_interned(b); });
+    brokers.erase(std::unique(brokers.begin(), brokers.end()), brokers.end());
+    cols->broker_num = brokers.size();
+    cols->brokers = arena.allocate_array<const char*>(brokers.size());
+    std::copy(brokers.begin(), brokers.end(), cols->brokers);
+
+    for(int i = 0; i < n; ++i){
+        const fund& f = first[i];
+        cols->capital[i]      = f.capital;
+        cols->market_value[i] = f.market_value;
+        cols->profit[i]       = f.profit;
+        cols->price[i]        = f.price;
+        cols->amount[i]       = f.amount;
+        cols->date[i]         = f.date;
+        cols->broker_id[i]    = std::lower_bound(brokers.begin(), brokers.end(), f.broker,
+            [](const char* a, const char* b){ return Name::of_interned(a) < Name::of_interned(b); }) - brokers.begin();
+    }
+    return cols;
+}
+
+double compensated_sum(const double* v, size_t n)
+{
+    // plain Kahan in the lanes: no branch, so they vectorize; the lanes and the tail are merged by Neumaier
+    double s[LANES] = {};
+    double c[LANES] = {};
+    size_t i = 0;
+    for(; i + LANES <= n; i += LANES){
+        for(size_t l = 0; l < LANES; ++l){
+            const double y = v[i + l] - c[l];
+            const double t = s[l] + y;
+            c[l] = (t - s[l]) - y;
+            s[l] = t;
+        }
+    }
+    CompensatedSum r;
+    for(size_t l = 0; l < LANES; ++l){
+        r.add(s[l]);
+        r.add(-c[l]);
+    }
+    for(; i < n; ++i) r.add(v[i]);
+    return r.result();
+}
+
+void compensated_group_sum(const double* v, const int* group, size_t n, double* sums, int group_num)
+{
+    std::vector<CompensatedSum> r(group_num);
+    for(size_t i = 0; i < n;){
+        const int g = group[i];
+        size_t run_end = i + 1;
+        while(run_end < n && group[run_end] == g) ++run_end;
+        r[g].add(compensated_sum(v + i, run_end - i));
+        i = run_end;
+    }
+    for(int g = 0; g < group_num; ++g) sums[g] = r[g].result();
+}
@@ -0,0 +1,36 @@
+#ifndef URPH_FIN_FUND_COLUMNS_HXX_
+#define URPH_FIN_FUND_COLUMNS_HXX_
+
+#include <cstddef>
+#include "urph-fin-core.h"
+
+class Arena;
+
+// The numbers of a fund portfolio one array per field, in the order of its funds.
+// Sums read only the arrays they need instead of striding over the whole fund records.
+// Built in the arena of the portfolio and freed with it.
+struct FundColumns{
+    int num;
+    double* capital;
+    double* market_value;
+    double* profit;
+    double* price;
+    int* amount;
+    timestamp* date;
+    // index into brokers
+    int* broker_id;
+    // interned, in alphabetical order
+    const char** brokers;
+    int broker_num;
+
+    static FundColumns* build(Arena& arena, const fund* first, int n);
+};
+
+// Sum of v[0..n) with Kahan compensation, in 8 independent lanes the compiler keeps in SIMD registers.
+double compensated_sum(const double* v, size_t n);
+
+// sums[g] = sum of v[i] for every i with group[i] == g, for g in [0, group_num).
+// Runs of the same group are summed by compensated_sum, so funds sorted by broker are summed at its speed.
+void compensated_group_sum(const double* v, const int* group, size_t n, double* sums, int group_num);
+
+#endif // URPH_FIN_FUND_COLUMNS_HXX_
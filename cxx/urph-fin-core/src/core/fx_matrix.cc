@@ -0,0 +1,77 @@
+#include "fx_matrix.hxx"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "urph-fin-core.hxx"
+
+bool FxMatrix::is_pair(const std::string& symbol)
+{
+    return symbol.size() == 8 && symbol.compare(6, 2, "=X") == 0 &&
+        std::all_of(symbol.begin(), symbol.begin() + 6, [](char c){ return std::isupper(static_cast<unsigned char>(c)); });
+}
+
+FxMatrix::FxMatrix(const QuoteBySymbol& quotes)
+{
+    for(const Quote* quote: quotes.index){
+        if(is_pair(quote->symbol) && !std::isnan(quote->rate) && quote->rate > 0.0) quoted.push_back(quote->symbol);
+    }
+    std::sort(quoted.begin(), quoted.end());
+    for(const auto& symbol: quoted){
+        id_or_add(symbol.substr(0, 3));
+        id_or_add(symbol.substr(3, 3));
+    }
+
+    const size_t n = ccys.size();
+    rates.assign(n * n, std::nan(""));
+    for(size_t i = 0; i < n; ++i) rates[i * n + i] = 1.0;
+    // inverses first so a pair quoted both ways keeps its own quote
+    for(const auto& symbol: quoted){
+        const int from = id(symbol.substr(0, 3)), to = id(symbol.substr(3, 3));
+        rates[to * n + from] = 1.0 / quotes.index.find(symbol)->rate;
+    }
+    for(const auto& symbol: quoted){
+        const int from = id(symbol.substr(0, 3)), to = id(symbol.substr(3, 3));
+        rates[from * n + to] = quotes.index.find(symbol)->rate;
+    }
+    // Floyd-Warshall, only filling the pairs still missing: a quoted rate is never replaced by a cross
+    for(size_t k = 0; k < n; ++k){
+        for(size_t i = 0; i < n; ++i){
+            const double ik = rates[i * n + k];
+            if(std::isnan(ik)) continue;
+            for(size_t j = 0; j < n; ++j){
+                if(std::isnan(rates[i * n + j])) rates[i * n + j] = ik * rates[k * n + j];
+            }
+        }
+    }
+}
+
+int FxMatrix::id_or_add(Name ccy)
+{
+    int i = id(ccy);
+    if(i >= 0) return i;
+    ccys.push_back(ccy);
+    return ccys.size() - 1;
+}
+
+int FxMatrix::id(Name ccy) const
+{
+    // a handful of currencies, compared by pointer
+    auto it = std::find(ccys.begin(), ccys.end(), ccy);
+    return it == ccys.end() ? -1 : it - ccys.begin();
+}
+
+int FxMatrix::find(std::string_view ccy) const
+{
+    auto it = std::find_if(ccys.begin(), ccys.end(), [ccy](Name c){ return c.view() == ccy; });
+    return it == ccys.end() ? -1 : it - ccys.begin();
+}
+
+double FxMatrix::rate(Name from, Name to) const
+{
+    if(from == to) return 1.0;
+    const int f = id(from), t = id(to);
+    if(f < 0 || t < 0) return std::nan("");
+    return rate(f, t);
+}
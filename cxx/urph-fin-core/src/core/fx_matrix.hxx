@@ -0,0 +1,43 @@
+#ifndef URPH_FIN_FX_MATRIX_HXX_
+#define URPH_FIN_FX_MATRIX_HXX_
+
+#include <string>
+#include <vector>
+
+#include "intern.hxx"
+
+class QuoteBySymbol;
+
+// Rates between every two currencies of a quote snapshot, indexed by small currency ids.
+// Filled from the FX quotes (XXXYYY=X) and their inverses once, the pairs no quote links
+// directly are triangulated through the other currencies.
+class FxMatrix
+{
+public:
+    FxMatrix() = default;
+    explicit FxMatrix(const QuoteBySymbol& quotes);
+
+    // -1 if no FX quote has the ccy
+    int id(Name ccy) const;
+    // the same by the characters of the ccy, for the ones callers pass which are not interned
+    int find(std::string_view ccy) const;
+    // a value in from times the rate is the value in to, NaN if no quotes link them
+    inline double rate(int from, int to) const { return rates[from * ccys.size() + to]; }
+    // 1 for the same ccy even without a quote
+    double rate(Name from, Name to) const;
+
+    inline int ccy_num() const { return ccys.size(); }
+    // symbols of the FX quotes the rates come from, alphabetical
+    inline const std::vector<std::string>& pairs() const { return quoted; }
+
+    // XXXYYY=X, the way the quote provider names the rate of XXX in YYY
+    static bool is_pair(const std::string& symbol);
+private:
+    int id_or_add(Name ccy);
+
+    std::vector<Name> ccys;
+    std::vector<double> rates;
+    std::vector<std::string> quoted;
+};
+
+#endif // URPH_FIN_FX_MATRIX_HXX_
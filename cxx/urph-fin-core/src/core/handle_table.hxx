@@ -0,0 +1,141 @@
+#ifndef URPH_FIN_HANDLE_TABLE_HXX_
+#define URPH_FIN_HANDLE_TABLE_HXX_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Objects handed to the C side by int handles, looked up from any thread without a lock.
+//
+// A handle is the generation of its slot and the slot index, generation << 8 | index: removing an
+// object bumps the generation of its slot, so an old handle never finds the next object of the slot.
+// A lookup pins the slot, a reader count kept in the same atomic word as the generation, and
+// remove() waits for the pins to go before it hands the object back to be deleted.
+// Adding and removing take a mutex, they are rare.
+template<typename T, size_t N = 256>
+class HandleTable
+{
+    static_assert(N <= 256, "the slot index is the low byte of a handle");
+    // generations stay below 2^23 so handles are positive ints, 0 is never one
+    static constexpr uint32_t MAX_GENERATION = (1u << 23) - 1;
+    struct Slot;
+public:
+    typedef int Handle;
+
+    // the object of a handle, kept from being removed while the Ref lives
+    class Ref{
+    public:
+        Ref() = default;
+        Ref(Ref&& o) noexcept: slot(o.slot), p(o.p) { o.slot = nullptr; o.p = nullptr; }
+        Ref& operator=(Ref&&) = delete;
+        Ref(const Ref&) = delete;
+        ~Ref() { if(slot != nullptr) slot->state.fetch_sub(1, std::memory_order_release); }
+
+        inline T* get() const { return p; }
+        inline T* operator->() const { return p; }
+        inline operator T*() const { return p; }
+    private:
+        friend class HandleTable;
+        Slot* slot = nullptr;
+        T* p = nullptr;
+    };
+
+    HandleTable(){
+        for(auto& s: slots) s.state.store(uint64_t(1) << 32, std::memory_order_relaxed);
+    }
+    HandleTable(const HandleTable&) = delete;
+    HandleTable& operator=(const HandleTable&) = delete;
+
+    // a handle to publish() the object to, the object may need it to be built; 0 if the table is full
+    Handle reserve(){
+        std::lock_guard lock(m);
+        for(size_t i = 0; i < N; ++i){
+            if(slots[i].used) continue;
+            slots[i].used = true;
+            return static_cast<Handle>(generation(slots[i].state.load(std::memory_order_relaxed)) << 8 | i);
+        }
+        return 0;
+    }
+
+    // false if the handle was removed before, the object is then still the caller's
+    bool publish(Handle h, T* p){
+        if(h <= 0 || index(h) >= N) return false;
+        std::lock_guard lock(m);
+        Slot& slot = slots[index(h)];
+        if(!slot.used || generation(slot.state.load(std::memory_order_acquire)) != static_cast<uint32_t>(h) >> 8) return false;
+        slot.ptr.store(p, std::memory_order_release);
+        return true;
+    }
+
+    // empty if the handle was removed or never published
+    Ref find(Handle h){
+        Ref r;
+        if(h <= 0 || index(h) >= N) return r;
+        Slot& slot = slots[index(h)];
+        if(!pin(slot, static_cast<uint32_t>(h) >> 8)) return r;
+        r.slot = &slot;
+        r.p = slot.ptr.load(std::memory_order_acquire);
+        return r;
+    }
+
+    // the object to delete, null if the handle is unknown; waits for the Refs to it to go first,
+    // so a thread holding one must not remove it
+    T* remove(Handle h){
+        if(h <= 0 || index(h) >= N) return nullptr;
+        std::lock_guard lock(m);
+        Slot& slot = slots[index(h)];
+        uint64_t s = slot.state.load(std::memory_order_acquire);
+        do{
+            if(!slot.used || generation(s) != static_cast<uint32_t>(h) >> 8) return nullptr;
+        } while(!slot.state.compare_exchange_weak(s, next_generation(s), std::memory_order_acq_rel, std::memory_order_acquire));
+
+        // no new pin can succeed, wait for the ones taken before
+        while(readers(slot.state.load(std::memory_order_acquire)) != 0) std::this_thread::yield();
+        slot.used = false;
+        return slot.ptr.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    // calls f with every published object, each one pinned during its call
+    template<typename F>
+    void for_each(F&& f){
+        for(auto& slot: slots){
+            if(!pin(slot, generation(slot.state.load(std::memory_order_acquire)))) continue;
+            T* p = slot.ptr.load(std::memory_order_acquire);
+            if(p != nullptr) f(p);
+            slot.state.fetch_sub(1, std::memory_order_release);
+        }
+    }
+private:
+    // a cache line each, lookups of different handles do not share their counters
+    struct alignas(64) Slot{
+        // generation << 32 | readers
+        std::atomic<uint64_t> state;
+        std::atomic<T*> ptr{nullptr};
+        // reserved, guarded by m
+        bool used = false;
+    };
+
+    static inline size_t index(Handle h) { return static_cast<uint32_t>(h) & 0xff; }
+    static inline uint32_t generation(uint64_t state) { return static_cast<uint32_t>(state >> 32); }
+    static inline uint32_t readers(uint64_t state) { return static_cast<uint32_t>(state); }
+    static inline uint64_t next_generation(uint64_t state){
+        const uint32_t g = generation(state) == MAX_GENERATION ? 1 : generation(state) + 1;
+        return uint64_t(g) << 32 | readers(state);
+    }
+
+    // one more reader of the slot if it still has the generation
+    static bool pin(Slot& slot, uint32_t gen){
+        uint64_t s = slot.state.load(std::memory_order_acquire);
+        do{
+            if(generation(s) != gen) return false;
+        } while(!slot.state.compare_exchange_weak(s, s + 1, std::memory_order_acq_rel, std::memory_order_acquire));
+        return true;
+    }
+
+    std::array<Slot, N> slots;
+    std::mutex m;
+};
+
+#endif // URPH_FIN_HANDLE_TABLE_HXX_
@@ -0,0 +1,58 @@
+#include "intern.hxx"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+#include "arena.hxx"
+
+namespace{
+    class InternTable{
+    public:
+        const char* find(const std::string_view& s){
+            std::shared_lock lock(mutex);
+            auto it = names.find(s);
+            return it == names.end() ? nullptr : it->data();
+        }
+        const char* intern(const std::string_view& s){
+            if(const char* p = find(s)) return p;
+            std::unique_lock lock(mutex);
+            // another thread may have added it between the two locks
+            auto it = names.find(s);
+            if(it != names.end()) return it->data();
+            const char* p = arena->copy_str(s);
+            names.emplace(p, s.size());
+            return p;
+        }
+        size_t size(){
+            std::shared_lock lock(mutex);
+            return names.size();
+        }
+    private:
+        std::shared_mutex mutex;
+        // the views point into the arena, which is never released
+        std::unordered_set<std::string_view> names;
+        Arena* arena = Arena::create();
+    };
+
+    // leaked on purpose: interned names are handed out to results that may be freed after static destruction
+    InternTable& table(){
+        static auto* t = new InternTable();
+        return *t;
+    }
+}
+
+const char* intern(const std::string_view& s)
+{
+    return table().intern(s);
+}
+
+const char* interned(const std::string_view& s)
+{
+    return table().find(s);
+}
+
+size_t interned_num()
+{
+    return table().size();
+}
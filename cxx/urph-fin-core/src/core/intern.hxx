@@ -0,0 +1,55 @@
+#ifndef URPH_FIN_INTERN_HXX_
+#define URPH_FIN_INTERN_HXX_
+
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Process wide table of the names every result repeats: brokers, currencies and symbols.
+// Each distinct name is stored once and lives until the process exits, the same characters
+// always get the same pointer. Safe to call from any thread.
+const char* intern(const std::string_view& s);
+// the interned copy of s, nullptr if it was never interned: looks up the names a caller passes without keeping them
+const char* interned(const std::string_view& s);
+// distinct names in the table
+size_t interned_num();
+
+// A name from the intern table: compared and hashed by pointer, ordered by its characters
+// so grouped results keep their alphabetical order.
+class Name{
+public:
+    Name(): p(intern("")) {}
+    Name(const char* s): p(intern(s == nullptr ? "" : s)) {}
+    Name(const std::string_view& s): p(intern(s)) {}
+    Name(const std::string& s): p(intern(s)) {}
+
+    // s must come from intern(), skips the lookup
+    static Name of_interned(const char* s) { return Name(s, 0); }
+
+    inline const char* c_str() const { return p; }
+    inline std::string_view view() const { return p; }
+    inline bool empty() const { return *p == 0; }
+
+    friend inline bool operator==(const Name& a, const Name& b) { return a.p == b.p; }
+    friend inline bool operator!=(const Name& a, const Name& b) { return a.p != b.p; }
+    friend inline bool operator<(const Name& a, const Name& b) { return a.p != b.p && std::strcmp(a.p, b.p) < 0; }
+private:
+    Name(const char* s, int): p(s) {}
+    const char* p;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const Name& n)
+{
+    return out << n.c_str();
+}
+
+namespace std{
+    template<>
+    struct hash<Name>{
+        size_t operator()(const Name& n) const noexcept { return hash<const char*>()(n.c_str()); }
+    };
+}
+
+#endif // URPH_FIN_INTERN_HXX_
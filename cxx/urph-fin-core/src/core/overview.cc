@@ -0,0 +1,232 @@
+#include "overview.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <shared_mutex>
+
+#include "../utils.hxx"
+#include "arena.hxx"
+
+namespace{
+    // appends node i to the children of parent, Leaf and Group are both chained by next
+    template<typename Node, typename Parent>
+    void link(std::vector<Node>& nodes, Parent& parent, int i)
+    {
+        if(parent.last < 0) parent.first = i;
+        else nodes[parent.last].next = i;
+        parent.last = i;
+        ++parent.num;
+    }
+
+    inline bool valid(GROUP g) { return g < GROUP_NUM; }
+}
+
+FlatIndex::FlatIndex(size_t expected)
+{
+    size_t n = 16;
+    while(n < expected * 2) n *= 2;
+    slots.assign(n, Slot{0, -1});
+    mask = n - 1;
+}
+
+void FlatIndex::add(size_t hash, int index)
+{
+    // at most half full so probes stay short
+    if((num + 1) * 2 > slots.size()){
+        std::vector<Slot> old(slots.size() * 2, Slot{0, -1});
+        old.swap(slots);
+        mask = slots.size() - 1;
+        num = 0;
+        for(const Slot& s: old){
+            if(s.index >= 0) add(s.hash, s.index);
+        }
+    }
+    size_t i = hash & mask;
+    while(slots[i].index >= 0) i = (i + 1) & mask;
+    slots[i] = Slot{hash, index};
+    ++num;
+}
+
+void FlatIndex::clear()
+{
+    std::fill(slots.begin(), slots.end(), Slot{0, -1});
+    num = 0;
+}
+
+OverviewAggregator::OverviewAggregator(AllAssets& a, const char* ccy)
+    : assets(a), main_ccy(interned(ccy)), main_id(a.fx_matrix().find(ccy)), leaves(reusable_leaves())
+{
+}
+
+std::vector<OverviewAggregator::Leaf>& OverviewAggregator::reusable_leaves()
+{
+    thread_local std::vector<Leaf> leaves;
+    return leaves;
+}
+
+int OverviewAggregator::group_of(std::vector<Group>& groups, FlatIndex& index, Name name, int parent)
+{
+    const size_t hash = FlatIndex::hash_of(name) + parent;
+    int i = index.find(hash, [&](int g){ return groups[g].name == name && groups[g].parent == parent; });
+    if(i < 0){
+        i = groups.size();
+        groups.push_back(Group{name, parent});
+        index.add(hash, i);
+    }
+    return i;
+}
+
+double OverviewAggregator::fx(Name ccy)
+{
+    const size_t hash = FlatIndex::hash_of(ccy);
+    int i = fx_index.find(hash, [&](int c){ return fx_by_ccy[c].first == ccy; });
+    if(i < 0){
+        i = fx_by_ccy.size();
+        const FxMatrix& rates = assets.fx_matrix();
+        const int from = rates.id(ccy);
+        const double rate = ccy.c_str() == main_ccy ? 1.0
+            : from < 0 || main_id < 0 ? std::nan("") : rates.rate(from, main_id);
+        fx_by_ccy.emplace_back(ccy, rate);
+        fx_index.add(hash, i);
+    }
+    return fx_by_ccy[i].second;
+}
+
+char* OverviewAggregator::name_in(Arena& arena, Name name)
+{
+    const size_t hash = FlatIndex::hash_of(name);
+    int i = copied_index.find(hash, [&](int c){ return copied[c].first == name; });
+    if(i < 0){
+        i = copied.size();
+        copied.emplace_back(name, arena.copy_str(name.view()));
+        copied_index.add(hash, i);
+    }
+    return copied[i].second;
+}
+
+const OverviewAggregator::Leaf& OverviewAggregator::add_leaf(const AssetItem& item, Group& group)
+{
+    const double rate = fx(item.currency);
+    leaves.push_back({&item, item.value * rate, item.profit * rate, -1});
+    link(leaves, group, leaves.size() - 1);
+    return leaves.back();
+}
+
+std::vector<int> OverviewAggregator::sorted(const std::vector<Group>& groups, const Group* parent)
+{
+    std::vector<int> r;
+    if(parent == nullptr){
+        r.resize(groups.size());
+        std::iota(r.begin(), r.end(), 0);
+    }
+    else{
+        r.reserve(parent->num);
+        for(int i = parent->first; i >= 0; i = groups[i].next) r.push_back(i);
+    }
+    std::sort(r.begin(), r.end(), [&groups](int a, int b){ return groups[a].name < groups[b].name; });
+    return r;
+}
+
+Overview* OverviewAggregator::overview(GROUP lvl1, GROUP lvl2, GROUP lvl3)
+{
+    static constexpr auto table = overview_table(std::make_index_sequence<GROUP_NUM * GROUP_NUM * GROUP_NUM>());
+    if(!valid(lvl1) || !valid(lvl2) || !valid(lvl3)){
+        LERROR("Unknown overview group " << (int)lvl1 << "," << (int)lvl2 << "," << (int)lvl3);
+        return nullptr;
+    }
+    // the leaves point into the items until the result is built
+    std::shared_lock lock(assets.items_mutex);
+    return (this->*table[lvl1 * GROUP_NUM * GROUP_NUM + lvl2 * GROUP_NUM + lvl3])();
+}
+
+OverviewItemList* OverviewAggregator::sum_group(GROUP lvl)
+{
+    static constexpr auto table = sum_group_table(std::make_index_sequence<GROUP_NUM>());
+    if(!valid(lvl)){
+        LERROR("Unknown overview group " << (int)lvl);
+        return nullptr;
+    }
+    std::shared_lock lock(assets.items_mutex);
+    return (this->*table[lvl])();
+}
+
+template<typename L1, typename L2, typename L3>
+Overview* OverviewAggregator::overview()
+{
+    LDEBUG( "lvl1=" << L1::name << ",lvl2="<<L2::name<<",lvl3="<<L3::name);
+
+    // level 2 groups are keyed by their name and the index of their level 1 group
+    std::vector<Group> l1, l2;
+    FlatIndex l1_index, l2_index;
+    leaves.clear();
+    leaves.reserve(assets.items.size());
+    for(const auto& item: assets.items){
+        const int g1 = group_of(l1, l1_index, L1::of(item), -1);
+        const int g2 = group_of(l2, l2_index, L2::of(item), g1);
+        if(l2[g2].num == 0) link(l2, l1[g1], g2);
+        add_leaf(item, l2[g2]);
+    }
+
+    Arena* arena = Arena::create(leaves.size() * sizeof(overview_item) + l2.size() * sizeof(overview_item_container) + 1024);
+    copied.clear();
+    copied_index.clear();
+    char* lvl2_name = arena->copy_str(L2::name);
+    char* lvl3_name = arena->copy_str(L3::name);
+    double lvl1_sum = 0.0, lvl1_sum_profit = 0.0;
+    auto* containers_of_l1 = arena->allocate_array<overview_item_container_container>(l1.size());
+    int n1 = 0;
+    for(int g1: sorted(l1, nullptr)){
+        LDEBUG( "Level 1 " << l1[g1].name);
+        const auto& l2_of_g1 = sorted(l2, &l1[g1]);
+        auto* containers = arena->allocate_array<overview_item_container>(l2_of_g1.size());
+        int n2 = 0;
+        double lvl2_sum = 0.0, lvl2_sum_profit = 0.0;
+        for(int g2: l2_of_g1){
+            const Group& group = l2[g2];
+            LDEBUG( "Level 2 " << group.name);
+            auto* items = arena->allocate_array<overview_item>(group.num);
+            int n3 = 0;
+            double sum = 0.0, sum_profit = 0.0;
+            for(int i = group.first; i >= 0; i = leaves[i].next){
+                const Leaf& leaf = leaves[i];
+                const AssetItem& l3 = *leaf.item;
+                new (items + n3++) OverviewItem(name_in(*arena, L3::of(l3)), name_in(*arena, l3.currency), l3.value, leaf.value, l3.profit, leaf.profit);
+                sum += leaf.value;
+                sum_profit += leaf.profit;
+            }
+            new (containers + n2++) OverviewItemContainer(name_in(*arena, group.name), lvl3_name, sum, sum_profit, n3, items);
+            lvl2_sum += sum;
+            lvl2_sum_profit += sum_profit;
+        }
+        new (containers_of_l1 + n1++) OverviewItemContainerContainer(name_in(*arena, l1[g1].name), lvl2_name, lvl2_sum, lvl2_sum_profit, n2, containers);
+        lvl1_sum += lvl2_sum;
+        lvl1_sum_profit += lvl2_sum_profit;
+    }
+
+    return arena->create_owner<Overview>(arena->copy_str(L1::name), lvl1_sum, lvl1_sum_profit, n1, containers_of_l1);
+}
+
+template<typename L>
+OverviewItemList* OverviewAggregator::sum_group()
+{
+    std::vector<Group> groups;
+    FlatIndex index;
+    leaves.clear();
+    leaves.reserve(assets.items.size());
+    for(const auto& item: assets.items){
+        Group& group = groups[group_of(groups, index, L::of(item), -1)];
+        const Leaf& leaf = add_leaf(item, group);
+        group.value += leaf.value;
+        group.profit += leaf.profit;
+    }
+
+    Arena* arena = Arena::create();
+    char* no_ccy = arena->copy_str("");
+    auto* items = arena->allocate_array<overview_item>(groups.size());
+    int n = 0;
+    for(int g: sorted(groups, nullptr)){
+        new (items + n++) OverviewItem(arena->copy_str(groups[g].name.view()), no_ccy, 0.0, groups[g].value, 0.0, groups[g].profit);
+    }
+    return arena->create_owner<OverviewItemList>(n, items);
+}
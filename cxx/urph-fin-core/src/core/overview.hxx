@@ -0,0 +1,138 @@
+#ifndef URPH_FIN_OVERVIEW_HXX_
+#define URPH_FIN_OVERVIEW_HXX_
+
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "core_internal.hxx"
+
+// The key of the items at one level of an overview, one specialization per GROUP_BY_*:
+// the aggregation is compiled for each combination of levels and reads the field inline.
+template<GROUP G> struct GroupKey;
+
+template<> struct GroupKey<GROUP_BY_ASSET>{
+    static constexpr const char* name = "Asset";
+    static inline Name of(const AssetItem& a) { return a.asset_type; }
+};
+
+template<> struct GroupKey<GROUP_BY_BROKER>{
+    static constexpr const char* name = "Broker";
+    static inline Name of(const AssetItem& a) { return a.broker; }
+};
+
+template<> struct GroupKey<GROUP_BY_CCY>{
+    static constexpr const char* name = "Currency";
+    static inline Name of(const AssetItem& a) { return a.currency; }
+};
+
+constexpr int GROUP_NUM = 3;
+
+// Open addressing table of the indexes of items that keep their own keys, for the few dozen
+// groups of an overview: one probe of a flat array instead of a node per key.
+class FlatIndex
+{
+public:
+    explicit FlatIndex(size_t expected = 8);
+    // index of the item same(i) holds for, or -1
+    template<typename Same>
+    int find(size_t hash, Same&& same) const {
+        for(size_t i = hash & mask;; i = (i + 1) & mask){
+            const Slot& s = slots[i];
+            if(s.index < 0) return -1;
+            if(s.hash == hash && same(s.index)) return s.index;
+        }
+    }
+    // the key of item i must not be in the table yet
+    void add(size_t hash, int i);
+    void clear();
+
+    static inline size_t hash_of(Name n) {
+        return (reinterpret_cast<size_t>(n.c_str()) >> 3) * 0x9E3779B97F4A7C15ull >> 16;
+    }
+private:
+    struct Slot{
+        size_t hash;
+        int index;
+    };
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t num = 0;
+};
+
+// Groups the asset items by up to three levels and sums them in the main ccy.
+// The items are read once: each one is converted to the main ccy and hashed into its groups
+// by its interned names, the groups only keep indexes, nothing is copied.
+// Groups come out in alphabetical order and are summed in item order, as std::map groups were.
+// A result lives in an arena of its own, each distinct name is copied to it once.
+class OverviewAggregator
+{
+public:
+    OverviewAggregator(AllAssets& assets, const char* main_ccy);
+
+    // nullptr if a level is not one of GROUP_BY_*
+    Overview* overview(GROUP lvl1, GROUP lvl2, GROUP lvl3);
+    OverviewItemList* sum_group(GROUP lvl);
+private:
+    template<typename L1, typename L2, typename L3>
+    Overview* overview();
+    template<typename L>
+    OverviewItemList* sum_group();
+
+    // one instance per combination of levels, indexed by lvl1 * 9 + lvl2 * 3 + lvl3
+    typedef Overview* (OverviewAggregator::*OverviewFn)();
+    template<size_t... I>
+    static constexpr std::array<OverviewFn, sizeof...(I)> overview_table(std::index_sequence<I...>) {
+        return {&OverviewAggregator::overview<GroupKey<I / 9>, GroupKey<I / 3 % 3>, GroupKey<I % 3>>...};
+    }
+    typedef OverviewItemList* (OverviewAggregator::*SumGroupFn)();
+    template<size_t... I>
+    static constexpr std::array<SumGroupFn, sizeof...(I)> sum_group_table(std::index_sequence<I...>) {
+        return {&OverviewAggregator::sum_group<GroupKey<I>>...};
+    }
+
+    struct Leaf{
+        const AssetItem* item;
+        double value;
+        double profit;
+        // next leaf of the same group
+        int next;
+    };
+    // children kept as a list so a group needs no allocation of its own
+    struct Group{
+        Name name;
+        int parent = -1;
+        int first = -1;
+        int last = -1;
+        int num = 0;
+        // next sibling
+        int next = -1;
+        double value = 0.0;
+        double profit = 0.0;
+    };
+
+    // index of the group, added if it is new
+    static int group_of(std::vector<Group>& groups, FlatIndex& index, Name name, int parent);
+    double fx(Name ccy);
+    // adds the item as the last leaf of the group
+    const Leaf& add_leaf(const AssetItem& item, Group& group);
+    // children of the parent, all groups without one, by name
+    static std::vector<int> sorted(const std::vector<Group>& groups, const Group* parent);
+    // the copy of name in the arena of the result
+    char* name_in(Arena& arena, Name name);
+    // kept by the thread between calls, its pages are already mapped the next time
+    static std::vector<Leaf>& reusable_leaves();
+
+    AllAssets& assets;
+    // interned, null if no name has its characters: no item is in it then
+    const char* main_ccy;
+    // in the fx matrix of the assets, -1 without a quote
+    int main_id;
+    std::vector<std::pair<Name, double>> fx_by_ccy;
+    FlatIndex fx_index;
+    std::vector<std::pair<Name, char*>> copied;
+    FlatIndex copied_index;
+    std::vector<Leaf>& leaves;
+};
+
+#endif // URPH_FIN_OVERVIEW_HXX_
@@ -0,0 +1,65 @@
+#ifndef URPH_FIN_OVERVIEW_CACHE_HXX_
+#define URPH_FIN_OVERVIEW_CACHE_HXX_
+
+#include <mutex>
+#include <unordered_map>
+
+#include "arena.hxx"
+#include "intern.hxx"
+#include "urph-fin-core.h"
+
+// The overviews and group sums of one AllAssets, by main ccy and levels, until its items or quotes change.
+// A result in the cache is shared: every caller gets the same one and frees it as before,
+// its arena is freed once the callers and the cache have all released it. Nobody may change a result.
+class OverviewCache
+{
+public:
+    OverviewCache() = default;
+    ~OverviewCache() { clear(); }
+    OverviewCache(const OverviewCache&) = delete;
+    OverviewCache& operator=(const OverviewCache&) = delete;
+
+    // the cached result of these levels, computed by compute() the first time; a null one is not cached.
+    // A main ccy never interned has no item in it, its result is computed each time rather than keep its name
+    template<typename R, typename Compute>
+    R* get(const char* ccy, int levels, Compute&& compute){
+        const char* p = interned(ccy);
+        if(p == nullptr) return compute();
+        const Name main_ccy = Name::of_interned(p);
+        std::lock_guard lock(m);
+        auto it = results.find({main_ccy, levels});
+        R* r = it == results.end() ? nullptr : static_cast<R*>(it->second);
+        if(r == nullptr){
+            r = compute();
+            if(r == nullptr) return nullptr;
+            results[{main_ccy, levels}] = r;
+        }
+        // one for the caller, the cache keeps its own
+        Arena::of(r)->share();
+        return r;
+    }
+
+    static constexpr int overview_levels(GROUP lvl1, GROUP lvl2, GROUP lvl3) { return lvl1 << 16 | lvl2 << 8 | lvl3; }
+    static constexpr int sum_group_levels(GROUP lvl) { return 1 << 24 | lvl; }
+
+    // drops every result, the ones still used by callers stay alive until they free them
+    void clear(){
+        std::lock_guard lock(m);
+        for(auto& [_, r]: results) Arena::release(Arena::of(r));
+        results.clear();
+    }
+private:
+    struct Key{
+        Name main_ccy;
+        int levels;
+        friend bool operator==(const Key& a, const Key& b) { return a.main_ccy == b.main_ccy && a.levels == b.levels; }
+    };
+    struct KeyHash{
+        size_t operator()(const Key& k) const noexcept { return std::hash<Name>()(k.main_ccy) * 31 + k.levels; }
+    };
+    // top level results, Overview or OverviewItemList by their levels
+    std::unordered_map<Key, void*, KeyHash> results;
+    std::mutex m;
+};
+
+#endif // URPH_FIN_OVERVIEW_CACHE_HXX_
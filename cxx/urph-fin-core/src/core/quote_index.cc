@@ -0,0 +1,62 @@
+#include "quote_index.hxx"
+
+#include <cstring>
+#include <functional>
+
+namespace{
+    inline size_t hash_of(const std::string_view& s) { return std::hash<std::string_view>()(s); }
+
+    // symbol is null terminated, s is not
+    inline bool same(const char* symbol, const std::string_view& s)
+    {
+        return std::strncmp(symbol, s.data(), s.size()) == 0 && symbol[s.size()] == 0;
+    }
+}
+
+QuoteIndex::QuoteIndex(size_t expected)
+{
+    size_t n = 16;
+    while(n < expected * 2) n *= 2;
+    slots.assign(n, Slot{0, nullptr, -1});
+    mask = n - 1;
+}
+
+size_t QuoteIndex::probe(const std::string_view& symbol, size_t hash) const
+{
+    size_t i = hash & mask;
+    while(slots[i].index >= 0 && !(slots[i].hash == hash && same(slots[i].symbol, symbol))) i = (i + 1) & mask;
+    return i;
+}
+
+const Quote* QuoteIndex::find(const std::string_view& symbol) const
+{
+    const Slot& s = slots[probe(symbol, hash_of(symbol))];
+    return s.index < 0 ? nullptr : quotes[s.index];
+}
+
+void QuoteIndex::add(const char* symbol, const Quote* q)
+{
+    const size_t hash = hash_of(symbol);
+    Slot& s = slots[probe(symbol, hash)];
+    if(s.index >= 0){
+        quotes[s.index] = q;
+        return;
+    }
+    s = Slot{hash, symbol, static_cast<int>(quotes.size())};
+    quotes.push_back(q);
+    // at most half full so probes stay short
+    if(quotes.size() * 2 > slots.size()) grow();
+}
+
+void QuoteIndex::grow()
+{
+    std::vector<Slot> old(slots.size() * 2, Slot{0, nullptr, -1});
+    old.swap(slots);
+    mask = slots.size() - 1;
+    for(const Slot& s: old){
+        if(s.index < 0) continue;
+        size_t i = s.hash & mask;
+        while(slots[i].index >= 0) i = (i + 1) & mask;
+        slots[i] = s;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef URPH_FIN_QUOTE_INDEX_HXX_
+#define URPH_FIN_QUOTE_INDEX_HXX_
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+class Quote;
+
+// Quotes by symbol in one flat open addressing table, looked up by any string without copying it:
+// a lookup is one hash and, the table being at most half full, mostly one probe.
+// Symbols are not copied either, the table points to the interned ones of the quotes.
+class QuoteIndex
+{
+public:
+    explicit QuoteIndex(size_t expected = 64);
+
+    // null if there is no quote of the symbol
+    const Quote* find(const std::string_view& symbol) const;
+    // symbol must outlive the index, a quote of the same symbol is replaced
+    void add(const char* symbol, const Quote* q);
+
+    inline size_t size() const { return quotes.size(); }
+    // in the order the symbols were first added
+    inline std::vector<const Quote*>::const_iterator begin() const { return quotes.begin(); }
+    inline std::vector<const Quote*>::const_iterator end() const { return quotes.end(); }
+private:
+    struct Slot{
+        size_t hash;
+        const char* symbol;
+        // into quotes, -1 for an empty slot
+        int index;
+    };
+
+    // the slot of the symbol, or the empty one it would go to
+    size_t probe(const std::string_view& symbol, size_t hash) const;
+    void grow();
+
+    std::vector<Slot> slots;
+    size_t mask;
+    std::vector<const Quote*> quotes;
+};
+
+#endif // URPH_FIN_QUOTE_INDEX_HXX_
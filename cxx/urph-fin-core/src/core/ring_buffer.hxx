@@ -0,0 +1,63 @@
+#ifndef URPH_FIN_RING_BUFFER_HXX_
+#define URPH_FIN_RING_BUFFER_HXX_
+
+#include <cstddef>
+#include <memory>
+
+// FIFO of trivially copyable values in a power of two array.
+// clear() keeps the storage, so a buffer reused across calls stops allocating once it is big enough.
+template<typename T>
+class RingBuffer{
+public:
+    explicit RingBuffer(size_t capacity = 16){
+        size_t c = 1;
+        while(c < capacity) c <<= 1;
+        data = std::make_unique<T[]>(c);
+        mask = c - 1;
+    }
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    RingBuffer(RingBuffer&&) = default;
+    RingBuffer& operator=(RingBuffer&&) = default;
+
+    inline bool empty() const { return head == tail; }
+    inline size_t size() const { return tail - head; }
+    inline size_t capacity() const { return mask + 1; }
+    inline void clear() { head = tail = 0; }
+
+    inline T& front() { return data[head & mask]; }
+    inline void pop_front() { ++head; }
+    void push_back(const T& v){
+        if(size() == capacity()) grow();
+        data[tail++ & mask] = v;
+    }
+    // i-th value from the front
+    inline T& operator[](size_t i) { return data[(head + i) & mask]; }
+
+    template<typename F>
+    void for_each(F&& f){
+        for(size_t i = head; i != tail; ++i) f(data[i & mask]);
+    }
+    template<typename F>
+    void for_each(F&& f) const{
+        for(size_t i = head; i != tail; ++i) f(static_cast<const T&>(data[i & mask]));
+    }
+private:
+    void grow(){
+        const size_t n = size();
+        auto bigger = std::make_unique<T[]>(capacity() * 2);
+        for(size_t i = 0; i < n; ++i) bigger[i] = (*this)[i];
+        data = std::move(bigger);
+        mask = mask * 2 + 1;
+        head = 0;
+        tail = n;
+    }
+
+    std::unique_ptr<T[]> data;
+    size_t mask;
+    // ever increasing, wrapped by mask
+    size_t head = 0;
+    size_t tail = 0;
+};
+
+#endif // URPH_FIN_RING_BUFFER_HXX_
@@ -3,17 +3,17 @@
  #include <cstring>
 
 #include "../utils.hxx"
+#include "intern.hxx"
 
 Stock::Stock(const std::string_view& n, const std::string_view& ccy,asset_class_ratio&& ratios)
 {
-    symbol = copy_str(n);
-    currency = copy_str(ccy);
+    symbol = intern(n);
+    currency = intern(ccy);
     asset_class_ratios = std::move(ratios);
 }
 
 Stock& Stock::operator=(Stock&& o)
 {
-    free();
     symbol = o.symbol;
     currency = o.currency;
     o.symbol = nullptr;
@@ -22,20 +22,9 @@ Stock& Stock::operator=(Stock&& o)
     return *this;
 }
 
-void Stock::free()
-{
-    delete []symbol;
-    delete []currency;
-}
-
-Stock::~Stock()
-{
-    free();
-}
-
 StockTx::StockTx(const std::string_view& b, double s, double p, double f, const std::string_view& sd, timestamp dt)
 {
-    broker = copy_str(b);
+    broker = intern(b);
     shares = s;
     price = p;
     fee = f;
@@ -43,68 +32,113 @@ StockTx::StockTx(const std::string_view& b, double s, double p, double f, const
     date = dt;
 }
 
-StockTx::~StockTx()
-{
-    delete []broker;
-}
-
 StockTxList::StockTxList(int n, stock_tx *first)
 {
     num = n;
     first_tx = first;
+    assert(std::is_sorted(first, first + n, [](const stock_tx& tx1, const stock_tx& tx2){ return tx1.date < tx2.date; }));
 }
 
-StockTxList& StockTxList::operator=(StockTxList&& o)
+StockWithTx::StockWithTx(stock* i, stock_tx_list* t)
 {
-    free();
-    num = o.num;
-    first_tx = o.first_tx;
-    o.num = 0;
-    o.first_tx = nullptr;
-    return *this;
+    instrument = i;
+    tx_list = t;
 }
 
-StockTxList::~StockTxList()
+StockPortfolio::StockPortfolio(int n, stock* first_s,stock_with_tx* first)
 {
-    free();
+    num = n;
+    first_stock = first_s;
+    first_stock_with_tx = first;
 }
 
-void StockTxList::free()
+
+stock_balance StockTxList::calc()
 {
-    free_placement_allocated_structs<StockTxList, StockTx>(this);
-    delete []first_tx;
+    return StockTxList::calc(this->ptr_begin(), this->ptr_end(), true);
 }
 
-StockWithTx::StockWithTx(stock* i, stock_tx_list* t)
+Position& StockTxList::reusable_position()
 {
-    instrument = i;
-    tx_list = t;
+    thread_local Position position;
+    return position;
 }
 
-StockWithTx::~StockWithTx()
+void Position::reset()
 {
-    //owner of the instrument pointer is stock_portfolio, leave the memory free to it
-    delete static_cast<StockTxList*>(tx_list);
+    b = {0.0, 0.0, 0.0, 0.0};
+    lots.clear();
+    short_sold = false;
+    last = (std::numeric_limits<timestamp>::min)();
 }
 
-StockPortfolio::StockPortfolio(int n, stock* first_s,stock_with_tx* first)
+bool Position::apply(const stock_tx& tx)
 {
-    num = n;
-    first_stock = first_s;
-    first_stock_with_tx = first;
+    if(short_sold) return false;
+    last = tx.date;
+    b.fee += tx.fee;
+    if(tx.side == SPLIT){
+        // 1 to N share split, here price is the N
+        b.shares *= tx.price;
+        b.shares = floor(b.shares);
+        // apply to all open lots
+        lots.for_each([&tx](Lot& l){
+            l.price  /= tx.price;
+            l.shares *= tx.price;
+        });
+        return true;
+    }
+
+    auto s = tx.side  == BUY ? tx.shares : (tx.shares > 0 ? -1 : 1) * tx.shares;
+    b.shares += s;
+    b.liquidated -= tx.price * s;
+    if(s>0){
+        // buy
+        lots.push_back({tx.price, tx.shares, tx.fee});
+        return true;
+    }
+    // sell, first in first out
+    for(auto shares = tx.shares; shares > 0;){
+        if(lots.empty()){
+            short_sold = true;
+            return false;
+        }
+        auto& first = lots.front();
+        if (first.shares > shares){
+            first.shares -= shares;
+            shares = 0;
+        }
+        else{
+            shares -= first.shares;
+            lots.pop_front();
+        }
+    }
+    return true;
 }
 
-StockPortfolio::~StockPortfolio()
+stock_balance Position::balance() const
 {
-    free_placement_allocated_structs<StockPortfolio, StockWithTx>(this);
-    delete []first_stock_with_tx;
-
-    free_placement_allocated_structs<StockPortfolio, Stock>(this, stock_tag());
-    delete []first_stock;
+    if(short_sold){
+        const double& n = std::nan("");
+        return {n, n, n, n};
+    }
+    Lot r{0.0, 0.0, 0.0};
+    lots.for_each([&r](const Lot& x){
+        r.fee += x.fee;
+        // price here is used to save market value
+        r.price += x.price * x.shares;
+        r.shares += x.shares;
+    });
+    stock_balance balance = b;
+    balance.vwap = r.shares == 0 ? 0 : r.price  / r.shares;
+    return balance;
 }
 
-
-stock_balance StockTxList::calc()
+void StockTxList::sort_by_date(stock_tx* first, stock_tx* last)
 {
-    return StockTxList::calc(this->ptr_begin(), this->ptr_end());
+    const auto by_date = [](const stock_tx& tx1, const stock_tx& tx2){ return tx1.date < tx2.date; };
+    // the DAOs mostly return them in order already
+    if(!std::is_sorted(first, last, by_date)){
+        std::stable_sort(first, last, by_date);
+    }
 }
\ No newline at end of file
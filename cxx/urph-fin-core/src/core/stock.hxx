@@ -3,7 +3,11 @@
 
 #include "urph-fin-core.hxx"
 #include "../utils.hxx"
-#include <deque>
+#include "ring_buffer.hxx"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
 #include <cmath>
 #include <execution>
 #include <numeric>
@@ -13,6 +17,7 @@ namespace{
     const char log_tag[] = "urph-fin-storage";
 }
 
+// the names are interned, they live as long as the process and a stock never frees them
 class Stock: public stock{
 public:
     Stock(){
@@ -22,15 +27,12 @@ public:
     }
     Stock(const std::string_view& n, const std::string_view& ccy,asset_class_ratio&& ratios);
     Stock& operator=(Stock&&);
-    ~Stock();
-private:
-    void free();
 };
 
 class StockTx: public stock_tx{
 public: 
+    // broker is interned
     StockTx(const std::string_view& b, double s, double p, double f, const std::string_view& side,timestamp );
-    ~StockTx();
     const char* Side() const{
         return side == BUY ? "BUY" :  (side == SELL ? "SELL" : "SPLIT");
     }
@@ -38,11 +40,36 @@ public:
 
 
 
+// Running balance of the tx of one stock at one broker, applied in date order.
+// Bought lots stay open until sold, first in first out.
+// apply() is O(1) amortized, only a split touches every open lot.
+class Position{
+public:
+    Position(): lots(16) {}
+    void reset();
+    // false once more shares are sold than held, the balance is NaN from then on
+    bool apply(const stock_tx& tx);
+    // vwap of the open lots
+    stock_balance balance() const;
+    // date of the last tx applied, a tx before it needs the position to be rebuilt
+    inline timestamp last_date() const { return last; }
+private:
+    struct Lot{
+        double price;
+        double shares;
+        double fee;
+    };
+    stock_balance b = {0.0, 0.0, 0.0, 0.0};
+    RingBuffer<Lot> lots;
+    bool short_sold = false;
+    timestamp last = (std::numeric_limits<timestamp>::min)();
+};
+
 class StockTxList: public stock_tx_list{
 public:
+    // the tx are in date order, sort_by_date() puts them so before a builder makes the list:
+    // the C layout has no room for a flag, being a StockTxList is what records it
     StockTxList(int n, stock_tx *first);
-    StockTxList& operator=(StockTxList&&);
-    ~StockTxList();
 
     inline StockTx* head(default_member_tag) { return static_cast<StockTx*>(first_tx); }
     inline int size(default_member_tag) { return num; }
@@ -56,100 +83,46 @@ public:
 
     stock_balance calc();
 
+    // tx known to be sorted by date, as a StockTxList is, are valued in one pass without allocation,
+    // the others are copied and sorted first
     template<typename _RandomAccessIterator>
-    static stock_balance calc(_RandomAccessIterator _first, _RandomAccessIterator _last){
-        auto unclosed_positions = std::deque<UnclosedPosition>();
-        stock_balance balance = {0.0, 0.0, 0.0, 0.0};
-
-        std::vector<StockTx*> trades;///(std::distance(_first, _last));
-        //std::copy(_first, _last, std::back_inserter(trades));
-        for(auto it=_first;it!=_last;++it) trades.push_back(*it);
-        std::sort(trades.begin(), trades.end(), [](StockTx* tx1, StockTx*tx2){ return tx1->date < tx2->date; });
-
-        for(auto i = trades.begin(); i != trades.end(); ++i){
-            StockTx* tx = *i;
-            balance.fee += tx->fee;
-            if(tx->side == SPLIT){
-                // 1 to N share split, here price is the N
-                balance.shares *= tx->price;
-                balance.shares = floor(balance.shares);
-                // apply to all unclosed positions
-                for(auto& c: unclosed_positions){
-                    c.split(tx->price);
-                }
-            }
-            else{
-                auto s = tx->side  == BUY ? tx->shares : (tx->shares > 0 ? -1 : 1) * tx->shares;
-                balance.shares += s;
-                balance.liquidated -= tx->price * s;
-    
-                if(s>0){
-                    // buy
-                    unclosed_positions.push_back({tx->price, tx->shares, tx->fee});
-                }
-                else{
-                    // sell
-                    auto first_unclosed_pos = unclosed_positions.front().shares;
-                    for(auto shares = tx->shares; shares > 0;){
-                        if(unclosed_positions.empty()){
-                            const double& n = std::nan("");
-                            return {n, n, n, n};                        }
-                        else if (first_unclosed_pos > shares){
-                            unclosed_positions.begin()->shares = first_unclosed_pos - shares;
-                            shares = 0;
-                        }
-                        else if (first_unclosed_pos == shares){
-                            unclosed_positions.pop_front();
-                            shares = 0;
-                        }
-                        else{
-                            shares -= first_unclosed_pos;
-                            unclosed_positions.pop_front();
-                            first_unclosed_pos = unclosed_positions.front().shares;
-                        }
-                    }
-                }
-            }
+    static stock_balance calc(_RandomAccessIterator _first, _RandomAccessIterator _last, bool sorted = false){
+        const auto by_date = [](const StockTx* tx1, const StockTx* tx2){ return tx1->date < tx2->date; };
+        if(sorted){
+            assert(std::is_sorted(_first, _last, by_date));
+            return calc_sorted(_first, _last);
         }
-        auto r = std::accumulate(unclosed_positions.begin(), unclosed_positions.end(), UnclosedPosition{0.0, 0.0, 0.0},
-            [](UnclosedPosition& a, UnclosedPosition& x){
-                a.fee += x.fee;
-                // price here is used to save market value
-                a.price += x.price * x.shares;
-                a.shares += x.shares;
-                return a;
-            }
-        );
-        balance.vwap = r.shares == 0 ? 0 : r.price  / r.shares;
-        
-        return balance;
+        std::vector<StockTx*> trades;
+        for(auto it=_first;it!=_last;++it) trades.push_back(*it);
+        std::stable_sort(trades.begin(), trades.end(), by_date);
+        return calc_sorted(trades.begin(), trades.end());
     }
+
+    // sorts tx by date, keeping the order of the ones on the same date
+    static void sort_by_date(stock_tx* first, stock_tx* last);
 private:
-    void free();
-    class UnclosedPosition{
-    public:
-        double price;
-        double shares;
-        double fee;
-    
-        void split(double factor){
-            price  /=  factor;
-            shares *=  factor;
+    template<typename _Iterator>
+    static stock_balance calc_sorted(_Iterator _first, _Iterator _last){
+        auto& position = reusable_position();
+        position.reset();
+        for(auto i = _first; i != _last; ++i){
+            if(!position.apply(**i)) break;
         }
-    };
+        return position.balance();
+    }
+    // one per thread, calc() does not allocate once its open lots fit
+    static Position& reusable_position();
 };
 
 
 class StockWithTx: public stock_with_tx{
 public:
     StockWithTx(stock* i, stock_tx_list* t);
-    ~StockWithTx();
 };
 
 class StockPortfolio: public stock_portfolio{
 public:
     StockPortfolio(int n, stock* first_stock, stock_with_tx* first);
-    ~StockPortfolio();
 
     inline StockWithTx* head(default_member_tag) { return static_cast<StockWithTx*>(first_stock_with_tx); }
     inline int size(default_member_tag) { return num; }
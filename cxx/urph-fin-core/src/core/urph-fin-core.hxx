@@ -11,6 +11,7 @@
 #include <cmath>
 
 #include "../utils.hxx"
+#include "quote_index.hxx"
 
 // C++ extensions to make life (much more) easier
 #ifdef USE_FIREBASE
@@ -25,6 +26,9 @@ Config load_cfg();
 char* copy_str(const std::string& str);
 char* copy_str(const std::string_view& str);
 
+// results built by the storage builders are allocated in an arena, see arena.hxx
+class Arena;
+
 struct NonCopyableMoveable {
     NonCopyableMoveable & operator=(const NonCopyableMoveable&) = delete;
     NonCopyableMoveable(const NonCopyableMoveable&) = delete;
@@ -103,6 +107,8 @@ template<typename T> struct PtrIterator
     using iterator_category = std::forward_iterator_tag;
     using difference_type   = std::ptrdiff_t;
     using value_type        = T;
+    using pointer           = value_type*;
+    using reference         = value_type;
 
 
     explicit PtrIterator(T ptr) : _ptr(ptr) {}
@@ -136,13 +142,17 @@ void free_placement_allocated_structs(Wrapper* data, MemberTag mt = MemberTag())
 
 class CashBalance: public cash_balance{
 public:
-    CashBalance(const std::string_view& n, float v);
-    ~CashBalance();
+    // ccy is interned
+    CashBalance(const std::string_view& n, double v);
 };
 
+// The characters of all the strings are copied one after another in a single blob, strs points into it.
+// A header hidden in front of the strs array keeps track of the blob (no member can be added),
+// both grow geometrically and freeing takes two deletes whatever the number of strings.
 class Strings: public strings{
 public:
-    explicit Strings(int n);
+    // chars_per_str: expected average length, sizes the blob
+    explicit Strings(int n, size_t chars_per_str = 8);
     ~Strings();
     void add(const std::string_view& s, float increment_ratio = 0.5);
     void increase_capacity(long additional);
@@ -151,12 +161,17 @@ public:
     inline char** end()   { return last_str; }
     // caller is responsible for freeing the mem
     char** to_str_array();
+private:
+    struct Blob;
+    Blob* blob() const;
+    void reserve_chars(size_t n);
+    static char** allocate_strs(long capacity);
 };
 
 class Broker: public broker{
 public:
+    // balances, date and fund ids are in the arena already, the name is interned
     Broker(const std::string_view&n, int ccy_num, cash_balance* first_ccy_balance, char* yyyymmdd, strings* active_funds);
-    ~Broker();
 
     inline CashBalance* head(default_member_tag) { return static_cast<CashBalance*>(first_cash_balance); }
     inline int size(default_member_tag) const { return num; } 
@@ -173,7 +188,6 @@ public:
 class AllBrokers: public all_brokers{
 public:
     AllBrokers(int n, broker* broker);
-    ~AllBrokers();
     inline Broker* head(default_member_tag) { return static_cast<Broker*>(first_broker); }
     inline int size(default_member_tag) const { return num; } 
     Iterator<Broker> begin() { return Iterator( head(default_member_tag()) ); }
@@ -182,14 +196,18 @@ public:
 
 class Fund: public fund{
 public:
-    Fund(const std::string_view& b,  const std::string_view&n, int a, double c, double m, double prc, double p, double r,asset_class_ratio&& ratios, timestamp d);
-    ~Fund();
+    // broker is interned, name in the arena
+    Fund(Arena& arena, const std::string_view& b,  const std::string_view&n, int a, double c, double m, double prc, double p, double r,asset_class_ratio&& ratios, timestamp d);
 };
 
+struct FundColumns;
 class FundPortfolio: public fund_portfolio{
-public:
+    // only created as the top level result of an arena, columns() finds them from there
+    friend class Arena;
     FundPortfolio(int n, fund* fund);
-    ~FundPortfolio();
+public:
+    // built by FundsBuilder::build(), or on first use for a portfolio created in an arena otherwise
+    const FundColumns* columns();
     inline Fund* head(default_member_tag) { return static_cast<Fund*>(first_fund); }
     inline int size(default_member_tag) const { return num; }
 
@@ -201,8 +219,8 @@ public:
 };
 class Quote: public quote{
 public:
-    Quote(const std::string& s, timestamp t, double r);
-    ~Quote();
+    // symbol is interned
+    Quote(const std::string_view& s, timestamp t, double r);
 };
 
 class Quotes: public quotes{
@@ -211,10 +229,6 @@ public:
         num = n;
         first = head;
     }
-    ~Quotes(){
-        free_placement_allocated_structs<Quotes, Quote>(this);
-        delete []first;
-    }
     inline Quote* head(default_member_tag) { return static_cast<Quote*>(first); }
     inline int size(default_member_tag) const { return num; }
     Iterator<Quote> begin() { return Iterator(head(default_member_tag())); }
@@ -225,21 +239,20 @@ class QuoteBySymbol{
 public:
     explicit QuoteBySymbol(std::function<void(quotes*)> const& onLoaded):notify(onLoaded){}
     std::function<void(quotes*)> notify;
-    std::unordered_map<std::string, const Quote*> mapping;
-    inline void add(const std::string& sym, const Quote* q) {  mapping[sym] = q; }
+    QuoteIndex index;
+    inline void add(const Quote* q) { index.add(q->symbol, q); }
 };
 void get_all_quotes(QuoteBySymbol& quotes_by_symbol, OnProgress OnProgress, void* progress_ctx);
 
 class OverviewItem : public overview_item{
 public:
-    OverviewItem(const std::string& name, const std::string& ccy, double value, double value_in_main_ccy, double profit, double profit_in_main_ccy);
-    ~OverviewItem();
+    // the names live in the arena of the result
+    OverviewItem(char* name, char* ccy, double value, double value_in_main_ccy, double profit, double profit_in_main_ccy);
 };
 
 class OverviewItemList : public overview_item_list{
 public:
     OverviewItemList(int num, overview_item* head);
-    ~OverviewItemList();
     inline OverviewItem * head(default_member_tag) { return static_cast<OverviewItem*>(first); }
     inline int size(default_member_tag) const { return num; }
 
@@ -249,8 +262,7 @@ public:
 
 class OverviewItemContainer: public overview_item_container{
 public:
-    OverviewItemContainer(const std::string& name, const std::string& item_name,double value_sum_in_main_ccy, double profit_sum_in_main_ccy, int num, overview_item* head);
-    ~OverviewItemContainer();
+    OverviewItemContainer(char* name, char* item_name, double value_sum_in_main_ccy, double profit_sum_in_main_ccy, int num, overview_item* head);
     inline OverviewItem * head(default_member_tag) { return static_cast<OverviewItem*>(items); }
     inline int size(default_member_tag) const { return num; }
 
@@ -260,8 +272,7 @@ public:
 
 class OverviewItemContainerContainer: public overview_item_container_container{
 public:
-    OverviewItemContainerContainer(const std::string& name, const std::string& item_name, double value_sum_in_main_ccy, double profit_sum_in_main_ccy,int num, overview_item_container* head);
-    ~OverviewItemContainerContainer();
+    OverviewItemContainerContainer(char* name, char* item_name, double value_sum_in_main_ccy, double profit_sum_in_main_ccy,int num, overview_item_container* head);
     inline OverviewItemContainer* head(default_member_tag) { return static_cast<OverviewItemContainer*>(containers); }
     inline int size(default_member_tag) const { return num; }
 
@@ -271,8 +282,7 @@ public:
 
 class Overview: public overview{
 public:
-    Overview(const std::string& item_name, double value_sum_in_main_ccy, double profit_sum_in_main_ccy,int num, overview_item_container_container* head);
-    ~Overview();
+    Overview(char* item_name, double value_sum_in_main_ccy, double profit_sum_in_main_ccy,int num, overview_item_container_container* head);
     inline OverviewItemContainerContainer * head(default_member_tag) { return static_cast<OverviewItemContainerContainer*>(first); }
     inline int size(default_member_tag) const { return num; }
 
@@ -16,11 +16,18 @@
 #include "../utils.hxx"
 #include "../core/urph-fin-core.hxx"
 #include "../core/stock.hxx"
+#include "../core/arena.hxx"
+#include "../core/fund_columns.hxx"
 
+// Builders allocate the structs and strings of their result in one arena.
+// The success callback turns the arena into the result with Arena::create_owner(),
+// the free_* function of the result then releases the whole graph at once.
+// The builder holds the arena until it is deleted, then releases it if no result was
+// created (failure, nothing to return) or if the callback already freed the result.
 template <typename T>
 class Builder : public NonCopyableMoveable{
 public:
-    typedef PlacementNew<T> Alloc;
+    typedef ArenaArray<T> Alloc;
     Alloc* alloc;
 
     Builder() = delete;
@@ -31,7 +38,9 @@ public:
     }
 
    ~Builder(){
+        Arena& arena = alloc->arena();
         delete alloc;
+        Arena::unhold(&arena);
     }
     inline void succeed() {
         LDEBUG( "Builder succeeded");
@@ -47,7 +56,8 @@ protected:
     std::function<void(Alloc*)> onSuccess;
     // ensure this cannot be allocated in stack
     Builder(int num, std::function<void(Alloc*)> called_when_succeed){
-        alloc = new PlacementNew<T>(num);
+        alloc = new Alloc(*Arena::create(), num);
+        alloc->arena().hold();
         onSuccess = called_when_succeed;
     }
 };
@@ -63,53 +73,63 @@ public:
     }
 };
 
+// The DAOs fill it on their stack before the broker's result exists,
+// so it only keeps what they read until build() lays the broker out in the result arena
 class BrokerBuilder{
 public:
-    typedef PlacementNew<cash_balance> CashBalanceAlloc;
-    CashBalanceAlloc * balances_alloc;
-    StringsBuilder *funds_name_builder;
-    char* fund_update_date;
-    BrokerBuilder(int n, int active_fund_num){
-        balances_alloc = new CashBalanceAlloc(n);
-        funds_name_builder = active_fund_num > 0 ? new StringsBuilder(active_fund_num) : nullptr;
-        fund_update_date = nullptr;
-    }
-    ~BrokerBuilder(){
-        delete balances_alloc;
-        delete funds_name_builder;
+    BrokerBuilder(int n, int active_fund_num): has_active_funds(active_fund_num > 0){
+        balances.reserve(n);
+        active_funds.reserve(active_fund_num);
     }
     void set_fund_update_date(const std::string_view& yyyymmdd){
-        fund_update_date = copy_str(yyyymmdd);
+        fund_update_date = yyyymmdd;
+        has_fund_update_date = true;
     }
     void add_cash_balance(const std::string_view& currency, double balance){
         LDEBUG( "  " << currency << " " << balance);
-        auto * p = new (balances_alloc->next()) CashBalance(currency, balance);
-        LDEBUG( "CashBalance ccy=" << p->ccy << " " << p->balance);
+        balances.emplace_back(currency, balance);
     }
     void add_active_fund(const std::string_view& active_fund_id){
         LDEBUG( "adding fund " << active_fund_id);
-        funds_name_builder->add(active_fund_id);
+        active_funds.emplace_back(active_fund_id);
     }
+    Broker* build(Arena& arena, void* where, const std::string_view& name) const{
+        auto* first_balance = arena.allocate_array<cash_balance>(balances.size());
+        auto* balance = first_balance;
+        for(const auto& [ccy, value]: balances){
+            new (balance++) CashBalance(ccy, value);
+        }
+        strings* ids = nullptr;
+        if(has_active_funds){
+            ids = arena.make<strings>();
+            ids->capacity = active_funds.size();
+            ids->strs = arena.allocate_array<char*>(active_funds.size());
+            ids->last_str = ids->strs;
+            for(const auto& id: active_funds){
+                *ids->last_str++ = arena.copy_str(id);
+            }
+        }
+        char* date = has_fund_update_date ? arena.copy_str(fund_update_date) : nullptr;
+        return new (where) Broker(name, balances.size(), first_balance, date, ids);
+    }
+private:
+    std::vector<std::pair<std::string, double>> balances;
+    std::vector<std::string> active_funds;
+    std::string fund_update_date;
+    bool has_active_funds;
+    bool has_fund_update_date = false;
 };
 
 template<typename DAO, typename BrokerType>
 static void create_broker(
     DAO* dao,
     const BrokerType& brokerQueryResult,
-    std::function<Broker*(const std::string_view&/*name*/, int/*ccy_num*/, cash_balance* /*first_ccy_balance*/, char* /*yyyymmdd: fund update date*/, strings* /*active_fund_ids*/)> create_func,
+    std::function<Broker*(const std::string_view&/*name*/, const BrokerBuilder&)> create_func,
     std::function<void(Broker*)> onBrokerCreated)
 {
     dao->get_broker_cash_balance_and_active_funds(brokerQueryResult,
         [dao,&brokerQueryResult, &create_func, &onBrokerCreated](const BrokerBuilder& builder){
-            onBrokerCreated(
-                create_func(
-                    dao->get_broker_name(brokerQueryResult), 
-                    builder.balances_alloc->allocated_num(), 
-                    builder.balances_alloc->head(), 
-                    builder.fund_update_date, 
-                    builder.funds_name_builder == nullptr ? nullptr: builder.funds_name_builder->strings
-                )
-            );
+            onBrokerCreated(create_func(dao->get_broker_name(brokerQueryResult), builder));
         }
     );
 }
@@ -117,33 +137,34 @@ static void create_broker(
 template<typename DAO, typename BrokerType>
 class AllBrokerBuilder{
 public:
-    typedef PlacementNew<broker> BrokerAlloc;
+    typedef ArenaArray<broker> BrokerAlloc;
     BrokerAlloc *alloc;
     AllBrokerBuilder(int n){
         LDEBUG( "Total brokers:" << n);
-        alloc = new BrokerAlloc(n);
+        alloc = new BrokerAlloc(*Arena::create(), n);
+        alloc->arena().hold();
     }
     ~AllBrokerBuilder(){
+        Arena& arena = alloc->arena();
         delete alloc;
+        Arena::unhold(&arena);
     }
     void add_broker(DAO* dao, const BrokerType& b){
-        create_broker(dao, b, [&](const std::string_view&n, int ccy_num, cash_balance* first_ccy_balance, char* fund_update_date, strings* active_funds){
+        create_broker(dao, b, [&](const std::string_view&n, const BrokerBuilder& builder){
             LDEBUG( "creating broker " << n);
-#ifdef _MSC_VER
-            void* p = all_brokers++;
-            return new (p)
-#else
-            return new (alloc->next())
-#endif
-                Broker(n, ccy_num, first_ccy_balance, fund_update_date, active_funds);
+            return builder.build(alloc->arena(), alloc->next(), n);
         }, [](Broker* broker){ LDEBUG( "broker created"); });
     }
+    // the brokers added so far, free them with free_brokers()
+    AllBrokers* build(){
+        return alloc->arena().create_owner<AllBrokers>(alloc->allocated_num(), alloc->head());
+    }
 };
 
 class FundsBuilder: public Builder<fund>{
 public:
     Fund* add_fund(const std::string_view& broker,  const std::string_view& name,  int amount, double capital, double market_value, double price, double profit, double roi, asset_class_ratio&& ratios, timestamp date){
-        return new (alloc->next()) Fund(broker, name,
+        return new (alloc->next()) Fund(alloc->arena(), broker, name,
                                         amount,
                                         capital,
                                         market_value,
@@ -154,11 +175,18 @@ public:
                                         date
         );
     }
+    // the funds added so far and their columns, free them with free_funds()
+    static FundPortfolio* build(Alloc* fund_alloc){
+        Arena& arena = fund_alloc->arena();
+        auto* portfolio = arena.create_owner<FundPortfolio>(fund_alloc->allocated_num(), fund_alloc->head());
+        arena.set_companion(FundColumns::build(arena, fund_alloc->head(), fund_alloc->allocated_num()));
+        return portfolio;
+    }
 };
 
 class LatestQuotesBuilder: public Builder<quote>{
 public:
-    Quote* add_quote(const std::string& symbol, timestamp date, double rate){
+    Quote* add_quote(const std::string_view& symbol, timestamp date, double rate){
         LDEBUG( "Quote sym=" << symbol << ", date=" << date << ", rate=" << rate );
         return new (alloc->next()) Quote(symbol, date, rate);
     }
@@ -171,11 +199,12 @@ public:
         for(const auto& i: tx){
             delete i.second;
         }
+        Arena::unhold(arena);
     }
-    typedef PlacementNew<stock> StockAlloc;
-    typedef PlacementNew<stock_tx> TxAlloc;
+    typedef ArenaArray<stock> StockAlloc;
+    typedef ArenaArray<stock_tx> TxAlloc;
     typedef std::map<std::string, TxAlloc*> TxAllocPointerBySymbol;
-    typedef std::function<void(StockAlloc*, const TxAllocPointerBySymbol&)> OnSuccess;
+    typedef std::function<void(StockPortfolio*)> OnSuccess;
 
     static StockPortfolioBuilder* create(OnSuccess callback){
         return new StockPortfolioBuilder(callback);
@@ -189,19 +218,19 @@ public:
     void prepare_stock_alloc(int n) {
         LDEBUG( "Got " << n << " stocks");
         unfinished_stocks = n;
-        stock_alloc = new StockAlloc(n);
+        stock_alloc = new StockAlloc(*arena, n);
     }
     void prepare_stock_alloc_dont_know_total_num(int n) {
         LDEBUG( "Assuming " << n << " stocks");
         unfinished_stocks = -1;
-        stock_alloc = new StockAlloc(n);
+        stock_alloc = new StockAlloc(*arena, n);
     }
      void prepare_tx_alloc(const std::string& symbol, int num){
         LDEBUG( "Got " << num << " tx for " << symbol);
         if(num == 0 && unfinished_stocks >= 0){
             check_completion(nullptr);
         }
-        else tx[symbol] = new TxAlloc(num);
+        else tx[symbol] = new TxAlloc(*arena, num);
     }
     void rm_stock(const std::string& symbol){
         auto it = tx.find(symbol);
@@ -238,17 +267,19 @@ public:
     }
 
     void complete(){
-        onSuccess(stock_alloc, tx);
+        onSuccess(build());
         delete this;
     }
 
-    static stock_with_tx* create_stock_with_tx(StockAlloc* stock_alloc, const StockPortfolioBuilder::TxAllocPointerBySymbol& tx)
+private:
+    // lays the stock_with_tx and tx lists out next to the stocks and tx, the result owns the arena
+    StockPortfolio* build()
     {
-        int stock_num = stock_alloc->allocated_num();
-        stock_with_tx* head = new stock_with_tx[stock_num];
-        memset(head, 0, sizeof(stock_with_tx) * stock_num);
+        const int stock_num = stock_alloc->allocated_num();
+        auto* head = arena->allocate_array<stock_with_tx>(stock_num);
+        auto* lists = arena->allocate_array<stock_tx_list>(stock_num);
         stock_with_tx* current = head;
-        for(auto* b = stock_alloc->head(); b != stock_alloc->end(); ++b){
+        for(auto* b = stock_alloc->head(); b != stock_alloc->end(); ++b, ++lists){
             auto tx_iter = tx.find(b->symbol);
             int tx_num;
             stock_tx* first;
@@ -259,18 +290,23 @@ public:
             else{
                 tx_num = tx_iter->second->allocated_num();
                 first = tx_iter->second->head();
+                // calc() then values them without copying or sorting
+                StockTxList::sort_by_date(first, first + tx_num);
             }
-            new (current++) StockWithTx(b, new StockTxList(tx_num, first));
+            new (current++) StockWithTx(b, new (lists) StockTxList(tx_num, first));
         }
-        return head;
+        return arena->create_owner<StockPortfolio>(stock_num, stock_alloc->head(), head);
     }
-private:
+
     //https://stackoverflow.com/questions/1394132/macro-and-member-function-conflict
     int unfinished_stocks = (std::numeric_limits<int>::max)();
 
+    Arena* arena;
     TxAllocPointerBySymbol tx;
     OnSuccess onSuccess;
     StockPortfolioBuilder(OnSuccess on_success){
+        arena = Arena::create();
+        arena->hold();
         stock_alloc = nullptr;
         onSuccess = on_success;
     }
@@ -332,8 +368,10 @@ public:
             [this, &onBroker, param](const auto& brokerQueryResult) {
                 create_broker(dao.get(),
                     brokerQueryResult,
-                    [](const std::string_view&n, int ccy_num, cash_balance* first_ccy_balance, char* fund_update_date, strings* active_funds){
-                        return new Broker(n, ccy_num, first_ccy_balance, fund_update_date, active_funds);
+                    [](const std::string_view&n, const BrokerBuilder& builder){
+                        // a single broker is the top level result, free_broker() releases its arena
+                        Arena* arena = Arena::create();
+                        return builder.build(*arena, arena->owner_slot<Broker>(), n);
                     },
                     [&onBroker,param](Broker* b){ onBroker(b, param);}
                 );
@@ -344,7 +382,7 @@ public:
     void get_brokers(OnAllBrokers onAllBrokers, void* param){
         // capturing by value as it is going to be executed in another thread
         dao->get_brokers([=](auto *p){
-            AllBrokers * b = new AllBrokers(p->alloc->allocated_num(), p->alloc->head());
+            AllBrokers * b = p->build();
             delete p;
             onAllBrokers(b, param);
         });
@@ -358,7 +396,7 @@ public:
                 auto v = byBroker == 0 ? strcmp(f1.name, f2.name) : byBroker;
                 return v < 0;
             });
-            onFunds(new FundPortfolio(fund_alloc->allocated_num(), fund_alloc->head()), onFundsCallerProvidedParam);
+            onFunds(FundsBuilder::build(fund_alloc), onFundsCallerProvidedParam);
             clean_func();
         }));
         dao->get_funds(p, std::move(params));
@@ -367,10 +405,8 @@ public:
     void get_stock_portfolio(const char* broker, const char* symbol, OnAllStockTx onAllStockTx, void* caller_provided_param){
         // self delete upon finish
         auto *builder =
-            StockPortfolioBuilder::create([onAllStockTx, caller_provided_param](StockPortfolioBuilder::StockAlloc* stock_alloc, const StockPortfolioBuilder::TxAllocPointerBySymbol& tx){
-                const auto stock_num = stock_alloc->allocated_num();
-                auto *stock_with_tx_head = StockPortfolioBuilder::create_stock_with_tx(stock_alloc, tx);
-                onAllStockTx(new StockPortfolio(stock_num, stock_alloc->head(), stock_with_tx_head), caller_provided_param);
+            StockPortfolioBuilder::create([onAllStockTx, caller_provided_param](StockPortfolio* portfolio){
+                onAllStockTx(portfolio, caller_provided_param);
             });
         dao->get_stock_portfolio(builder, broker, symbol);
     }
@@ -382,7 +418,7 @@ public:
     void get_quotes(int num, const char **symbols_head, OnQuotes onQuotes, void* caller_provided_param){
         int preallocated_num = symbols_head == nullptr ? 10 : num;
         auto* builder = static_cast<LatestQuotesBuilder*>(LatestQuotesBuilder::create(preallocated_num,[onQuotes, caller_provided_param](LatestQuotesBuilder::Alloc* alloc){
-            onQuotes(new Quotes(alloc->allocated_num(), alloc->head()), caller_provided_param);
+            onQuotes(alloc->arena().create_owner<Quotes>(alloc->allocated_num(), alloc->head()), caller_provided_param);
         }));
 
         if (symbols_head == nullptr){
@@ -0,0 +1,199 @@
+#ifndef HTTP_STAND_IN_HXX
+#define HTTP_STAND_IN_HXX
+
+// Minimal HTTP/1.1 server on 127.0.0.1 standing in for Yahoo Finance in
+// tests and benchmarks, so they do not need the network.
+// Serves GET only, keeps connections alive, one thread per connection.
+
+#ifndef _WIN32
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class HttpStandIn{
+public:
+    struct Response{
+        int status = 200;
+        std::string body;
+        std::string content_type = "text/plain";
+    };
+    // called with the request target, e.g. "/v7/finance/quote?symbols=AAPL"
+    typedef std::function<Response(const std::string& target)> Handler;
+
+    explicit HttpStandIn(Handler h, std::chrono::milliseconds latency = std::chrono::milliseconds(0))
+        :handler(std::move(h)), latency(latency)
+    {
+        listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if(::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || ::listen(listen_fd, 64) != 0){
+            ::close(listen_fd);
+            listen_fd = -1;
+            return;
+        }
+        ::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+        acceptor = std::thread([this](){ accept_loop(); });
+    }
+
+    ~HttpStandIn(){
+        stopping = true;
+        if(listen_fd >= 0){
+            ::shutdown(listen_fd, SHUT_RDWR);
+            ::close(listen_fd);
+        }
+        if(acceptor.joinable()) acceptor.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for(auto fd: clients) if(fd >= 0) ::shutdown(fd, SHUT_RDWR);
+        }
+        for(auto& t: workers) t.join();
+    }
+
+    bool running() const { return port != 0; }
+
+    std::string base_url() const { return "http://127.0.0.1:" + std::to_string(port); }
+
+    size_t nb_requests() const { return requests; }
+    size_t nb_connections() const { return connections; }
+
+private:
+    void accept_loop(){
+        while(!stopping){
+            int fd = ::accept(listen_fd, nullptr, nullptr);
+            if(fd < 0) break;
+            ++connections;
+            std::lock_guard<std::mutex> lock(mutex);
+            clients.push_back(fd);
+            workers.emplace_back([this, fd](){ serve(fd); });
+        }
+    }
+
+    void serve(int fd){
+        std::string in;
+        char buf[4096];
+        for(;;){
+            auto end = in.find("\r\n\r\n");
+            if(end == std::string::npos){
+                auto n = ::recv(fd, buf, sizeof(buf), 0);
+                if(n <= 0) break;
+                in.append(buf, n);
+                continue;
+            }
+            // "GET <target> HTTP/1.1", requests have no body
+            auto first_space = in.find(' ');
+            auto second_space = in.find(' ', first_space + 1);
+            std::string target = in.substr(first_space + 1, second_space - first_space - 1);
+            in.erase(0, end + 4);
+
+            ++requests;
+            if(latency.count() > 0) std::this_thread::sleep_for(latency);
+            auto r = handler(target);
+
+            std::string out = "HTTP/1.1 " + std::to_string(r.status) + (r.status == 200 ? " OK" : " Error") + "\r\n"
+                + "Content-Type: " + r.content_type + "\r\n"
+                + "Content-Length: " + std::to_string(r.body.size()) + "\r\n"
+                + "Connection: keep-alive\r\n\r\n"
+                + r.body;
+            if(!send_all(fd, out)) break;
+        }
+        {
+            // forget fd before closing it, accept may reuse the number right away
+            std::lock_guard<std::mutex> lock(mutex);
+            for(auto& c: clients) if(c == fd) c = -1;
+        }
+        ::close(fd);
+    }
+
+    static bool send_all(int fd, const std::string& s){
+        size_t sent = 0;
+        while(sent < s.size()){
+            auto n = ::send(fd, s.data() + sent, s.size() - sent, MSG_NOSIGNAL);
+            if(n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+    Handler handler;
+    std::chrono::milliseconds latency;
+    int listen_fd = -1;
+    unsigned short port = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> requests{0};
+    std::atomic<size_t> connections{0};
+    std::thread acceptor;
+    std::mutex mutex;
+    std::vector<int> clients;
+    std::vector<std::thread> workers;
+};
+
+// Yahoo Finance like answers: 3 daily spots per download, a JSON quote per symbol of a batch.
+// Prices are derived from the symbol so the tests can check them.
+inline double stand_in_price(const std::string& symbol){
+    double p = 100.0;
+    for(char c: symbol) p += (unsigned char)c % 17;
+    return p;
+}
+
+inline HttpStandIn::Response yahoo_stand_in(const std::string& target){
+    const std::string download = "/v7/finance/download/";
+    const std::string quote = "/v7/finance/quote?symbols=";
+    HttpStandIn::Response r;
+    if(target.compare(0, download.size(), download) == 0){
+        auto symbol = target.substr(download.size(), target.find('?') - download.size());
+        auto p = std::to_string(stand_in_price(symbol));
+        r.body = "Date,Open,High,Low,Close,Adj Close,Volume\n"
+                 "2023-06-05," + p + "," + p + "," + p + "," + p + "," + p + ",100\n"
+                 "2023-06-06," + p + "," + p + "," + p + "," + p + "," + p + ",100\n"
+                 "2023-06-07," + p + "," + p + "," + p + "," + p + "," + p + ",100\n";
+        r.content_type = "text/csv";
+    }
+    else if(target.compare(0, quote.size(), quote) == 0){
+        auto list = target.substr(quote.size(), target.find('&') - quote.size());
+        r.body = "{\"quoteResponse\":{\"result\":[";
+        size_t start = 0;
+        while(start < list.size()){
+            auto end = list.find("%2C", start);
+            if(end == std::string::npos) end = list.size();
+            std::string symbol;
+            for(size_t i = start; i < end; ++i){
+                if(list[i] == '%' && i + 2 < end){
+                    symbol += (char)std::stoi(list.substr(i + 1, 2), nullptr, 16);
+                    i += 2;
+                }
+                else symbol += list[i];
+            }
+            if(start > 0) r.body += ",";
+            r.body += "{\"language\":\"en-US\",\"symbol\":\"" + symbol + "\",\"regularMarketTime\":1686096000,"
+                      "\"regularMarketPrice\":" + std::to_string(stand_in_price(symbol)) + ",\"exchange\":\"NMS\"}";
+            start = end + 3;
+        }
+        r.body += "],\"error\":null}}";
+        r.content_type = "application/json";
+    }
+    else{
+        r.status = 404;
+        r.body = "Not Found";
+    }
+    return r;
+}
+
+#endif // _WIN32
+#endif // HTTP_STAND_IN_HXX
@@ -1,9 +1,15 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include "core/stock.hxx"
 #include "storage/storage.hxx"
 #include "core/core_internal.hxx"
+#include "civil_date.hxx"
+#include "core/intern.hxx"
+#include "core/fund_columns.hxx"
+#include "core/handle_table.hxx"
 
 TEST(TestStrings, Basic)
 {
@@ -53,6 +59,28 @@ TEST(TestStrings, IncreaseCapacity)
     delete[] head;
 }
 
+TEST(TestStrings, Blob)
+{
+    // starts empty, grows both the pointer array and the blob many times
+    auto* ss = new Strings(0, 1);
+    const int n = 10000;
+    for(int i = 0; i < n; ++i){
+        ss->add("SYM" + std::to_string(i));
+    }
+    ASSERT_EQ(n, ss->size());
+    ASSERT_GE(ss->capacity, n);
+
+    int i = 0;
+    char* expected_next = *ss->begin();
+    for(char* p: *ss){
+        ASSERT_STREQ(("SYM" + std::to_string(i++)).c_str(), p);
+        // one after another in the same blob
+        ASSERT_EQ(expected_next, p);
+        expected_next = p + strlen(p) + 1;
+    }
+    free_strings(ss);
+}
+
 TEST(TestStock, Basic)
 {
     Stock s1(std::string("SYM"), std::string("USD"), std::move(asset_class_ratio{0,0,0,0}));
@@ -74,6 +102,22 @@ TEST(TestStock, MoveAssignment)
     ASSERT_EQ(s1.currency, nullptr);
 }
 
+TEST(TestStock, NamesInterned)
+{
+    const char* symbol;
+    {
+        Stock s1(std::string("SYM"), std::string("USD"), std::move(asset_class_ratio{0,0,0,0}));
+        Stock s2(std::string("NOS"), std::string("JPY"), std::move(asset_class_ratio{0,0,0,0}));
+        s2 = std::move(s1);
+        symbol = s2.symbol;
+        ASSERT_EQ(intern("SYM"), symbol);
+    }
+    // destroying or moving a stock leaves its names to the intern table
+    ASSERT_EQ(intern("SYM"), symbol);
+    ASSERT_STREQ("SYM", symbol);
+    ASSERT_STREQ("JPY", intern("JPY"));
+}
+
 TEST(TestPlacementNew, Basic)
 {
     const int size = 2;
@@ -142,6 +186,115 @@ TEST(TestPlacementNew, Resize)
     delete []new_head;
 }
 
+TEST(TestArena, Owner)
+{
+    Arena* arena = Arena::create();
+    ASSERT_FALSE(arena->has_owner());
+
+    ArenaArray<quote> alloc(*arena, 2);
+    new (alloc.next()) Quote("AAPL", 100, 1.5);
+    new (alloc.next()) Quote("MSFT", 200, 2.5);
+    auto* q = arena->create_owner<Quotes>(alloc.allocated_num(), alloc.head());
+
+    ASSERT_TRUE(arena->has_owner());
+    ASSERT_EQ(arena, Arena::of(q));
+    ASSERT_EQ(q->num, 2);
+    ASSERT_STREQ(q->first[0].symbol, "AAPL");
+    ASSERT_STREQ(q->first[1].symbol, "MSFT");
+    ASSERT_EQ(q->first[1].rate, 2.5);
+    free_quotes(q);
+    free_quotes(nullptr);
+    Arena::release(nullptr);
+}
+
+TEST(TestIntern, Basic)
+{
+    const std::string usd = "USD";
+    const char* p = intern(usd);
+    ASSERT_STREQ(p, "USD");
+    ASSERT_EQ(p, intern(std::string_view("USD/JPY", 3)));
+    ASSERT_NE(p, usd.c_str());
+    ASSERT_NE(p, intern("JPY"));
+
+    const size_t n = interned_num();
+    intern("USD");
+    ASSERT_EQ(n, interned_num());
+
+    ASSERT_EQ(Name("USD"), Name::of_interned(p));
+    ASSERT_NE(Name("USD"), Name("JPY"));
+    ASSERT_LT(Name("JPY"), Name("USD"));
+    ASSERT_FALSE(Name("USD") < Name("USD"));
+    ASSERT_TRUE(Name().empty());
+    ASSERT_EQ(Name(static_cast<const char*>(nullptr)), Name(""));
+}
+
+TEST(TestIntern, Concurrent)
+{
+    const int thread_num = 8;
+    const int name_num = 200;
+    std::vector<std::vector<const char*>> got(thread_num);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < thread_num; ++t){
+        threads.emplace_back([t, &got](){
+            for(int i = 0; i < name_num; ++i){
+                got[t].push_back(intern("intern-test-" + std::to_string((i + t * 7) % name_num)));
+            }
+        });
+    }
+    for(auto& t: threads) t.join();
+
+    for(int t = 0; t < thread_num; ++t){
+        for(int i = 0; i < name_num; ++i){
+            const auto expected = "intern-test-" + std::to_string((i + t * 7) % name_num);
+            ASSERT_STREQ(got[t][i], expected.c_str());
+            ASSERT_EQ(got[t][i], intern(expected));
+        }
+    }
+}
+
+TEST(TestArena, Hold)
+{
+    // the result is freed by the success callback while its builder still holds the arena
+    Arena* arena = Arena::create();
+    arena->hold();
+    auto* q = arena->create_owner<Quotes>(0, nullptr);
+    free_quotes(q);
+    ASSERT_TRUE(arena->has_owner()); // still there
+    Arena::unhold(arena);
+
+    // a result that outlives its builder
+    arena = Arena::create();
+    arena->hold();
+    q = arena->create_owner<Quotes>(0, nullptr);
+    Arena::unhold(arena);
+    ASSERT_EQ(q->num, 0);
+    free_quotes(q);
+}
+
+TEST(TestArena, Grow)
+{
+    Arena* arena = Arena::create(256);
+
+    ArenaArray<stock_tx> alloc(*arena, 1);
+    stock_tx* head = alloc.head();
+    alloc.next()->date = 0;
+    alloc.next()->date = 1; // nothing allocated after the array: grows in place
+    ASSERT_EQ(head, alloc.head());
+
+    const char* s = arena->copy_str("SYM");
+    ASSERT_STREQ(s, "SYM");
+    for(int i = 2; i < 8; ++i) alloc.next()->date = i; // copied after the string, in a new block
+    ASSERT_NE(head, alloc.head());
+    ASSERT_GT(arena->block_num(), 1);
+    ASSERT_EQ(alloc.allocated_num(), 8);
+    for(int i = 0; i < 8; ++i) ASSERT_EQ(alloc.head()[i].date, i);
+    ASSERT_STREQ(s, "SYM");
+
+    auto* big = arena->allocate_array<double>(Arena::MAX_BLOCK_SIZE); // larger than any block
+    big[Arena::MAX_BLOCK_SIZE - 1] = 1;
+    Arena::release(arena);
+}
+
 
 struct stock_test_data
 {
@@ -288,7 +441,7 @@ TEST(TestStockPortfolio, get_stock_all_portfolio1)
         ASSERT_EQ((15.0*60.0 + 10.0*70.0)/expected_shares , balance.vwap);
       }
     }
-    delete port; },
+    free_stock_portfolio(port); },
         &triggered);
     ASSERT_TRUE(triggered);
 }
@@ -323,11 +476,97 @@ TEST(TestStockPortfolio, get_stock_all_portfolio2)
       ASSERT_EQ(balance.vwap, 367.65);
       break;
     }
-    delete port; },
+    free_stock_portfolio(port); },
         &triggered);
     ASSERT_TRUE(triggered);
 }
 
+namespace{
+std::vector<stock_tx_test_data> test2_tx_reversed(test2_tx.rbegin(), test2_tx.rend());
+}
+
+TEST(TestStockPortfolio, tx_sorted_by_builder)
+{
+    auto triggered = false;
+    static std::vector<stock_tx_test_data> *all_tx[] = {&test2_tx_reversed};
+    auto storage = Storage<MockedStocksDao>(new MockedStocksDao(test2_stocks, all_tx));
+    storage.get_stock_portfolio(
+        nullptr, nullptr, [](stock_portfolio *p, void *param)
+        {
+    bool *triggered = reinterpret_cast<bool*>(param);
+    *triggered = true;
+    StockPortfolio *port = static_cast<StockPortfolio*>(p);
+    for(const auto& stx: *port){
+      auto *list = static_cast<StockTxList*>(stx.tx_list);
+      ASSERT_TRUE(std::is_sorted(list->ptr_begin(), list->ptr_end(), [](StockTx* a, StockTx* b){ return a->date < b->date; }));
+      auto balance = list->calc();
+      ASSERT_EQ(balance.shares, 400 );
+      ASSERT_EQ(balance.vwap, 367.65);
+    }
+    free_stock_portfolio(port); },
+        &triggered);
+    ASSERT_TRUE(triggered);
+}
+
+TEST(TestStockTxList, unsorted)
+{
+    stock_tx txs[] = {
+        {"b", 1.0, 10.0, 100.0, BUY,  1000},
+        {"b", 1.0, 10.0, 40.0,  BUY,  2000},
+        {"b", 1.0, 15.0, 100.0, SELL, 3000},
+        {"b", 0.0, 2.0,  0.0,   BUY,  3000}, // same date as the sell, after it
+    };
+    StockTxList sorted(4, txs);
+    const auto expected = sorted.calc();
+    ASSERT_EQ(expected.shares, 7.0);
+    ASSERT_EQ(expected.fee, 3.0);
+    ASSERT_EQ(expected.vwap, (5.0 * 40.0 + 2.0 * 0.0) / 7.0);
+
+    std::vector<StockTx*> shuffled = {
+        static_cast<StockTx*>(&txs[2]), static_cast<StockTx*>(&txs[0]),
+        static_cast<StockTx*>(&txs[3]), static_cast<StockTx*>(&txs[1])
+    };
+    const auto balance = StockTxList::calc(shuffled.begin(), shuffled.end());
+    ASSERT_EQ(balance.shares, expected.shares);
+    ASSERT_EQ(balance.liquidated, expected.liquidated);
+    ASSERT_EQ(balance.vwap, expected.vwap);
+
+    // the sell before the buy of the same date stays first
+    std::swap(txs[0], txs[1]);
+    StockTxList::sort_by_date(txs, txs + 4);
+    ASSERT_EQ(txs[0].date, 1000);
+    ASSERT_EQ(txs[2].side, SELL);
+    ASSERT_EQ(txs[3].shares, 2.0);
+
+    // selling more than was bought
+    stock_tx short_sell[] = {{"b", 0.0, 10.0, 100.0, SELL, 1000}};
+    StockTxList list(1, short_sell);
+    ASSERT_TRUE(std::isnan(list.calc().shares));
+}
+
+TEST(TestRingBuffer, wrap_and_grow)
+{
+    RingBuffer<int> ring(4);
+    ASSERT_EQ(ring.capacity(), 4);
+    for(int i = 0; i < 3; ++i) ring.push_back(i);
+    ring.pop_front();
+    ring.pop_front();
+    for(int i = 3; i < 6; ++i) ring.push_back(i); // wraps around
+    ASSERT_EQ(ring.capacity(), 4);
+    ASSERT_EQ(ring.size(), 4);
+    ring.push_back(6); // grows
+    ASSERT_EQ(ring.capacity(), 8);
+    for(int i = 2; i <= 6; ++i){
+        ASSERT_EQ(ring.front(), i);
+        ring.pop_front();
+    }
+    ASSERT_TRUE(ring.empty());
+    ring.push_back(7);
+    ring.clear();
+    ASSERT_TRUE(ring.empty());
+    ASSERT_EQ(ring.capacity(), 8);
+}
+
 namespace{
 
 const char usd[] = "USD";
@@ -427,7 +666,7 @@ Quotes* prepare_quotes(QuoteBySymbol& quotes_by_symbol)
 {
     Quotes *q = nullptr;
     auto *builder = static_cast<LatestQuotesBuilder *>(LatestQuotesBuilder::create(5, [&q](LatestQuotesBuilder::Alloc *alloc){
-        q = new Quotes(alloc->allocated_num(), alloc->head());
+        q = alloc->arena().create_owner<Quotes>(alloc->allocated_num(), alloc->head());
     }));
     builder->add_quote(usd_jpy, usd_jpy_date, usd_jpy_rate);
     builder->add_quote(stock1, stock1_date, stock1_price);
@@ -437,7 +676,7 @@ Quotes* prepare_quotes(QuoteBySymbol& quotes_by_symbol)
     builder->succeed();
 
     for(auto const& quote: *q){
-        quotes_by_symbol.mapping[quote.symbol] = &quote;
+        quotes_by_symbol.add(&quote);
     }
 
     return q;
@@ -447,10 +686,8 @@ StockPortfolio* prepare_stocks()
 {
     StockPortfolio* stocks;
 
-    auto *builder = StockPortfolioBuilder::create([&stocks](StockPortfolioBuilder::StockAlloc* stock_alloc, const StockPortfolioBuilder::TxAllocPointerBySymbol& tx){
-        const auto stock_num = stock_alloc->allocated_num();
-        auto *stock_with_tx_head = StockPortfolioBuilder::create_stock_with_tx(stock_alloc, tx);
-        stocks = new StockPortfolio(stock_num, stock_alloc->head(), stock_with_tx_head);
+    auto *builder = StockPortfolioBuilder::create([&stocks](StockPortfolio* portfolio){
+        stocks = portfolio;
     });
 
     builder->prepare_stock_alloc(4);
@@ -488,7 +725,7 @@ FundPortfolio* prepare_funds()
 {
     FundPortfolio* funds;
     auto *builder = static_cast<FundsBuilder*>(FundsBuilder::create(3,[&funds](FundsBuilder::Alloc* fund_alloc){
-        funds = new FundPortfolio(fund_alloc->allocated_num(), fund_alloc->head());
+        funds = FundsBuilder::build(fund_alloc);
     }));
 
     asset_class_ratio ratio {0,0,0,0};
@@ -532,7 +769,7 @@ AllBrokers* prepare_brokers()
     auto *builder = new AllBrokerBuilder<BrokerDao, BrokerType>(2);
     builder->add_broker(&dao, 0);
     builder->add_broker(&dao, 1);
-    AllBrokers * b = new AllBrokers(builder->alloc->allocated_num(), builder->alloc->head());
+    AllBrokers * b = builder->build();
     delete builder;
     return b;
 }
@@ -610,8 +847,8 @@ struct PrepareAssets
         }
 
         ~PrepareAssets(){
-            delete brokers;
-            delete q;
+            free_brokers(brokers);
+            free_quotes(q);
             delete assets;
             delete quotes_by_symbol;
         }
@@ -672,7 +909,133 @@ TEST(TestOverview, load_assets)
 }
 
 
+TEST(TestOverview, add_stock_tx)
+{
+    PrepareAssets prepare;
+    auto& items = prepare.assets->items;
+    const auto item_num = items.size();
+    auto stock_item = [&items](const std::string& broker, const char* ccy) -> AssetItem& {
+        return *std::find_if(items.begin(), items.end(), [&](const AssetItem& i){
+            return i.asset_type == ASSET_TYPE_STOCK && i.broker == broker && i.currency == ccy;
+        });
+    };
+    const double broker1_usd_value  = stock_item(broker1, usd).value;
+    const double broker1_usd_profit = stock_item(broker1, usd).profit;
+
+    // more of a stock already held
+    ASSERT_TRUE(prepare.assets->add_stock_tx(stock1, StockTx(broker1, 100, 110, 0, "BUY", stock1_date + 1)));
+    EXPECT_DOUBLE_EQ(stock_item(broker1, usd).value, broker1_usd_value + stock1_price * 100);
+    EXPECT_DOUBLE_EQ(stock_item(broker1, usd).profit, broker1_usd_profit + (stock1_price - 110) * 100);
+
+    // a stock held at another broker
+    ASSERT_TRUE(prepare.assets->add_stock_tx(stock3, StockTx(broker1, 10, 20, 0, "BUY", stock3_date)));
+    EXPECT_DOUBLE_EQ(stock_item(broker1, usd).value, broker1_usd_value + stock1_price * 100 + stock3_price * 10);
+    EXPECT_DOUBLE_EQ(stock_item(broker1, usd).profit,
+        broker1_usd_profit + (stock1_price - 110) * 100 + (stock3_price - 20) * 10);
+
+    // all sold
+    ASSERT_TRUE(prepare.assets->add_stock_tx(stock2, StockTx(broker2, stock2_shares, 250, 0, "SELL", stock2_date + 1)));
+    EXPECT_EQ(stock_item(broker2, jpy).value, 0);
+    EXPECT_EQ(stock_item(broker2, jpy).profit, 0);
+
+    // sold before it was bought, replayed in date order
+    ASSERT_TRUE(prepare.assets->add_stock_tx(stock3, StockTx(broker2, 5, 20, 0, "SELL", stock3_date - 1)));
+    EXPECT_TRUE(std::isnan(stock_item(broker2, usd).value));
+    EXPECT_TRUE(std::isnan(stock_item(broker2, usd).profit));
+
+    // unknown until the portfolio is reloaded
+    ASSERT_FALSE(prepare.assets->add_stock_tx("Stock5", StockTx(broker1, 10, 20, 0, "BUY", 100)));
+    ASSERT_EQ(items.size(), item_num);
+}
+
+TEST(TestFundColumns, built_with_portfolio)
+{
+    FundPortfolio* funds = prepare_funds();
+    const FundColumns* cols = funds->columns();
+    ASSERT_EQ(cols, Arena::of(funds)->companion<FundColumns>());
+    ASSERT_EQ(cols->num, 3);
+    ASSERT_EQ(cols->broker_num, 2);
+    ASSERT_EQ(cols->brokers[0], intern(broker1));
+    ASSERT_EQ(cols->brokers[1], intern(broker2));
+    int i = 0;
+    for(const Fund& f: *funds){
+        ASSERT_EQ(cols->market_value[i], f.market_value);
+        ASSERT_EQ(cols->capital[i], f.capital);
+        ASSERT_EQ(cols->amount[i], f.amount);
+        ASSERT_EQ(cols->date[i], f.date);
+        ASSERT_EQ(cols->brokers[cols->broker_id[i]], f.broker);
+        ++i;
+    }
+
+    auto sum = calc_fund_sum(funds);
+    ASSERT_EQ(sum.capital, funds1_capital + funds2_capital + funds3_capital);
+    ASSERT_EQ(sum.market_value, funds1_value + funds2_value + funds3_value);
+    ASSERT_EQ(sum.profit, sum.market_value - sum.capital);
+
+    // created in an arena without its columns, they are built on first use
+    Arena* arena = Arena::create();
+    auto* bare = arena->create_owner<FundPortfolio>(funds->num, funds->first_fund);
+    ASSERT_EQ(arena->companion<FundColumns>(), nullptr);
+    ASSERT_EQ(bare->columns()->num, 3);
+    ASSERT_EQ(bare->columns(), arena->companion<FundColumns>());
+    free_funds(bare);
+    free_funds(funds);
+}
+
+TEST(TestFundColumns, compensated)
+{
+    // 0.1 is not exact in binary, a naive sum drifts away from n / 10
+    const size_t n = 1000003;
+    std::vector<double> v(n, 0.1);
+    v[0] = 1e8;
+    double naive = 0;
+    for(double x: v) naive += x;
+    const double expected = 1e8 + (n - 1) / 10.0;
+    ASSERT_NE(naive, expected);
+    ASSERT_DOUBLE_EQ(compensated_sum(v.data(), n), expected);
+    ASSERT_LT(std::fabs(compensated_sum(v.data(), n) - expected), std::fabs(naive - expected) / 100);
+
+    // groups 1 0 1 0 ... then a run of 2
+    std::vector<int> group(n);
+    for(size_t i = 0; i < n; ++i) group[i] = i < n / 2 ? (i + 1) % 2 : 2;
+    double sums[3];
+    compensated_group_sum(v.data(), group.data(), n, sums, 3);
+    ASSERT_DOUBLE_EQ(sums[0], (n / 2 / 2) / 10.0);
+    ASSERT_DOUBLE_EQ(sums[1], 1e8 + (n / 2 - n / 2 / 2 - 1) / 10.0);
+    ASSERT_DOUBLE_EQ(sums[2], (n - n / 2) / 10.0);
+}
+
 extern overview* get_overview(AllAssets* assets, const char* main_ccy, GROUP level1_group, GROUP level2_group, GROUP level3_group);
+TEST(TestIntern, results_share_names)
+{
+    PrepareAssets prepare;
+
+    // every result points at the same copy of a broker or currency name
+    const char* broker1_name = intern(broker1);
+    const char* usd_name = intern(usd);
+    int broker1_tx = 0;
+    for(auto& stx: *prepare.stocks){
+        if(strcmp(stx.instrument->currency, usd) == 0){
+            ASSERT_EQ(stx.instrument->currency, usd_name);
+        }
+        for(auto& tx: *static_cast<StockTxList*>(stx.tx_list)){
+            if(strcmp(tx.broker, broker1.c_str()) == 0){
+                ASSERT_EQ(tx.broker, broker1_name);
+                ++broker1_tx;
+            }
+        }
+    }
+    ASSERT_EQ(broker1_tx, 3);
+    for(Broker& b: *prepare.brokers){
+        for(const CashBalance& balance: b){
+            if(strcmp(balance.ccy, usd) == 0){
+                ASSERT_EQ(balance.ccy, usd_name);
+            }
+        }
+    }
+    ASSERT_EQ(prepare.brokers->head(default_member_tag())->name, broker1_name);
+}
+
 TEST(TestOverview, overview_group_by_asset_broker)
 {
     PrepareAssets prepare;
@@ -775,10 +1138,256 @@ TEST(TestOverview, overview_group_by_asset_broker)
         }
     }
 
-    delete overview;
+    free_overview(overview);
+}
+
+TEST(TestOverview, overview_every_group_combination)
+{
+    PrepareAssets prepare;
+    const char* names[] = {"Asset", "Broker", "Currency"};
+
+    auto* by_asset = get_overview(prepare.assets, jpy, GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY);
+    const double total = by_asset->value_sum_in_main_ccy;
+    free_overview(by_asset);
+
+    for(GROUP g1 = 0; g1 < 3; ++g1)
+    for(GROUP g2 = 0; g2 < 3; ++g2)
+    for(GROUP g3 = 0; g3 < 3; ++g3){
+        auto* overview = static_cast<Overview*>(get_overview(prepare.assets, jpy, g1, g2, g3));
+        ASSERT_STREQ(names[g1], overview->item_name);
+        ASSERT_DOUBLE_EQ(total, overview->value_sum_in_main_ccy);
+        size_t items = 0;
+        for(auto& lvl1: *overview){
+            ASSERT_STREQ(names[g2], lvl1.item_name);
+            for(auto& lvl2: lvl1){
+                ASSERT_STREQ(names[g3], lvl2.item_name);
+                items += lvl2.num;
+            }
+        }
+        ASSERT_EQ(prepare.assets->items.size(), items);
+        free_overview(overview);
+    }
+
+    ASSERT_EQ(nullptr, get_overview(prepare.assets, jpy, GROUP_BY_ASSET, 3, GROUP_BY_CCY));
 }
 
 extern overview_item_list* get_sum_group(AllAssets* assets, const char* main_ccy, GROUP group);
+
+TEST(TestOverview, cached)
+{
+    PrepareAssets prepare;
+
+    auto* o1 = get_overview(prepare.assets, jpy, GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY);
+    auto* o2 = get_overview(prepare.assets, jpy, GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY);
+    ASSERT_EQ(o1, o2);
+    // other levels or main ccy
+    auto* by_broker = get_overview(prepare.assets, jpy, GROUP_BY_BROKER, GROUP_BY_ASSET, GROUP_BY_CCY);
+    auto* in_usd = get_overview(prepare.assets, usd, GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY);
+    ASSERT_NE(o1, by_broker);
+    ASSERT_NE(o1, in_usd);
+    auto* sum = get_sum_group(prepare.assets, jpy, GROUP_BY_ASSET);
+    ASSERT_EQ(sum, get_sum_group(prepare.assets, jpy, GROUP_BY_ASSET));
+    free_overview_item_list(sum);
+    free_overview_item_list(sum);
+
+    // a new tx changes the items: computed again, the result already handed out is still usable
+    const double value = o1->value_sum_in_main_ccy;
+    ASSERT_TRUE(prepare.assets->add_stock_tx(stock1, StockTx(broker1, 100, 110, 0, "BUY", stock1_date + 1)));
+    auto* o3 = get_overview(prepare.assets, jpy, GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY);
+    ASSERT_NE(o1, o3);
+    ASSERT_EQ(value, o1->value_sum_in_main_ccy);
+    ASSERT_DOUBLE_EQ(value + stock1_price * 100 * usd_jpy_rate, o3->value_sum_in_main_ccy);
+
+    for(auto* o: {o1, o2, by_broker, in_usd, o3}) free_overview(o);
+}
+
+namespace{
+// the sources of PrepareAssets, passed in to a loading AllAssets in any order
+struct LoadAssets
+{
+    QuoteBySymbol quotes_by_symbol{[](quotes*){}};
+    Quotes* q = prepare_quotes(quotes_by_symbol);
+    AllBrokers* brokers = prepare_brokers();
+    std::atomic<int> loaded{0};
+    AllAssets assets{[this](){ ++loaded; }, quotes_by_symbol};
+
+    ~LoadAssets(){
+        free_brokers(brokers);
+        free_quotes(q);
+    }
+
+    void in(AllAssets::Loaded source){
+        switch(source){
+            // the test keeps the quotes
+            case AllAssets::Quotes: assets.quotes_in(nullptr); break;
+            case AllAssets::Brokers: assets.brokers_in(brokers); break;
+            case AllAssets::Funds: assets.funds_in(prepare_funds()); break;
+            case AllAssets::Stocks: assets.stocks_in(prepare_stocks()); break;
+            default: FAIL() << "not a source: " << source;
+        }
+    }
+};
+
+const AllAssets::Loaded sources[] = {AllAssets::Quotes, AllAssets::Brokers, AllAssets::Funds, AllAssets::Stocks};
+} // namespace
+
+TEST(TestOverview, load_in_any_order)
+{
+    PrepareAssets prepare;
+    std::vector<AllAssets::Loaded> order(std::begin(sources), std::end(sources));
+    std::sort(order.begin(), order.end());
+    do{
+        SCOPED_TRACE(::testing::PrintToString(order));
+        LoadAssets load;
+        for(size_t i = 0; i < order.size(); ++i){
+            ASSERT_EQ(0, load.loaded);
+            load.in(order[i]);
+        }
+        ASSERT_EQ(1, load.loaded);
+        // merged in the same order whichever source came in first
+        ASSERT_EQ(prepare.assets->items, load.assets.items);
+
+        // the stock sums point at the merged items
+        const StockTx tx(broker1, 100, 110, 0, "BUY", stock1_date + 1);
+        ASSERT_TRUE(load.assets.add_stock_tx(stock1, tx));
+        PrepareAssets added;
+        ASSERT_TRUE(added.assets->add_stock_tx(stock1, tx));
+        ASSERT_EQ(added.assets->items, load.assets.items);
+
+        // quotes coming in again do not load it again
+        load.in(AllAssets::Quotes);
+        ASSERT_EQ(1, load.loaded);
+    }while(std::next_permutation(order.begin(), order.end()));
+}
+
+TEST(TestOverview, load_concurrently)
+{
+    PrepareAssets prepare;
+    for(int round = 0; round < 50; ++round){
+        LoadAssets load;
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for(auto source: sources){
+            threads.emplace_back([&load, &go, source](){
+                while(!go) std::this_thread::yield();
+                load.in(source);
+            });
+        }
+        go = true;
+        for(auto& t: threads) t.join();
+        ASSERT_EQ(1, load.loaded);
+        ASSERT_EQ(prepare.assets->items, load.assets.items);
+    }
+}
+
+extern IDataStorage* set_storage(IDataStorage* s);
+namespace{
+// answers the load at once on the calling thread, like a storage whose data is all cached; the quotes never come
+class LoadedStorage: public IDataStorage
+{
+public:
+    void get_broker(const char*, OnBroker, void*) override {}
+    void get_brokers(OnAllBrokers onAllBrokers, void* param) override { onAllBrokers(prepare_brokers(), param); }
+    void get_funds(std::vector<FundsParam>&, OnFunds onFunds, void* param, const std::function<void()>& clean_func) override {
+        onFunds(prepare_funds(), param);
+        // frees the brokers before the fetch of the funds returns
+        clean_func();
+    }
+    void get_stock_portfolio(const char*, const char*, OnAllStockTx onAllStockTx, void* param) override { onAllStockTx(prepare_stocks(), param); }
+    void get_known_stocks(OnStrings, void*) override {}
+    void get_quotes(int, const char**, OnQuotes, void*) override {}
+    void add_tx(const char*, const char*, double, double, double, const char*, timestamp, OnDone, void*) override {}
+    void update_cash(const char*, const char*, double, OnDone, void*) override {}
+};
+} // namespace
+
+TEST(TestOverview, load_brokers_then_funds)
+{
+    PrepareAssets prepare;
+    LoadedStorage storage;
+    auto* previous = set_storage(&storage);
+    int loaded = 0;
+    {
+        // the cash of the brokers is loaded before their funds are fetched, which frees them
+        AllAssets assets([&loaded](){ ++loaded; });
+        assets.load(nullptr, nullptr);
+        ASSERT_EQ(0, loaded);
+        assets.quotes_in(nullptr);
+        ASSERT_EQ(1, loaded);
+
+        // no quote values the stocks, the cash and funds are those of the brokers
+        auto not_stock = [](const AssetItem& i){ return i.asset_type != Name(ASSET_TYPE_STOCK); };
+        AssetItems expected, items;
+        std::copy_if(prepare.assets->items.begin(), prepare.assets->items.end(), std::back_inserter(expected), not_stock);
+        std::copy_if(assets.items.begin(), assets.items.end(), std::back_inserter(items), not_stock);
+        ASSERT_EQ(expected, items);
+        ASSERT_EQ(prepare.assets->items.size(), assets.items.size());
+    }
+    set_storage(previous);
+}
+
+TEST(TestOverview, unknown_handle)
+{
+    // never loaded or already freed
+    const AssetHandle stale = 12345;
+    ASSERT_EQ(nullptr, get_overview(stale, jpy, GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY));
+    ASSERT_EQ(nullptr, get_sum_group_by_asset(stale, jpy));
+    ASSERT_EQ(nullptr, get_sum_group_by_broker(stale, jpy));
+    ASSERT_EQ(nullptr, get_all_ccy(stale));
+    ASSERT_EQ(nullptr, get_all_ccy_pairs_quote(stale));
+    ASSERT_EQ(nullptr, get_latest_quote(stale, "USDJPY=X"));
+}
+
+TEST(TestOverview, unknown_main_ccy_not_interned)
+{
+    PrepareAssets prepare;
+    const size_t n = interned_num();
+
+    // no quote converts into it, every value is NaN and it is neither interned nor cached
+    auto* o1 = get_overview(prepare.assets, "XXQ", GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY);
+    auto* o2 = get_overview(prepare.assets, "XXQ", GROUP_BY_ASSET, GROUP_BY_BROKER, GROUP_BY_CCY);
+    ASSERT_NE(o1, o2);
+    ASSERT_TRUE(std::isnan(o1->value_sum_in_main_ccy));
+    auto* sum = get_sum_group(prepare.assets, "XXQ", GROUP_BY_ASSET);
+    ASSERT_TRUE(std::isnan(prepare.assets->to_main_ccy(100.0, "XXQ", "USD")));
+    ASSERT_EQ(n, interned_num());
+
+    free_overview_item_list(sum);
+    for(auto* o: {o1, o2}) free_overview(o);
+}
+
+TEST(TestOverview, add_stock_tx_while_reading)
+{
+    PrepareAssets prepare;
+    const size_t item_num = prepare.assets->items.size();
+    const int broker_num = 200;
+
+    // every tx is at a broker of its own: a new item each time, the items move as they grow
+    std::atomic<bool> added{false};
+    std::thread adding([&](){
+        for(int b = 0; b < broker_num; ++b){
+            EXPECT_TRUE(prepare.assets->add_stock_tx(stock1, StockTx("concurrent-broker" + std::to_string(b), 10, 100, 0, "BUY", stock1_date + 1)));
+        }
+        added = true;
+    });
+    size_t seen = item_num;
+    while(!added){
+        auto* o = static_cast<Overview*>(get_overview(prepare.assets, jpy, GROUP_BY_BROKER, GROUP_BY_ASSET, GROUP_BY_CCY));
+        auto* sum = get_sum_group(prepare.assets, jpy, GROUP_BY_BROKER);
+        size_t items = 0;
+        for(auto& lvl1: *o){
+            for(auto& lvl2: lvl1) items += lvl2.num;
+        }
+        // a consistent state of the items, never fewer than seen before
+        EXPECT_GE(items, seen);
+        seen = items;
+        free_overview_item_list(sum);
+        free_overview(o);
+    }
+    adding.join();
+    ASSERT_EQ(prepare.assets->items.size(), item_num + broker_num);
+}
+
 const char ASSET[] = "Asset";
 TEST(TestOverview, get_sum_group_by_asset)
 {
@@ -807,7 +1416,7 @@ TEST(TestOverview, get_sum_group_by_asset)
     }
 
 
-    delete by_asset;
+    free_overview_item_list(by_asset);
 }
 
 extern const quote* get_latest_quote(AllAssets*, const char* symbol);
@@ -867,4 +1476,207 @@ TEST(TestOverview, get_all_ccy_pairs_quote)
     ASSERT_EQ(quotes->num, 1);
     assert_quote_eq(quotes->first, usd_jpy.c_str() , usd_jpy_date, usd_jpy_rate);
     free_quotes(quotes);
-}
\ No newline at end of file
+}
+
+TEST(TestHandleTable, generations)
+{
+    HandleTable<int, 2> table;
+    int a = 1, b = 2, c = 3;
+    const auto ha = table.reserve();
+    ASSERT_GT(ha, 0);
+    ASSERT_EQ(nullptr, table.find(ha).get()); // not published yet
+    table.publish(ha, &a);
+    const auto hb = table.reserve();
+    table.publish(hb, &b);
+    ASSERT_EQ(0, table.reserve()); // full
+    ASSERT_EQ(&a, table.find(ha).get());
+    ASSERT_EQ(&b, table.find(hb).get());
+
+    // the slot of a is reused, its old handle finds nothing
+    ASSERT_EQ(&a, table.remove(ha));
+    ASSERT_EQ(nullptr, table.remove(ha));
+    const auto hc = table.reserve();
+    table.publish(hc, &c);
+    ASSERT_NE(ha, hc);
+    ASSERT_EQ(nullptr, table.find(ha).get());
+    ASSERT_EQ(&c, table.find(hc).get());
+    ASSERT_EQ(nullptr, table.find(0).get());
+    ASSERT_EQ(nullptr, table.find(hc + 2).get()); // no such slot
+
+    int sum = 0;
+    table.for_each([&sum](int* p){ sum += *p; });
+    ASSERT_EQ(b + c, sum);
+
+    // removed before it was published, its slot stays free
+    ASSERT_EQ(&c, table.remove(hc));
+    const auto hd = table.reserve();
+    ASSERT_EQ(nullptr, table.remove(hd));
+    ASSERT_FALSE(table.publish(hd, &a));
+    ASSERT_FALSE(table.publish(hc, &a));
+    ASSERT_EQ(nullptr, table.find(hd).get());
+    sum = 0;
+    table.for_each([&sum](int* p){ sum += *p; });
+    ASSERT_EQ(b, sum);
+}
+
+TEST(TestHandleTable, remove_waits_for_readers)
+{
+    HandleTable<int> table;
+    int a = 1;
+    const auto h = table.reserve();
+    table.publish(h, &a);
+
+    std::atomic<bool> removed{false};
+    std::thread remover;
+    {
+        auto ref = table.find(h);
+        remover = std::thread([&](){
+            table.remove(h);
+            removed = true;
+        });
+        // new lookups fail as soon as the generation moved on, the old ref still holds
+        while(table.find(h).get() != nullptr) std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_FALSE(removed);
+        ASSERT_EQ(1, *ref);
+    }
+    remover.join();
+    ASSERT_TRUE(removed);
+}
+
+TEST(TestQuoteIndex, find_without_copy)
+{
+    std::vector<Quote> quotes;
+    quotes.reserve(1000);
+    for(int i = 0; i < 1000; ++i) quotes.emplace_back("SYM" + std::to_string(i), i, i * 0.5);
+    QuoteIndex index(4);
+    for(const auto& q: quotes) index.add(q.symbol, &q);
+    ASSERT_EQ(1000, index.size());
+    for(const auto& q: quotes){
+        ASSERT_EQ(&q, index.find(q.symbol));
+    }
+
+    // a symbol inside a longer string, not null terminated
+    const std::string symbols = "SYM12,SYM999";
+    ASSERT_EQ(&quotes[12], index.find(std::string_view(symbols).substr(0, 5)));
+    ASSERT_EQ(&quotes[1], index.find(std::string_view(symbols).substr(0, 4)));
+    ASSERT_EQ(nullptr, index.find("SYM1000"));
+    ASSERT_EQ(nullptr, index.find(""));
+
+    // the symbol is interned: the index points to the quote's own
+    Quote newer("SYM12", 2000, 6.5);
+    index.add(newer.symbol, &newer);
+    ASSERT_EQ(newer.symbol, quotes[12].symbol);
+    ASSERT_EQ(1000, index.size());
+    ASSERT_EQ(6.5, index.find("SYM12")->rate);
+    ASSERT_EQ(&quotes[0], *index.begin());
+}
+
+TEST(TestFxMatrix, inverse_and_cross_rates)
+{
+    Quote usdjpy("USDJPY=X", 0, 150.0), hkdusd("HKDUSD=X", 0, 0.128), eurusd("EURUSD=X", 0, 1.1), stock("AAPL", 0, 190.0);
+    QuoteBySymbol by_symbol([](quotes*){});
+    for(auto* q: {&usdjpy, &hkdusd, &eurusd, &stock}) by_symbol.add(q);
+    const FxMatrix fx(by_symbol);
+
+    ASSERT_EQ(4, fx.ccy_num());
+    ASSERT_EQ((std::vector<std::string>{"EURUSD=X", "HKDUSD=X", "USDJPY=X"}), fx.pairs());
+    ASSERT_EQ(-1, fx.id(Name("AAPL")));
+
+    ASSERT_EQ(150.0, fx.rate(Name("USD"), Name("JPY")));
+    ASSERT_DOUBLE_EQ(1 / 150.0, fx.rate(Name("JPY"), Name("USD")));
+    ASSERT_DOUBLE_EQ(0.128 * 150.0, fx.rate(Name("HKD"), Name("JPY")));
+    ASSERT_DOUBLE_EQ(1.1 / 0.128, fx.rate(Name("EUR"), Name("HKD")));
+    ASSERT_EQ(1.0, fx.rate(Name("CHF"), Name("CHF")));
+    ASSERT_TRUE(std::isnan(fx.rate(Name("CHF"), Name("JPY"))));
+    for(int i = 0; i < fx.ccy_num(); ++i){
+        for(int j = 0; j < fx.ccy_num(); ++j) ASSERT_DOUBLE_EQ(1.0, fx.rate(i, j) * fx.rate(j, i));
+    }
+}
+
+TEST(TestOverview, to_main_ccy_inverse_quote)
+{
+    PrepareAssets prepare;
+    ASSERT_DOUBLE_EQ(usd_jpy_rate, prepare.assets->to_main_ccy(usd_jpy_rate * usd_jpy_rate, "JPY", "USD"));
+    ASSERT_EQ(100.0, prepare.assets->to_main_ccy(100.0, "USD", "USD"));
+}
+
+static_assert(civil::days_from_civil(1970, 1, 1) == 0);
+static_assert(civil::days_from_civil(2000, 3, 1) == 11017);
+static_assert(civil::civil_from_days(-1).year == 1969);
+static_assert(civil::last_day_of_month(2024, 2) == 29 && civil::last_day_of_month(2100, 2) == 28);
+static_assert(civil::epoch_from_civil(2023, 6, 5) == 1685923200);
+
+TEST(TestCivilDate, round_trip)
+{
+    // every day from 1900 to 2100 against timegm/gmtime_r
+    for(int64_t days = civil::days_from_civil(1900, 1, 1); days <= civil::days_from_civil(2100, 12, 31); ++days){
+        const int64_t epoch = days * civil::SECONDS_PER_DAY + 12345;
+        const std::time_t t = static_cast<std::time_t>(epoch);
+        std::tm tm{};
+        gmtime_r(&t, &tm);
+
+        const auto c = civil::civil_from_epoch(epoch);
+        ASSERT_EQ(c.year, tm.tm_year + 1900);
+        ASSERT_EQ(c.month, tm.tm_mon + 1);
+        ASSERT_EQ(c.day, tm.tm_mday);
+        ASSERT_EQ(civil::days_from_civil(c.year, c.month, c.day), days);
+        ASSERT_EQ(civil::start_of_day(epoch), days * civil::SECONDS_PER_DAY);
+
+        char expected[16];
+        strftime(expected, sizeof(expected), "%Y-%m-%d", &tm);
+        ASSERT_EQ(civil::to_date_string(epoch), expected);
+    }
+}
+
+TEST(TestCivilDate, parse_and_format)
+{
+    int64_t epoch = 0;
+    ASSERT_TRUE(civil::parse_date("2024-02-29", epoch));
+    ASSERT_EQ(epoch, civil::epoch_from_civil(2024, 2, 29));
+    ASSERT_TRUE(civil::parse_date("20240229", epoch, '\0'));
+    ASSERT_EQ(epoch, civil::epoch_from_civil(2024, 2, 29));
+    ASSERT_TRUE(civil::parse_date("1969-12-31,1.0", epoch));
+    ASSERT_EQ(epoch, -civil::SECONDS_PER_DAY);
+    ASSERT_TRUE(civil::parse_date("2000-02-29", epoch));
+    ASSERT_EQ(epoch, civil::epoch_from_civil(2000, 2, 29));
+
+    epoch = 42;
+    ASSERT_FALSE(civil::parse_date("2024-2-29", epoch));
+    ASSERT_FALSE(civil::parse_date("2024/02/29", epoch));
+    ASSERT_FALSE(civil::parse_date("2024-13-01", epoch));
+    ASSERT_FALSE(civil::parse_date("2024-01-00", epoch));
+    // no such day in the month
+    ASSERT_FALSE(civil::parse_date("2023-02-29", epoch));
+    ASSERT_FALSE(civil::parse_date("2023-02-30", epoch));
+    ASSERT_FALSE(civil::parse_date("2023-04-31", epoch));
+    ASSERT_FALSE(civil::parse_date("1900-02-29", epoch));
+    ASSERT_FALSE(civil::parse_date("20231131", epoch, '\0'));
+    ASSERT_FALSE(civil::parse_date("null", epoch));
+    ASSERT_FALSE(civil::parse_date("", epoch));
+    ASSERT_EQ(epoch, 42);
+
+    char buf[civil::DATE_TIME_LEN];
+    const int64_t t = civil::epoch_from_civil(2023, 6, 5) + 9 * 3600 + 8 * 60 + 7;
+    ASSERT_EQ(std::string(buf, civil::format_compact_date(t, buf)), "20230605");
+    ASSERT_EQ(std::string(buf, civil::format_date(t, buf)), "2023-06-05");
+    ASSERT_EQ(std::string(buf, civil::format_date_time(t, buf)), "2023-06-05 09:08:07");
+    // JST crosses midnight
+    ASSERT_EQ(std::string(buf, civil::format_date_time(t + 6 * 3600, buf, 9 * 3600)), "2023-06-06 00:08:07");
+    ASSERT_EQ(std::string(buf, civil::format_date_time(-1, buf)), "1969-12-31 23:59:59");
+}
+
+TEST(TestCivilDate, local_date_time)
+{
+    const int64_t from = civil::epoch_from_civil(2023, 1, 1);
+    for(int64_t epoch = from; epoch < from + 366 * civil::SECONDS_PER_DAY; epoch += 7 * 3600 + 13){
+        const std::time_t t = static_cast<std::time_t>(epoch);
+        std::tm tm{};
+        localtime_r(&t, &tm);
+        char expected[32];
+        strftime(expected, sizeof(expected), "%Y-%m-%d %H:%M:%S", &tm);
+
+        char buf[civil::DATE_TIME_LEN];
+        ASSERT_EQ(std::string(buf, civil::format_local_date_time(epoch, buf)), expected);
+    }
+}
@@ -0,0 +1,893 @@
+#ifdef YAHOO_FINANCE
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+
+#include "../mkt-data-src/yahoo-finance/quote.hpp"
+#include "../mkt-data-src/yahoo-finance/batch_quote.hpp"
+#include "../mkt-data-src/yahoo-finance/curl_utils.hpp"
+#include "../mkt-data-src/yahoo-finance/fetch_engine.hpp"
+#include "../mkt-data-src/yahoo-finance/request_scheduler.hpp"
+#include "../mkt-data-src/yahoo-finance/last_spots.hpp"
+#include "../mkt-data-src/yahoo-finance/spot_cache.hpp"
+#include "../mkt-data-src/yahoo-finance/spot_csv.hpp"
+#include "../mkt-data-src/yahoo-finance/time_utils.hpp"
+#include "http_stand_in.hxx"
+
+namespace{
+const char csv[] =
+    "Date,Open,High,Low,Close,Adj Close,Volume\n"
+    "2023-06-01,177.699997,180.119995,176.929993,180.089996,179.612045,68901800\n"
+    "2023-06-02,181.029999,181.779999,179.259995,180.949997,180.469757,61945900\n"
+    "2023-06-05,null,null,null,null,null,null\n"
+    "2023-06-06,179.970001,180.119995,177.429993,179.210007,178.734390,64848400\n";
+}
+
+TEST(TestYahooQuote, parseHistoricalCsv)
+{
+    YahooFinance::Quote q("AAPL");
+    q.parseHistoricalCsv(csv);
+
+    ASSERT_EQ(q.nbSpots(), 3);
+    auto first = q.getSpot((size_t)0);
+    ASSERT_EQ(first.getDate(), dateToEpoch("2023-06-01"));
+    ASSERT_DOUBLE_EQ(first.getOpen(), 177.699997);
+    ASSERT_DOUBLE_EQ(first.getClose(), 180.089996);
+
+    auto last = q.getSpot((size_t)2);
+    ASSERT_EQ(last.getDateToString(), "2023-06-06");
+    ASSERT_DOUBLE_EQ(last.getHigh(), 180.119995);
+    ASSERT_DOUBLE_EQ(last.getLow(), 177.429993);
+}
+
+TEST(TestYahooQuote, parseErrorResponse)
+{
+    YahooFinance::Quote q("NOSUCHSYMBOL");
+    q.parseHistoricalCsv("404 Not Found: No data found, symbol may be delisted");
+    ASSERT_EQ(q.nbSpots(), 0);
+}
+
+TEST(TestYahooQuote, lookups)
+{
+    // out of order, with a duplicated date
+    YahooFinance::Quote q("AAPL");
+    q.parseHistoricalCsv(csv);
+    q.parseHistoricalCsv("Date,Open,High,Low,Close,Adj Close,Volume\n"
+                         "2023-05-31,175.0,176.0,174.0,175.5,175.0,1\n"
+                         "2023-06-02,1.0,1.0,1.0,1.0,1.0,1\n");
+    ASSERT_EQ(q.nbSpots(), 4);
+    auto all = q.getSpots();
+    ASSERT_EQ(all.size(), 4);
+    for(size_t i = 1; i < all.size(); ++i){
+        ASSERT_LT(all.dates[i - 1], all.dates[i]);
+    }
+    // the first spot of a date wins
+    ASSERT_DOUBLE_EQ(q.getSpot(std::string("2023-06-02")).getClose(), 180.949997);
+
+    const std::time_t jun1 = dateToEpoch("2023-06-01");
+    ASSERT_TRUE(q.findSpot(jun1).has_value());
+    ASSERT_DOUBLE_EQ(q.findSpot(jun1)->getClose(), 180.089996);
+    ASSERT_FALSE(q.findSpot(jun1 + 3600).has_value());
+    ASSERT_FALSE(q.findSpot(dateToEpoch("2023-06-05")).has_value());
+    ASSERT_THROW(q.getSpot(dateToEpoch("2023-06-05")), std::invalid_argument);
+    ASSERT_THROW(q.getSpot(std::string("not a date")), std::invalid_argument);
+
+    // as of: last spot on or before
+    ASSERT_FALSE(q.findSpotAsOf(dateToEpoch("2023-05-30")).has_value());
+    ASSERT_THROW(q.getSpotAsOf(dateToEpoch("2023-05-30")), std::invalid_argument);
+    ASSERT_EQ(q.getSpotAsOf(dateToEpoch("2023-05-31")).getDateToString(), "2023-05-31");
+    ASSERT_EQ(q.getSpotAsOf(dateToEpoch("2023-06-05") + 3600).getDateToString(), "2023-06-02");
+    ASSERT_EQ(q.getSpotAsOf(dateToEpoch("2024-01-01")).getDateToString(), "2023-06-06");
+
+    // ranges, both ends included
+    auto range = q.getSpots(jun1, dateToEpoch("2023-06-06"));
+    ASSERT_EQ(range.size(), 3);
+    ASSERT_EQ(range.spot(0).getDateToString(), "2023-06-01");
+    ASSERT_EQ(range.spot(2).getDateToString(), "2023-06-06");
+    ASSERT_DOUBLE_EQ(range.close.back(), 179.210007);
+    ASSERT_EQ(q.getSpots(jun1 + 1, dateToEpoch("2023-06-05")).size(), 1);
+    ASSERT_TRUE(q.getSpots(dateToEpoch("2023-06-03"), dateToEpoch("2023-06-05")).empty());
+    ASSERT_TRUE(q.getSpots(dateToEpoch("2023-06-06"), jun1).empty());
+    ASSERT_EQ(range.close.subspan(1, 10).size(), 2);
+}
+
+TEST(TestPriceSeries, columns)
+{
+    YahooFinance::PriceSeries series;
+    series.add(30, 3.0, 3.5, 2.5, 3.0);
+    series.add(10, 1.0, 1.5, 0.5, 1.0);
+    series.add(20, 2.0, 2.5, 1.5, 2.0);
+    series.add(10, 9.0, 9.0, 9.0, 9.0);
+    series.sortByDate();
+    ASSERT_EQ(series.size(), 3);
+    ASSERT_EQ(series.dates()[0], 10);
+    ASSERT_EQ(series.close()[0], 1.0);
+    ASSERT_EQ(series.high()[2], 3.5);
+    ASSERT_EQ(series.low()[1], 1.5);
+    ASSERT_EQ(series.open()[2], 3.0);
+    ASSERT_EQ(series.spot(1).getDate(), 20);
+
+    ASSERT_EQ(series.lowerBound(15), 1);
+    ASSERT_EQ(series.upperBound(20), 2);
+    auto v = series.view(11, 30);
+    ASSERT_EQ(v.size(), 2);
+    ASSERT_EQ(v.close[0], 2.0);
+    ASSERT_TRUE(series.view(31, 40).empty());
+    ASSERT_TRUE(series.view(30, 10).empty());
+}
+
+TEST(TestPriceSeries, analytics)
+{
+    const std::vector<double> closes{100.0, 110.0, 99.0, 99.0, 108.9};
+    auto r = YahooFinance::simpleReturns(closes);
+    ASSERT_EQ(r.size(), 4);
+    ASSERT_NEAR(r[0], 0.1, 1e-12);
+    ASSERT_NEAR(r[1], -0.1, 1e-12);
+    ASSERT_DOUBLE_EQ(r[2], 0.0);
+    ASSERT_NEAR(r[3], 0.1, 1e-12);
+
+    auto l = YahooFinance::logReturns(closes);
+    ASSERT_EQ(l.size(), 4);
+    ASSERT_NEAR(l[0], std::log(1.1), 1e-12);
+
+    auto m = YahooFinance::rollingMean(closes, 2);
+    ASSERT_EQ(m.size(), 4);
+    ASSERT_DOUBLE_EQ(m[0], 105.0);
+    ASSERT_NEAR(m[3], 103.95, 1e-12);
+    ASSERT_EQ(YahooFinance::rollingMean(closes, 5).size(), 1);
+    ASSERT_TRUE(YahooFinance::rollingMean(closes, 6).empty());
+    ASSERT_TRUE(YahooFinance::simpleReturns(YahooFinance::Span<const double>(closes.data(), 1)).empty());
+
+    // the series of a quote, close column only
+    YahooFinance::Quote q("AAPL");
+    q.parseHistoricalCsv(csv);
+    auto returns = YahooFinance::simpleReturns(q.getPriceSeries().close());
+    ASSERT_EQ(returns.size(), 2);
+    ASSERT_DOUBLE_EQ(returns[0], 180.949997 / 180.089996 - 1.0);
+}
+
+TEST(TestSpotCsv, parseIsoDate)
+{
+    std::time_t t;
+    ASSERT_TRUE(YahooFinance::parseIsoDate("1970-01-01", t));
+    ASSERT_EQ(t, 0);
+    for(auto d: {"2000-02-29", "2023-06-01", "1999-12-31", "2100-03-01"}){
+        ASSERT_TRUE(YahooFinance::parseIsoDate(d, t));
+        ASSERT_EQ(t, dateToEpoch(d)) << d;
+    }
+    ASSERT_FALSE(YahooFinance::parseIsoDate("null", t));
+    ASSERT_FALSE(YahooFinance::parseIsoDate("2023-13-01", t));
+    ASSERT_FALSE(YahooFinance::parseIsoDate("2023/06/01", t));
+}
+
+TEST(TestSpotCsv, parseDouble)
+{
+    // the same with from_chars or the strtod fallback
+    double v = 0.0;
+    ASSERT_TRUE(YahooFinance::parseDouble("180.949997", v));
+    ASSERT_DOUBLE_EQ(v, 180.949997);
+    ASSERT_TRUE(YahooFinance::parseDouble("-2.5e3", v));
+    ASSERT_DOUBLE_EQ(v, -2500.0);
+    for(auto s: {"null", "", "+1", " 1", "1.5x", "1,5", "0x10"}){
+        ASSERT_FALSE(YahooFinance::parseDouble(s, v)) << s;
+    }
+}
+
+TEST(TestSpotCsv, fixtures)
+{
+    auto read_fixture = [](const char* name){
+        std::ifstream in(std::string(FIXTURE_DIR) + "/" + name);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    };
+
+    YahooFinance::Quote equity("EQUITY");
+    equity.parseHistoricalCsv(read_fixture("daily_10y_equity.csv"));
+    ASSERT_EQ(equity.nbSpots(), 2608);
+    ASSERT_EQ(equity.getSpot((size_t)0).getDateToString(), "2013-01-02");
+    ASSERT_EQ(equity.getSpot((size_t)0).getOpen(), 145.0);
+    ASSERT_EQ(equity.getSpot(equity.nbSpots() - 1).getDateToString(), "2022-12-30");
+
+    // 3 rows of nulls are skipped
+    YahooFinance::Quote fx("FX");
+    fx.parseHistoricalCsv(read_fixture("daily_5y_fx.csv"));
+    ASSERT_EQ(fx.nbSpots(), 1305 - 3);
+    ASSERT_THROW(fx.getSpot(std::string("2019-01-01")), std::invalid_argument);
+    ASSERT_EQ(fx.getSpot(std::string("2019-01-02")).getDateToString(), "2019-01-02");
+}
+
+TEST(TestSpotCsv, stream)
+{
+    std::ifstream in(std::string(FIXTURE_DIR) + "/daily_5y_fx.csv");
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string body = ss.str();
+
+    std::vector<std::time_t> expected;
+    YahooFinance::parseSpotsCsv(body, [&](std::time_t d, double, double, double, double){ expected.push_back(d); });
+    ASSERT_EQ(expected.size(), 1302);
+
+    // rows split anywhere between chunks
+    for(size_t chunk: {1, 7, 60, 1000, 16384}){
+        YahooFinance::SpotCsvStream stream;
+        std::vector<std::time_t> dates;
+        auto on_spot = [&](std::time_t d, double, double, double, double){ dates.push_back(d); };
+        for(size_t pos = 0; pos < body.size(); pos += chunk){
+            stream.feed(std::string_view(body).substr(pos, chunk), on_spot);
+        }
+        stream.finish(on_spot);
+        ASSERT_TRUE(stream.isCsv());
+        ASSERT_EQ(stream.nbSpots(), expected.size()) << chunk;
+        ASSERT_EQ(dates, expected) << chunk;
+    }
+
+    // last row without line break, \r\n line breaks
+    YahooFinance::SpotCsvStream stream;
+    size_t n = 0;
+    auto count = [&](std::time_t, double, double, double, double){ ++n; };
+    stream.feed("Date,Open,High,Low,Close\r\n2023-06-01,1,2,0.5,1.5\r\n2023-06-0", count);
+    stream.feed("2,1,2,0.5,1.5", count);
+    ASSERT_EQ(n, 1);
+    stream.finish(count);
+    ASSERT_EQ(n, 2);
+
+    // error responses are no CSV, even without any line break
+    stream.reset();
+    stream.feed("{\"finance\":{\"error\":{\"code\":\"Unauthorized\"}}}\n2023-06-01,1,2,0.5,1.5\n", count);
+    stream.finish(count);
+    ASSERT_FALSE(stream.isCsv());
+    ASSERT_EQ(n, 2);
+    stream.reset();
+    stream.feed(std::string(10000, 'x'), count);
+    stream.finish(count);
+    ASSERT_FALSE(stream.isCsv());
+}
+
+namespace{
+const std::time_t one_day = 24 * 60 * 60;
+
+struct TempCacheDir
+{
+    std::string dir;
+    TempCacheDir(){
+        dir = (std::filesystem::temp_directory_path() / ("urph-fin-test-" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "-" +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name())).string();
+        std::filesystem::remove_all(dir);
+    }
+    ~TempCacheDir(){
+        std::filesystem::remove_all(dir);
+    }
+};
+}
+
+TEST(TestSpotCache, write_read)
+{
+    TempCacheDir tmp;
+    YahooFinance::SpotCache cache(tmp.dir);
+
+    ASSERT_TRUE(cache.read("USDJPY=X").empty());
+
+    YahooFinance::CachedSpots cached;
+    cached.coveredFrom = dateToEpoch("2023-06-01");
+    cached.coveredTo = dateToEpoch("2023-06-02");
+    cached.spots.emplace_back(dateToEpoch("2023-06-01"), 139.1, 140.2, 138.3, 139.123456789);
+    cached.spots.emplace_back(dateToEpoch("2023-06-02"), 139.5, 140.0, 139.0, 139.9);
+    // after coveredTo, not written
+    cached.spots.emplace_back(dateToEpoch("2023-06-05"), 140.0, 140.0, 140.0, 140.0);
+    cache.write("USDJPY=X", cached);
+
+    auto read = cache.read("USDJPY=X");
+    ASSERT_EQ(read.coveredFrom, cached.coveredFrom);
+    ASSERT_EQ(read.coveredTo, cached.coveredTo);
+    ASSERT_EQ(read.spots.size(), 2);
+    ASSERT_EQ(read.spots[0].getDate(), dateToEpoch("2023-06-01"));
+    ASSERT_EQ(read.spots[0].getClose(), 139.123456789);
+    ASSERT_EQ(read.spots[1].getOpen(), 139.5);
+}
+
+TEST(TestSpotCache, missingPeriod)
+{
+    YahooFinance::CachedSpots cached;
+    std::time_t from, to;
+    const std::time_t p1 = dateToEpoch("2023-06-01") + 3600;
+    const std::time_t p2 = dateToEpoch("2023-06-10") + 3600;
+
+    // nothing cached
+    ASSERT_TRUE(YahooFinance::SpotCache::missingPeriod(cached, p1, p2, from, to));
+    ASSERT_EQ(from, p1);
+    ASSERT_EQ(to, p2);
+
+    // everything cached, same day is enough
+    cached.coveredFrom = dateToEpoch("2023-06-01") + 7200;
+    cached.coveredTo = dateToEpoch("2023-06-10");
+    ASSERT_FALSE(YahooFinance::SpotCache::missingPeriod(cached, p1, p2, from, to));
+
+    // only the days after the cached ones are missing
+    cached.coveredTo = dateToEpoch("2023-06-07") + 100;
+    ASSERT_TRUE(YahooFinance::SpotCache::missingPeriod(cached, p1, p2, from, to));
+    ASSERT_EQ(from, dateToEpoch("2023-06-08"));
+    ASSERT_EQ(to, p2);
+
+    // only the days before the cached ones are missing
+    cached.coveredFrom = dateToEpoch("2023-06-03");
+    cached.coveredTo = dateToEpoch("2023-06-11");
+    ASSERT_TRUE(YahooFinance::SpotCache::missingPeriod(cached, p1, p2, from, to));
+    ASSERT_EQ(from, p1);
+    ASSERT_EQ(to, dateToEpoch("2023-06-03") - 1);
+}
+
+TEST(TestLastSpots, missingPeriod)
+{
+    YahooFinance::LastSpots known;
+    YahooFinance::LastSpot last;
+    std::time_t from;
+    const std::time_t p1 = dateToEpoch("2023-06-01") + 3600;
+    const std::time_t p2 = dateToEpoch("2023-06-10") + 3600;
+
+    ASSERT_FALSE(known.find("AAPL", last));
+
+    // only the days after the latest spot
+    known.update("AAPL", dateToEpoch("2023-06-07"), 180.0, dateToEpoch("2023-06-08") + 100);
+    ASSERT_TRUE(known.find("AAPL", last));
+    ASSERT_TRUE(YahooFinance::LastSpots::missingPeriod(last, p1, p2, from));
+    ASSERT_EQ(from, dateToEpoch("2023-06-08"));
+
+    // latest spot older than the period
+    ASSERT_TRUE(YahooFinance::LastSpots::missingPeriod(last, p1 + 10 * one_day, p2 + 10 * one_day, from));
+    ASSERT_EQ(from, p1 + 10 * one_day);
+
+    // an older download does not move the latest spot back
+    known.update("AAPL", dateToEpoch("2023-06-05"), 170.0, dateToEpoch("2023-06-06"));
+    ASSERT_TRUE(known.find("AAPL", last));
+    ASSERT_EQ(last.date, dateToEpoch("2023-06-07"));
+    ASSERT_EQ(last.close, 180.0);
+
+    // checked up to the end of the period without new spot, e.g. a week end
+    known.update("AAPL", 0, 0.0, dateToEpoch("2023-06-10"));
+    ASSERT_TRUE(known.find("AAPL", last));
+    ASSERT_EQ(last.date, dateToEpoch("2023-06-07"));
+    ASSERT_FALSE(YahooFinance::LastSpots::missingPeriod(last, p1, p2, from));
+
+    // latest spot on the last day of the period
+    known.update("MSFT", dateToEpoch("2023-06-10"), 330.0, dateToEpoch("2023-06-09"));
+    ASSERT_TRUE(known.find("MSFT", last));
+    ASSERT_FALSE(YahooFinance::LastSpots::missingPeriod(last, p1, p2, from));
+
+    known.clear();
+    ASSERT_FALSE(known.find("MSFT", last));
+}
+
+TEST(TestSpotCache, quote_warm_start)
+{
+    TempCacheDir tmp;
+    YahooFinance::SpotCache cache(tmp.dir);
+    const std::time_t p1 = dateToEpoch("2023-06-01");
+    const std::time_t p2 = dateToEpoch("2023-06-06");
+
+    std::time_t from, to;
+    {
+        YahooFinance::Quote cold("AAPL", &cache);
+        ASSERT_TRUE(cold.loadCachedSpots(p1, p2, from, to));
+        ASSERT_EQ(cold.nbSpots(), 0);
+        cold.addDownloadedSpots(csv, from, to);
+        ASSERT_EQ(cold.nbSpots(), 3);
+    }
+
+    YahooFinance::Quote warm("AAPL", &cache);
+    ASSERT_FALSE(warm.loadCachedSpots(p1, p2, from, to));
+    ASSERT_EQ(warm.nbSpots(), 3);
+    ASSERT_DOUBLE_EQ(warm.getSpot((size_t)2).getClose(), 179.210007);
+
+    // a longer period only needs the new days
+    YahooFinance::Quote longer("AAPL", &cache);
+    ASSERT_TRUE(longer.loadCachedSpots(p1, p2 + 3 * one_day, from, to));
+    ASSERT_EQ(from, p2 + one_day);
+    ASSERT_EQ(to, p2 + 3 * one_day);
+    longer.addDownloadedSpots("Date,Open,High,Low,Close,Adj Close,Volume\n2023-06-07,178.4,181.2,177.3,177.8,177.3,61944600\n", from, to);
+    ASSERT_EQ(longer.nbSpots(), 4);
+    ASSERT_EQ(cache.read("AAPL").spots.size(), 4);
+}
+
+TEST(TestBatchQuote, parse)
+{
+    const std::string json = R"({"quoteResponse":{"result":[
+        {"language":"en-US","symbol":"AAPL","regularMarketTime":1686081601,"regularMarketPrice":179.21,"tags":["a","b]"],"nested":{"x":{"y":[1,2]}}},
+        {"symbol":"USDJPY=X","regularMarketPrice":1.396e2,"regularMarketTime":1686096000,"longName":"quote \"escaped\" {name}"},
+        {"symbol":"NOPRICE","regularMarketPrice":null},
+        {}
+    ],"error":null}})";
+    std::vector<YahooFinance::LatestPrice> prices;
+    ASSERT_TRUE(YahooFinance::parseBatchQuote(json, prices));
+    ASSERT_EQ(prices.size(), 2);
+    ASSERT_EQ(prices[0].symbol, "AAPL");
+    ASSERT_EQ(prices[0].time, 1686081601);
+    ASSERT_DOUBLE_EQ(prices[0].price, 179.21);
+    ASSERT_EQ(prices[1].symbol, "USDJPY=X");
+    ASSERT_DOUBLE_EQ(prices[1].price, 139.6);
+
+    prices.clear();
+    ASSERT_FALSE(YahooFinance::parseBatchQuote(R"({"finance":{"result":null,"error":{"code":"Unauthorized"}}})", prices));
+    ASSERT_FALSE(YahooFinance::parseBatchQuote("", prices));
+    ASSERT_FALSE(YahooFinance::parseBatchQuote(R"({"quoteResponse":{"result":[{"symbol":"AAPL")", prices));
+    ASSERT_TRUE(prices.empty());
+}
+
+TEST(TestBatchQuote, makeBatches)
+{
+    std::vector<std::string> symbols;
+    for(int i = 0; i < 150; ++i) symbols.push_back("S" + std::to_string(i));
+    auto batches = YahooFinance::makeBatches(symbols, 50);
+    ASSERT_EQ(batches.size(), 3);
+    ASSERT_EQ(batches[2].size(), 50);
+    ASSERT_EQ(batches[2].back(), "S149");
+    ASSERT_EQ(YahooFinance::makeBatches(symbols, 40).back().size(), 30);
+    ASSERT_TRUE(YahooFinance::makeBatches({}, 50).empty());
+
+    auto url = yahooQuoteUrl({"AAPL", "USDJPY=X", "^N225"});
+    ASSERT_NE(url.find("symbols=AAPL%2CUSDJPY%3DX%2C%5EN225&"), std::string::npos) << url;
+}
+
+TEST(TestRequestScheduler, tokenBucket)
+{
+    using namespace std::chrono;
+    auto t0 = steady_clock::now();
+    YahooFinance::TokenBucket bucket(10.0, 2.0);
+    ASSERT_TRUE(bucket.tryTake(t0));
+    ASSERT_TRUE(bucket.tryTake(t0));
+    ASSERT_FALSE(bucket.tryTake(t0));
+    ASSERT_NEAR(duration<double>(bucket.waitTime(t0)).count(), 0.1, 0.01);
+    ASSERT_FALSE(bucket.tryTake(t0 + milliseconds(50)));
+    ASSERT_TRUE(bucket.tryTake(t0 + milliseconds(101)));
+    // never more than the burst
+    ASSERT_TRUE(bucket.tryTake(t0 + seconds(10)));
+    ASSERT_TRUE(bucket.tryTake(t0 + seconds(10)));
+    ASSERT_FALSE(bucket.tryTake(t0 + seconds(10)));
+
+    YahooFinance::TokenBucket unlimited(0.0, 1.0);
+    for(int i = 0; i < 100; ++i) ASSERT_TRUE(unlimited.tryTake(t0));
+    ASSERT_EQ(unlimited.waitTime(t0).count(), 0);
+}
+
+TEST(TestRequestScheduler, aimdAndRetries)
+{
+    using namespace std::chrono;
+    using Outcome = YahooFinance::RequestScheduler::Outcome;
+    ASSERT_EQ(YahooFinance::RequestScheduler::classify(true, 200), Outcome::Success);
+    ASSERT_EQ(YahooFinance::RequestScheduler::classify(true, 429), Outcome::Throttled);
+    ASSERT_EQ(YahooFinance::RequestScheduler::classify(true, 503), Outcome::ServerError);
+    ASSERT_EQ(YahooFinance::RequestScheduler::classify(true, 404), Outcome::Rejected);
+    ASSERT_EQ(YahooFinance::RequestScheduler::classify(false, 0), Outcome::NetworkError);
+
+    YahooFinance::SchedulerOptions options;
+    options.maxInFlight = 8;
+    options.maxRetries = 2;
+    options.baseBackoff = milliseconds(100);
+    options.seed = 42;
+    YahooFinance::RequestScheduler scheduler(options);
+    ASSERT_EQ(scheduler.concurrency(), 8);
+
+    auto t0 = steady_clock::now();
+    steady_clock::duration delay;
+    ASSERT_TRUE(scheduler.tryAcquire(t0));
+
+    // throttled: halved, retried after the jittered backoff, new requests paused
+    ASSERT_TRUE(scheduler.onCompleted(Outcome::Throttled, 0, steady_clock::duration::zero(), t0, delay));
+    ASSERT_EQ(scheduler.concurrency(), 4);
+    ASSERT_LE(delay, milliseconds(100));
+    ASSERT_FALSE(scheduler.tryAcquire(t0 + milliseconds(50)));
+    ASSERT_GT(scheduler.waitTime(t0 + milliseconds(50)), steady_clock::duration::zero());
+    ASSERT_TRUE(scheduler.tryAcquire(t0 + milliseconds(100)));
+
+    // the other requests in flight fail together, one decrease only
+    ASSERT_TRUE(scheduler.onCompleted(Outcome::ServerError, 1, steady_clock::duration::zero(), t0 + milliseconds(10), delay));
+    ASSERT_EQ(scheduler.concurrency(), 4);
+    ASSERT_LE(delay, milliseconds(200));
+
+    // Retry-After wins over a shorter backoff
+    ASSERT_TRUE(scheduler.onCompleted(Outcome::Throttled, 0, seconds(3), t0 + milliseconds(20), delay));
+    ASSERT_GE(delay, seconds(3));
+    ASSERT_FALSE(scheduler.tryAcquire(t0 + seconds(2)));
+
+    // out of retries
+    ASSERT_FALSE(scheduler.onCompleted(Outcome::NetworkError, 2, steady_clock::duration::zero(), t0 + seconds(1), delay));
+    ASSERT_EQ(scheduler.concurrency(), 2);
+    // no retry of a 4xx
+    ASSERT_FALSE(scheduler.onCompleted(Outcome::Rejected, 0, steady_clock::duration::zero(), t0 + seconds(1), delay));
+
+    // one more in flight for every window of successes
+    for(int i = 0; i < 2; ++i) ASSERT_FALSE(scheduler.onCompleted(Outcome::Success, 0, steady_clock::duration::zero(), t0, delay));
+    ASSERT_EQ(scheduler.concurrency(), 3);
+    for(int i = 0; i < 3 + 4 + 5 + 6 + 7; ++i) scheduler.onCompleted(Outcome::Success, 0, steady_clock::duration::zero(), t0, delay);
+    ASSERT_EQ(scheduler.concurrency(), 8);
+    for(int i = 0; i < 100; ++i) scheduler.onCompleted(Outcome::Success, 0, steady_clock::duration::zero(), t0, delay);
+    ASSERT_EQ(scheduler.concurrency(), 8);
+
+    auto c = scheduler.counters();
+    ASSERT_EQ(c.throttled, 2);
+    ASSERT_EQ(c.serverErrors, 1);
+    ASSERT_EQ(c.networkErrors, 1);
+    ASSERT_EQ(c.retries, 3);
+    ASSERT_EQ(c.failed, 2);
+    ASSERT_EQ(c.concurrencyDecreases, 2);
+    ASSERT_EQ(c.concurrencyIncreases, 6);
+    scheduler.resetCounters();
+    ASSERT_EQ(scheduler.counters().completed, 0);
+    ASSERT_EQ(scheduler.concurrency(), 8);
+}
+
+TEST(TestRequestScheduler, sharedLimitAndPause)
+{
+    using namespace std::chrono;
+    using Outcome = YahooFinance::RequestScheduler::Outcome;
+    YahooFinance::SchedulerOptions options;
+    options.maxInFlight = 2;
+    options.maxBackoff = milliseconds(1000);
+    options.seed = 7;
+    YahooFinance::RequestScheduler scheduler(options);
+
+    // the requests in flight of every run count, released or retried they free their slot
+    auto t0 = steady_clock::now();
+    ASSERT_TRUE(scheduler.tryAcquire(t0));
+    ASSERT_TRUE(scheduler.tryAcquire(t0));
+    ASSERT_EQ(scheduler.running(), 2);
+    ASSERT_FALSE(scheduler.tryAcquire(t0));
+    ASSERT_GT(scheduler.waitTime(t0), steady_clock::duration::zero());
+    scheduler.release();
+    ASSERT_EQ(scheduler.waitTime(t0), steady_clock::duration::zero());
+    ASSERT_TRUE(scheduler.tryAcquire(t0));
+    scheduler.release();
+    scheduler.release();
+    ASSERT_EQ(scheduler.running(), 0);
+
+    // the pause outlives the run throttled, never longer than maxBackoff whatever the Retry-After
+    YahooFinance::SchedulerCounters run;
+    steady_clock::duration delay;
+    ASSERT_TRUE(scheduler.onCompleted(Outcome::Throttled, 0, hours(1), t0, delay, &run));
+    ASSERT_LE(delay, milliseconds(1000));
+    ASSERT_FALSE(scheduler.tryAcquire(t0 + milliseconds(500)));
+    ASSERT_LE(scheduler.waitTime(t0), milliseconds(1000));
+    ASSERT_TRUE(scheduler.tryAcquire(t0 + milliseconds(1000)));
+    ASSERT_EQ(run.throttled, 1);
+    ASSERT_EQ(run.retries, 1);
+    ASSERT_EQ(scheduler.counters().throttled, 1);
+}
+
+#ifndef _WIN32
+namespace{
+// points every Yahoo Finance URL to a stand-in while in scope
+struct StandInBaseUrl{
+    explicit StandInBaseUrl(const HttpStandIn& server){ setenv("YAHOO_FINANCE_BASE_URL", server.base_url().c_str(), 1); }
+    ~StandInBaseUrl(){ unsetenv("YAHOO_FINANCE_BASE_URL"); }
+};
+}
+
+TEST(TestStandIn, per_symbol_and_batched)
+{
+    HttpStandIn server(yahoo_stand_in);
+    ASSERT_TRUE(server.running());
+    StandInBaseUrl base(server);
+
+    std::vector<std::string> symbols;
+    for(int i = 0; i < 150; ++i) symbols.push_back("SYM" + std::to_string(i));
+    symbols.push_back("USDJPY=X");
+
+    // one request per symbol
+    YahooFinance::FetchEngine per_symbol(8);
+    for(const auto& s: symbols) per_symbol.add({s, 0, 0, "1d"});
+    std::vector<double> closes(symbols.size(), 0.0);
+    per_symbol.run([&](size_t i, std::string&& csv){
+        YahooFinance::Quote q(symbols[i]);
+        q.parseHistoricalCsv(csv);
+        if(q.nbSpots() == 3) closes[i] = q.getSpot((size_t)2).getClose();
+    });
+    ASSERT_EQ(server.nb_requests(), symbols.size());
+    for(size_t i = 0; i < symbols.size(); ++i){
+        ASSERT_DOUBLE_EQ(closes[i], stand_in_price(symbols[i])) << symbols[i];
+    }
+    const auto& stats = per_symbol.transferStats();
+    ASSERT_EQ(stats.size(), symbols.size());
+    size_t reused = 0;
+    for(const auto& s: stats){
+        ASSERT_TRUE(s.ok);
+        ASSERT_EQ(s.httpCode, 200);
+        ASSERT_GT(s.bytes, 0);
+        ASSERT_LE(s.firstByte, s.total);
+        if(s.reusedConnection) ++reused;
+    }
+    // keep alive, not one connection per request
+    ASSERT_LE(server.nb_connections(), 8);
+    ASSERT_GE(reused, symbols.size() - 8);
+
+    // a handful of batched requests
+    YahooFinance::FetchEngine batched(8);
+    for(const auto& b: YahooFinance::makeBatches(symbols, 50)) batched.add({"", 0, 0, "", yahooQuoteUrl(b)});
+    std::vector<YahooFinance::LatestPrice> prices;
+    batched.run([&](size_t, std::string&& json){
+        ASSERT_TRUE(YahooFinance::parseBatchQuote(json, prices));
+    });
+    ASSERT_EQ(server.nb_requests(), symbols.size() + 4);
+    ASSERT_EQ(prices.size(), symbols.size());
+    for(const auto& p: prices){
+        ASSERT_DOUBLE_EQ(p.price, stand_in_price(p.symbol)) << p.symbol;
+        ASSERT_EQ(p.time, 1686096000);
+    }
+
+    // streamed into the quotes as the chunks arrive
+    std::vector<YahooFinance::Quote> quotes;
+    for(const auto& s: symbols) quotes.emplace_back(s);
+    std::vector<bool> done(symbols.size(), false);
+    per_symbol.run([&](size_t i, const char* data, size_t size){
+        ASSERT_FALSE(done[i]);
+        quotes[i].addDownloadedChunk(data, size);
+    },
+    [&](size_t i, bool ok){
+        ASSERT_TRUE(ok);
+        ASSERT_TRUE(quotes[i].endDownload(ok));
+        done[i] = true;
+    });
+    for(size_t i = 0; i < symbols.size(); ++i){
+        ASSERT_TRUE(done[i]);
+        ASSERT_EQ(quotes[i].nbSpots(), 3);
+        ASSERT_DOUBLE_EQ(quotes[i].getSpot((size_t)2).getClose(), stand_in_price(symbols[i]));
+    }
+    YahooFinance::Quote weekly("AAPL");
+    weekly.getHistoricalSpots(dateToEpoch("2023-06-01"), dateToEpoch("2023-06-08"), "1wk");
+    ASSERT_EQ(weekly.nbSpots(), 3);
+
+    // unknown URL, the body of the error response is no CSV
+    TransferStats not_found;
+    std::string body = TransferContext::current().get(server.base_url() + "/nowhere", &not_found);
+    ASSERT_EQ(body, "Not Found");
+    ASSERT_EQ(not_found.httpCode, 404);
+    YahooFinance::Quote missing("MISSING");
+    ASSERT_TRUE(TransferContext::current().stream(server.base_url() + "/nowhere", [&](const char* data, size_t size){
+        missing.addDownloadedChunk(data, size);
+    }));
+    ASSERT_FALSE(missing.endDownload(true));
+    ASSERT_EQ(missing.nbSpots(), 0);
+}
+
+TEST(TestStandIn, transfer_context)
+{
+    HttpStandIn server(yahoo_stand_in);
+    ASSERT_TRUE(server.running());
+    StandInBaseUrl base(server);
+
+    // a thread of its own, so its context has no connection left by another test
+    std::vector<TransferStats> stats(3);
+    std::vector<std::string> bodies(3);
+    std::thread([&](){
+        for(size_t i = 0; i < stats.size(); ++i){
+            bodies[i] = TransferContext::current().get(yahooCsvUrl("SYM" + std::to_string(i), 0, 0, "1d"), &stats[i]);
+        }
+    }).join();
+
+    ASSERT_EQ(server.nb_requests(), 3);
+    // one connection kept alive for every request of the thread
+    ASSERT_EQ(server.nb_connections(), 1);
+    ASSERT_FALSE(stats[0].reusedConnection);
+    // the phases of a new connection, in the order they happen
+    ASSERT_LE(stats[0].dns, stats[0].connect);
+    ASSERT_LE(stats[0].connect, stats[0].firstByte);
+    for(size_t i = 0; i < stats.size(); ++i){
+        ASSERT_TRUE(stats[i].ok);
+        ASSERT_EQ(stats[i].httpCode, 200);
+        ASSERT_EQ(stats[i].bytes, (long long)bodies[i].size());
+        ASSERT_EQ(stats[i].url.find(server.base_url()), 0) << stats[i].url;
+        ASSERT_GT(stats[i].firstByte, 0);
+        ASSERT_LE(stats[i].firstByte, stats[i].total);
+        if(i > 0) ASSERT_TRUE(stats[i].reusedConnection);
+    }
+}
+
+TEST(TestStandIn, engines_share_the_limit)
+{
+    // what the server sees at once, every request is slow enough to overlap
+    std::atomic<int> active{0}, most{0};
+    HttpStandIn server([&](const std::string& target){
+        const int now = ++active;
+        for(int m = most; now > m && !most.compare_exchange_weak(m, now);){}
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        --active;
+        return yahoo_stand_in(target);
+    });
+    ASSERT_TRUE(server.running());
+    StandInBaseUrl base(server);
+
+    YahooFinance::SchedulerOptions options;
+    options.maxInFlight = 3;
+    YahooFinance::RequestScheduler scheduler(options);
+
+    std::vector<size_t> fetched(2, 0);
+    std::vector<std::thread> loads;
+    for(int e = 0; e < 2; ++e){
+        loads.emplace_back([&, e](){
+            YahooFinance::FetchEngine engine(scheduler);
+            for(int i = 0; i < 9; ++i) engine.add({"SYM" + std::to_string(e) + "_" + std::to_string(i), 0, 0, "1d"});
+            engine.run([&](size_t, std::string&& csv){ if(!csv.empty()) ++fetched[e]; });
+            ASSERT_EQ(engine.counters().completed, 9);
+        });
+    }
+    for(auto& t: loads) t.join();
+
+    ASSERT_EQ(fetched[0], 9);
+    ASSERT_EQ(fetched[1], 9);
+    ASSERT_LE(most, 3);
+    ASSERT_EQ(scheduler.running(), 0);
+    ASSERT_EQ(scheduler.counters().completed, 18);
+}
+
+TEST(TestStandIn, throttled_and_retried)
+{
+    // every symbol is throttled or fails once before it is served, MISSING does not exist
+    std::mutex mutex;
+    std::map<std::string, int> hits;
+    HttpStandIn server([&](const std::string& target){
+        int n;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            n = hits[target.substr(0, target.find('?'))]++;
+        }
+        if(target.find("MISSING") != std::string::npos){
+            HttpStandIn::Response r;
+            r.status = 404;
+            r.body = "Not Found";
+            return r;
+        }
+        if(n == 0){
+            HttpStandIn::Response r;
+            r.status = target.find("SYM1") != std::string::npos ? 503 : 429;
+            r.body = "Date,Open,High,Low,Close,Adj Close,Volume\n2000-01-01,1,1,1,1,1,1\n";
+            return r;
+        }
+        return yahoo_stand_in(target);
+    });
+    ASSERT_TRUE(server.running());
+    StandInBaseUrl base(server);
+
+    YahooFinance::SchedulerOptions options;
+    options.maxInFlight = 4;
+    options.baseBackoff = std::chrono::milliseconds(5);
+    options.seed = 1;
+    YahooFinance::RequestScheduler scheduler(options);
+
+    std::vector<std::string> symbols{"SYM0", "SYM1", "SYM2", "SYM3", "SYM4", "SYM5", "MISSING"};
+    std::vector<YahooFinance::Quote> quotes;
+    for(const auto& s: symbols) quotes.emplace_back(s);
+    std::vector<int> ok(symbols.size(), -1);
+
+    YahooFinance::FetchEngine engine(scheduler);
+    for(const auto& s: symbols) engine.add({s, 0, 0, "1d"});
+    engine.run([&](size_t i, const char* data, size_t size){
+        quotes[i].addDownloadedChunk(data, size);
+    },
+    [&](size_t i, bool success){
+        ASSERT_EQ(ok[i], -1);
+        ok[i] = quotes[i].endDownload(success) ? 1 : 0;
+    });
+
+    for(size_t i = 0; i + 1 < symbols.size(); ++i){
+        ASSERT_EQ(ok[i], 1) << symbols[i];
+        // the body of the throttled response was not taken
+        ASSERT_EQ(quotes[i].nbSpots(), 3) << symbols[i];
+    }
+    ASSERT_EQ(ok.back(), 0);
+    ASSERT_EQ(server.nb_requests(), 2 * (symbols.size() - 1) + 1);
+
+    auto c = scheduler.counters();
+    ASSERT_EQ(engine.counters().retries, c.retries);
+    ASSERT_EQ(c.throttled, 5);
+    ASSERT_EQ(c.serverErrors, 1);
+    ASSERT_EQ(c.retries, 6);
+    ASSERT_EQ(c.failed, 1);
+    ASSERT_GE(c.concurrencyDecreases, 1);
+
+    // buffered bodies: failed requests get an empty body
+    scheduler.resetCounters();
+    YahooFinance::FetchEngine buffered(scheduler);
+    buffered.add({"MISSING", 0, 0, "1d"});
+    buffered.add({"SYM9", 0, 0, "1d"});
+    std::vector<std::string> bodies(2);
+    buffered.run([&](size_t i, std::string&& body){ bodies[i] = std::move(body); });
+    ASSERT_TRUE(bodies[0].empty());
+    ASSERT_EQ(bodies[1].compare(0, 5, "Date,"), 0);
+    ASSERT_EQ(scheduler.counters().throttled, 1);
+}
+
+TEST(TestStandIn, deadline)
+{
+    // HANG is never answered until the test ends
+    std::atomic<bool> release{false};
+    HttpStandIn server([&](const std::string& target){
+        if(target.find("HANG") != std::string::npos){
+            for(int n = 0; n < 500 && !release; ++n) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return yahoo_stand_in(target);
+    });
+    ASSERT_TRUE(server.running());
+    StandInBaseUrl base(server);
+    struct Release{
+        std::atomic<bool>& r;
+        ~Release(){ r = true; }
+    } release_on_exit{release};
+
+    // one request cannot take longer than its timeout
+    RequestTimeouts timeouts;
+    timeouts.total = std::chrono::milliseconds(200);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(TransferContext::current().get(server.base_url() + "/v7/finance/download/HANG", nullptr, timeouts).empty());
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+
+    // the timeouts are those of an engine, the next one keeps the defaults
+    {
+        YahooFinance::SchedulerOptions no_retry;
+        no_retry.maxRetries = 0;
+        YahooFinance::RequestScheduler scheduler(no_retry);
+        YahooFinance::FetchEngine short_engine(scheduler);
+        short_engine.setTimeouts(timeouts);
+        short_engine.add({"HANG", 0, 0, "1d"});
+        std::string body = "untouched";
+        start = std::chrono::steady_clock::now();
+        short_engine.run([&](size_t, std::string&& b){ body = std::move(b); });
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+        ASSERT_TRUE(body.empty());
+
+        YahooFinance::FetchEngine default_engine(scheduler);
+        default_engine.add({"HANG", 0, 0, "1d"});
+        std::thread releaser([&](){
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            release = true;
+        });
+        start = std::chrono::steady_clock::now();
+        default_engine.run([&](size_t, std::string&& b){ body = std::move(b); });
+        const auto waited = std::chrono::steady_clock::now() - start;
+        releaser.join();
+        release = false;
+        ASSERT_GE(waited, std::chrono::milliseconds(400));
+        ASSERT_EQ(body.compare(0, 5, "Date,"), 0);
+    }
+
+    // the others are answered, the hung one fails at the deadline
+    YahooFinance::SchedulerOptions options;
+    options.maxInFlight = 4;
+    YahooFinance::RequestScheduler scheduler(options);
+    std::vector<std::string> symbols{"SYM0", "HANG", "SYM1", "SYM2"};
+    std::vector<YahooFinance::Quote> quotes;
+    for(const auto& s: symbols) quotes.emplace_back(s);
+    std::vector<int> ok(symbols.size(), -1);
+
+    YahooFinance::FetchEngine engine(scheduler);
+    for(const auto& s: symbols) engine.add({s, 0, 0, "1d"});
+    start = std::chrono::steady_clock::now();
+    engine.setDeadline(start + std::chrono::milliseconds(300));
+    engine.run([&](size_t i, const char* data, size_t size){
+        quotes[i].addDownloadedChunk(data, size);
+    },
+    [&](size_t i, bool success){
+        ASSERT_EQ(ok[i], -1);
+        ok[i] = quotes[i].endDownload(success) ? 1 : 0;
+    });
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    ASSERT_TRUE(engine.deadlinePassed());
+    ASSERT_EQ(ok, (std::vector<int>{1, 0, 1, 1}));
+    ASSERT_EQ(quotes[1].nbSpots(), 0);
+
+    // nothing starts once the deadline passed
+    YahooFinance::FetchEngine late(scheduler);
+    late.add({"SYM3", 0, 0, "1d"});
+    late.setDeadline(start);
+    std::vector<std::string> bodies(1, "untouched");
+    const auto requests = server.nb_requests();
+    late.run([&](size_t i, std::string&& body){ bodies[i] = std::move(body); });
+    ASSERT_TRUE(late.deadlinePassed());
+    ASSERT_TRUE(bodies[0].empty());
+    ASSERT_EQ(server.nb_requests(), requests);
+}
+#endif
+#endif